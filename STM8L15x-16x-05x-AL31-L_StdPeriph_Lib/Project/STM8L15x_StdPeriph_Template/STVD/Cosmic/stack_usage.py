@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Static worst-case stack estimate for every entry point of the firmware.
+
+Reads the "Stack usage" section that the Cosmic linker writes to the map file (Debug profile links
+with -m <target>.map) and the interrupt vector table, then prints the deepest call chain of main()
+and of every interrupt handler. Interrupts all run at the same software priority (ITC is never
+configured), so they do not nest: the worst case is main() plus the deepest handler plus the
+context the CPU pushes on interrupt entry.
+
+    python stack_usage.py Debug/stm8l15xx2_3.map [--vectors stm8_interrupt_vector.c] [--stack-size 512]
+
+Exits with status 1 if the estimate does not fit the stack region (STACK_MON_BOTTOM..STACK_MON_TOP
+in stack_mon.h), 2 if the map file has no stack usage section.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# CC, A, X (2), Y (2) and PC (3) pushed by the STM8 on interrupt entry
+IRQ_CONTEXT_BYTES = 9
+
+# Stack region size, see stack_mon.h
+DEFAULT_STACK_SIZE = 512
+
+# "_name   >  12   (4)": total with the deepest callee chain, local frame in brackets.
+# ">" marks functions with callees, "*" marks recursion (total is then a lower bound).
+USAGE_LINE = re.compile(r"^\s*(_\w+)\s+([>*]?)\s*(\d+)\s+\((\d+)\)")
+VECTOR_LINE = re.compile(r"\(interrupt_handler_t\)\s*(\w+)")
+
+
+def parse_map(path):
+    usage = {}
+    in_section = False
+    with open(path, errors="replace") as f:
+        for line in f:
+            if "Stack usage" in line:
+                in_section = True
+                continue
+            if not in_section:
+                continue
+            # Next section header ends the table
+            if line.strip() in ("Symbols", "Call tree"):
+                break
+            m = USAGE_LINE.match(line)
+            if m:
+                name, flag, total, local = m.group(1), m.group(2), int(m.group(3)), int(m.group(4))
+                usage[name] = (total, local, flag == "*")
+    return usage
+
+
+def parse_vectors(path):
+    handlers = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = VECTOR_LINE.search(line)
+            # Reset vector is the C startup, main() is reported on its own
+            if m and m.group(1) != "_stext" and m.group(1) not in handlers:
+                handlers.append(m.group(1))
+    return handlers
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map")
+    parser.add_argument("--vectors", default=os.path.join(here, "stm8_interrupt_vector.c"))
+    parser.add_argument("--stack-size", type=int, default=DEFAULT_STACK_SIZE)
+    args = parser.parse_args()
+
+    usage = parse_map(args.map)
+    if not usage:
+        sys.stderr.write("%s: no stack usage section, link with a map file (-m)\n" % args.map)
+        return 2
+
+    handlers = parse_vectors(args.vectors)
+
+    print("entry\tbytes\tlocal\tnote")
+    main_total, main_local, main_rec = usage.get("_main", (0, 0, False))
+    print("main\t%d\t%d\t%s" % (main_total, main_local, "recursive" if main_rec else ""))
+
+    worst_irq = 0
+    worst_name = "-"
+    for name in handlers:
+        symbol = "_" + name
+        if symbol not in usage:
+            # Shared default handlers (NonHandledInterrupt) appear once
+            continue
+        total, local, rec = usage[symbol]
+        total += IRQ_CONTEXT_BYTES
+        print("%s\t%d\t%d\t%s" % (name, total, local, "recursive" if rec else ""))
+        if total > worst_irq:
+            worst_irq, worst_name = total, name
+
+    worst = main_total + worst_irq
+    print("worst_case\t%d\t-\tmain + %s" % (worst, worst_name))
+    print("stack_size\t%d\t-\t%d free" % (args.stack_size, args.stack_size - worst))
+
+    return 1 if worst > args.stack_size else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
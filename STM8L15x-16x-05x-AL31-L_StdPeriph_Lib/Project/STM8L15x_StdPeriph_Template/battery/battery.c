@@ -0,0 +1,140 @@
+/**
+ * @file battery.c
+ * @brief Battery voltage monitor, PVD interrupt for zero CPU threshold detection and occasional Vrefint measurement
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_pwr.h"
+#include "stm8l15x_adc.h"
+#include "stm8l15x_flash.h"
+
+#include "battery.h"
+#include "periph_clk.h"
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Set from PVD interrupt context, forces a measurement on next update */
+static volatile bool battery_pvd_pending = FALSE;
+
+/* Updates left until next measurement, zero forces a measurement on first update */
+static uint8_t battery_countdown = 0;
+
+/* Last measurement and its classification */
+static uint16_t battery_mv = 0;
+static battery_level_t battery_level = BATTERY_OK;
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Configure PVD to interrupt when VDD crosses BATTERY_PVD_LEVEL, should be called once at startup
+ */
+void battery_init(void)
+{
+  PWR_PVDLevelConfig(BATTERY_PVD_LEVEL);
+  PWR_PVDClearFlag();
+  PWR_PVDITConfig(ENABLE);
+  PWR_PVDCmd(ENABLE);
+}
+
+/**
+ * @brief Get current battery level, refreshing the measurement if it is stale or the PVD has fired
+ * @retval Battery level
+ *
+ * Below BATTERY_OK every update measures, the PVD has no threshold left to report a further fall (or the recovery).
+ */
+battery_level_t battery_update(void)
+{
+  if ((battery_pvd_pending == FALSE) && (battery_countdown != 0) && (battery_level == BATTERY_OK))
+  {
+    battery_countdown--;
+    return battery_level;
+  }
+
+  battery_pvd_pending = FALSE;
+  battery_countdown = BATTERY_MEASURE_INTERVAL;
+
+  battery_mv = battery_measure_mv();
+
+  if (battery_mv < BATTERY_CUTOFF_MV)
+  {
+    battery_level = BATTERY_CRITICAL;
+  }
+  else if (battery_mv < BATTERY_LOW_MV)
+  {
+    battery_level = BATTERY_LOW;
+  }
+  else
+  {
+    battery_level = BATTERY_OK;
+  }
+
+  return battery_level;
+}
+
+/**
+ * @brief Get the VDD behind the last level battery_update() returned
+ * @retval VDD in millivolts, 0 before the first measurement
+ */
+uint16_t battery_last_mv(void)
+{
+  return battery_mv;
+}
+
+/**
+ * @brief Measure VDD by converting the internal reference against it
+ * @retval VDD in millivolts
+ *
+ * VDD = 3.0V * VREFINT_CAL / VREFINT_RAW, where VREFINT_CAL is the factory conversion taken at 3.0V.
+ */
+uint16_t battery_measure_mv(void)
+{
+  uint16_t raw;
+  uint16_t cal;
+  uint8_t factory;
+
+  periph_clk_acquire(CLK_Peripheral_ADC1);
+
+  ADC_Init(ADC1, ADC_ConversionMode_Single, ADC_Resolution_12Bit, ADC_Prescaler_1);
+  /* Vrefint has a high output impedance, use longest sampling time */
+  ADC_SamplingTimeConfig(ADC1, ADC_Group_FastChannels, ADC_SamplingTime_384Cycles);
+  ADC_Cmd(ADC1, ENABLE);
+
+  ADC_VrefintCmd(ENABLE);
+  while (PWR_GetFlagStatus(PWR_FLAG_VREFINTF) == RESET);
+  ADC_ChannelCmd(ADC1, ADC_Channel_Vrefint, ENABLE);
+
+  ADC_SoftwareStartConv(ADC1);
+  while (ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC) == RESET);
+  raw = ADC_GetConversionValue(ADC1);
+
+  /* Leave ADC and reference fully off, they draw current even while the clock is gated */
+  ADC_ChannelCmd(ADC1, ADC_Channel_Vrefint, DISABLE);
+  ADC_VrefintCmd(DISABLE);
+  ADC_Cmd(ADC1, DISABLE);
+
+  periph_clk_release(CLK_Peripheral_ADC1);
+
+  factory = FLASH_ReadByte(BATTERY_VREFINT_FACTORY_ADDR);
+  cal = (factory == 0) ? BATTERY_VREFINT_TYPICAL : (uint16_t)(BATTERY_VREFINT_FACTORY_MSB | factory);
+
+  if (raw == 0)
+  {
+    return 0;
+  }
+
+  return (uint16_t)((BATTERY_VREFINT_FACTORY_MV * cal) / raw);
+}
+
+/**
+ * @brief PVD crossing notification, should be called from the PVD interrupt handler
+ */
+void battery_pvd_event(void)
+{
+  battery_pvd_pending = TRUE;
+}
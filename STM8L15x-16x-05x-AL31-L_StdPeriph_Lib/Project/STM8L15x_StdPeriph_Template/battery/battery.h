@@ -0,0 +1,66 @@
+/**
+ * @file battery.h
+ * @brief Function prototypes, defines and types for battery voltage monitor (PVD + Vrefint)
+ */
+
+#ifndef BATTERY_H_
+#define BATTERY_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Thresholds assume the MCU is supplied directly from the cell (VDD = battery voltage). The cutoff keeps the cell
+   above the 1.8V brown-out reset threshold while the HV supply starts, BATTERY_PSU_SAG_MV below it */
+#define BATTERY_LOW_MV 2900
+#define BATTERY_CUTOFF_MV 2600
+
+/* Worst case cell sag at HV supply start (inrush through the internal resistance of a cell near end of life) */
+#define BATTERY_PSU_SAG_MV 600
+
+/* PVD threshold, should sit just below BATTERY_LOW_MV so the first crossing is caught with no CPU involvement */
+#define BATTERY_PVD_LEVEL PWR_PVDLevel_2V85
+
+/* Number of battery_update() calls between Vrefint measurements (unless the PVD fires first) */
+#define BATTERY_MEASURE_INTERVAL 16
+
+/* Factory Vrefint conversion (12 bit, taken at VDD = 3.0V), stored as low byte with implicit 0x600 MSBs */
+#define BATTERY_VREFINT_FACTORY_ADDR 0x4910
+#define BATTERY_VREFINT_FACTORY_MSB 0x0600
+#define BATTERY_VREFINT_FACTORY_MV 3000UL
+
+/* Typical Vrefint conversion at 3.0V (1.224V reference), used if the factory byte is not programmed */
+#define BATTERY_VREFINT_TYPICAL 1671
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Battery level as seen by the state machine
+ */
+typedef enum
+{
+  BATTERY_OK, /* Normal operation */
+
+  BATTERY_LOW, /* Degraded mode, shorter and dimmer display */
+
+  BATTERY_CRITICAL /* Below cutoff, display requests are refused */
+
+} battery_level_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void battery_init(void);
+battery_level_t battery_update(void);
+uint16_t battery_last_mv(void);
+uint16_t battery_measure_mv(void);
+void battery_pvd_event(void);
+
+#endif /* BATTERY_H_ */
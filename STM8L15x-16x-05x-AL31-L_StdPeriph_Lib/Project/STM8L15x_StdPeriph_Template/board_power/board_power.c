@@ -0,0 +1,173 @@
+/**
+ * @file board_power.c
+ * @brief Board level low power pin configuration, puts every pin into its lowest leakage state while powered off
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "board_power.h"
+#include "hardwaredefs.h"
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Ports bonded out on the package, index matches board_saved_ports */
+static GPIO_TypeDef* const board_ports[BOARD_NUM_PORTS] = {
+  GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF
+};
+
+/**
+ * Power down state of every pin used by the board.
+ *
+ * - Nixie digit drivers are held low (off), the MOSFET gates must never float, shift register inputs (NIXIE_SPI)
+ *   are held low too, the registers keep the state latched last
+ * - The HV supply enable is held high (supply disabled)
+ * - Switch inputs keep their pull-up and interrupt so they can wake the device, see board_power_down()
+ * - Every pin not listed here (and not reserved) is driven low to avoid floating input leakage
+ */
+static const board_pin_cfg_t board_power_table[] = {
+  /* Blinky LED */
+  {LED_GPIO_PORT, LED_GPIO_PINS, GPIO_Mode_Out_PP_Low_Slow},
+
+  /* Nixie supply */
+  {NIXIE_SUPPLY_PORT, NIXIE_SUPPLY_PIN, GPIO_Mode_Out_PP_High_Slow},
+
+  #ifdef NIXIE_SPI
+  /* Nixie shift register chain */
+  {NIXIE_SPI_PORT, (NIXIE_SPI_SCK_PIN | NIXIE_SPI_MOSI_PIN | NIXIE_SPI_LATCH_PIN), GPIO_Mode_Out_PP_Low_Slow},
+  #else
+  /* Nixie tube A */
+  {TUBE_A_PORT_0, DIGIT_A_0, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_1, DIGIT_A_1, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_2, DIGIT_A_2, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_3, DIGIT_A_3, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_4, DIGIT_A_4, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_5, DIGIT_A_5, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_6, DIGIT_A_6, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_7, DIGIT_A_7, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_8, DIGIT_A_8, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_A_PORT_9, DIGIT_A_9, GPIO_Mode_Out_PP_Low_Slow},
+
+  #ifndef STM8_BASEBAND
+  /* Nixie tube B */
+  {TUBE_B_PORT_0, DIGIT_B_0, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_1, DIGIT_B_1, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_2, DIGIT_B_2, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_3, DIGIT_B_3, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_4, DIGIT_B_4, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_5, DIGIT_B_5, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_6, DIGIT_B_6, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_7, DIGIT_B_7, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_8, DIGIT_B_8, GPIO_Mode_Out_PP_Low_Slow},
+  {TUBE_B_PORT_9, DIGIT_B_9, GPIO_Mode_Out_PP_Low_Slow},
+  #endif /* !STM8_BASEBAND */
+  #endif /* NIXIE_SPI */
+
+  /* Power switch and wake button (switch to ground) */
+  {POWER_SWITCH_PORT, (POWER_SWITCH_PIN_0 | POWER_SWITCH_PIN_1 | POWER_SWITCH_PIN_2), GPIO_Mode_In_PU_IT},
+  {WAKE_BUTTON_PORT, WAKE_BUTTON_PIN, GPIO_Mode_In_PU_No_IT},
+
+  #ifdef STM8_BASEBAND
+  /* External RTC I2C bus, externally pulled up so left released */
+  {RTC_I2C_PORT, (RTC_I2C_SDA_PIN | RTC_I2C_SCL_PIN), GPIO_Mode_Out_OD_HiZ_Slow},
+
+  /* Host UART, line idles high so the pull-up does not conduct */
+  {HOST_UART_PORT, (HOST_UART_TX_PIN | HOST_UART_RX_PIN), GPIO_Mode_In_PU_No_IT},
+  #endif /* STM8_BASEBAND */
+};
+
+#define BOARD_POWER_TABLE_SIZE (sizeof(board_power_table) / sizeof(board_power_table[0]))
+
+/* Active port configuration, captured on power down */
+static board_port_state_t board_saved_ports[BOARD_NUM_PORTS];
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Save active pin configuration and put every pin into its lowest leakage state
+ *
+ * Switch inputs that are currently held low by the switch would draw current through their pull-up
+ * for as long as the device is powered off, these are released to floating inputs without interrupt.
+ * The remaining switch inputs keep their pull-up and interrupt, moving the switch wakes the device.
+ *
+ * @note Must be balanced by board_power_up() on wake
+ */
+void board_power_down(void)
+{
+  uint8_t i;
+  uint8_t j;
+  uint8_t used;
+  uint8_t grounded;
+  GPIO_TypeDef* port;
+
+  for (i=0; i<BOARD_NUM_PORTS; i++)
+  {
+    port = board_ports[i];
+
+    /* Save active configuration */
+    board_saved_ports[i].odr = port->ODR;
+    board_saved_ports[i].ddr = port->DDR;
+    board_saved_ports[i].cr1 = port->CR1;
+    board_saved_ports[i].cr2 = port->CR2;
+
+    used = (port == RESERVED_PORT) ? RESERVED_PINS : 0;
+
+    for (j=0; j<BOARD_POWER_TABLE_SIZE; j++)
+    {
+      if (board_power_table[j].port != port)
+      {
+        continue;
+      }
+
+      used |= board_power_table[j].pins;
+
+      if (board_power_table[j].mode == GPIO_Mode_In_PU_IT)
+      {
+        /* Wake sources, stop pull-ups on pins already shorted to ground */
+        grounded = (uint8_t)(~port->IDR & board_power_table[j].pins);
+        if (grounded != 0)
+        {
+          GPIO_Init(port, grounded, GPIO_Mode_In_FL_No_IT);
+        }
+        if ((board_power_table[j].pins & (uint8_t)~grounded) != 0)
+        {
+          GPIO_Init(port, (uint8_t)(board_power_table[j].pins & (uint8_t)~grounded), GPIO_Mode_In_PU_IT);
+        }
+      }
+      else
+      {
+        GPIO_Init(port, board_power_table[j].pins, board_power_table[j].mode);
+      }
+    }
+
+    /* Drive all unclaimed pins low */
+    if ((uint8_t)~used != 0)
+    {
+      GPIO_Init(port, (uint8_t)~used, BOARD_UNUSED_PIN_MODE);
+    }
+  }
+}
+
+/**
+ * @brief Restore pin configuration saved by board_power_down()
+ */
+void board_power_up(void)
+{
+  uint8_t i;
+  GPIO_TypeDef* port;
+
+  for (i=0; i<BOARD_NUM_PORTS; i++)
+  {
+    port = board_ports[i];
+
+    /* Output levels first so outputs come back glitch free, interrupts last so no spurious edges are latched */
+    port->ODR = board_saved_ports[i].odr;
+    port->CR1 = board_saved_ports[i].cr1;
+    port->DDR = board_saved_ports[i].ddr;
+    port->CR2 = board_saved_ports[i].cr2;
+  }
+}
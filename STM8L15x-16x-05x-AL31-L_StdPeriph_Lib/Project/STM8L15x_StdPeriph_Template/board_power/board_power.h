@@ -0,0 +1,62 @@
+/**
+ * @file board_power.h
+ * @brief Function prototypes, defines and types for board level low power pin configuration
+ */
+
+#ifndef BOARD_POWER_H_
+#define BOARD_POWER_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_gpio.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Number of GPIO ports bonded out on the STM8L151C3 (ports A to F) */
+#define BOARD_NUM_PORTS 6
+
+/* Mode applied to any pin not claimed in the power down table */
+#define BOARD_UNUSED_PIN_MODE GPIO_Mode_Out_PP_Low_Slow
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Power down configuration for a group of pins on one port
+ */
+typedef struct
+{
+  GPIO_TypeDef* port;
+
+  uint8_t pins;
+
+  GPIO_Mode_TypeDef mode;
+
+} board_pin_cfg_t;
+
+/**
+ * @brief Active configuration of a port, saved on power down and restored on wake
+ */
+typedef struct
+{
+  uint8_t odr;
+
+  uint8_t ddr;
+
+  uint8_t cr1;
+
+  uint8_t cr2;
+
+} board_port_state_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void board_power_down(void);
+void board_power_up(void);
+
+#endif /* BOARD_POWER_H_ */
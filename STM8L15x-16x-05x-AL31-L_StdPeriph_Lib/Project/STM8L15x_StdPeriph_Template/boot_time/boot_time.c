@@ -0,0 +1,55 @@
+/**
+ * @file boot_time.c
+ * @brief Boot time measurement, the profiling timestamp (TIM1) started at the start of main() is read once the
+ * device is ready for input
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "boot_time.h"
+#include "uart.h"
+
+#ifdef STM8_BASEBAND
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Get the boot time
+ * @retval Microseconds since profile_init(), which runs right after the SYSCLK divider is set
+ * @note Startup code (.data/.bss init, RAM code copy) before main() is not included
+*/
+uint32_t boot_time_get(void)
+{
+  return profile_now() / PROFILE_TICKS_PER_US;
+}
+
+/**
+ * @brief Print boot time to host PC
+ * @param us: Boot time in microseconds (saturates at 999999)
+*/
+void boot_time_print(uint32_t us)
+{
+  char out[BOOT_TIME_PRINT_SIZE];
+  const char header[] = "Boot time (us): ";
+  const char newline[] = "\r\n";
+  uint8_t i;
+
+  if (us > 999999UL)
+  {
+    us = 999999UL;
+  }
+
+  for (i=BOOT_TIME_PRINT_SIZE - 1; i>0; i--)
+  {
+    out[i - 1] = (char)((us % 10) + 48);
+    us /= 10;
+  }
+  out[BOOT_TIME_PRINT_SIZE - 1] = '\0';
+
+  tiny_print(header, ARR_SIZE(header));
+  tiny_print(out, BOOT_TIME_PRINT_SIZE);
+  tiny_print(newline, ARR_SIZE(newline));
+}
+#endif /* STM8_BASEBAND */
@@ -0,0 +1,29 @@
+/**
+ * @file boot_time.h
+ * @brief Function prototypes and defines for boot time measurement (baseband board only)
+ */
+
+#ifndef BOOT_TIME_H_
+#define BOOT_TIME_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "profile.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Output data string buffer size (6 digits + NULL) */
+#define BOOT_TIME_PRINT_SIZE 7
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+#ifdef STM8_BASEBAND
+uint32_t boot_time_get(void);
+void boot_time_print(uint32_t us);
+#endif /* STM8_BASEBAND */
+
+#endif /* BOOT_TIME_H_ */
@@ -0,0 +1,235 @@
+/**
+ * @file cathode.c
+ * @brief Cathode poisoning prevention, cathodes left unlit while others are shown slowly lose emission
+ *
+ * The RTC wakeup timer (LSI clocked, keeps running in HALT) wakes the watch every CATHODE_PERIOD_S. The state
+ * machine batches the wake with the other periodic work and, if some cathodes fell behind in lifetime lit time
+ * (usage package), plays one sequence lighting each of them for CATHODE_EXERCISE_MS, so the HV supply is brought
+ * up once per wake.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "cathode.h"
+#include "periph_clk.h"
+#include "stm8l15x_tim2.h"
+#include "usage.h"
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static uint16_t cathode_synch_prediv(void);
+static bool cathode_wait_wakeup(void);
+static uint8_t cathode_pick(uint8_t tube, uint8_t* picks);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Start the RTC wakeup timer, should be called once at startup before interrupts are enabled
+ * @note The RTC clock stays enabled, the wakeup timer has to keep counting between wakes. The calendar prescaler is
+ *       trimmed to the measured LSI frequency (within 1 / (2 * (CATHODE_RTC_SYNCH_PREDIV + 1)), about 2 min/day).
+ */
+void cathode_init(void)
+{
+  RTC_InitTypeDef rtc_init;
+  uint32_t polls = 0;
+
+  periph_clk_acquire(CLK_Peripheral_RTC);
+
+  CLK_LSICmd(ENABLE);
+  while ((CLK_GetFlagStatus(CLK_FLAG_LSIRDY) == RESET) && (polls < CATHODE_READY_POLLS))
+  {
+    polls++;
+  }
+  CLK_RTCClockConfig(CLK_RTCCLKSource_LSI, CLK_RTCCLKDiv_1);
+
+  rtc_init.RTC_HourFormat = RTC_HourFormat_24;
+  rtc_init.RTC_AsynchPrediv = CATHODE_RTC_ASYNCH_PREDIV;
+  rtc_init.RTC_SynchPrediv = cathode_synch_prediv();
+  RTC_Init(&rtc_init);
+
+  /* Counter can only be written while the wakeup timer is stopped */
+  RTC_WakeUpCmd(DISABLE);
+  RTC_WakeUpClockConfig(RTC_WakeUpClock_CK_SPRE_16bits);
+  RTC_SetWakeUpCounter((uint16_t)(CATHODE_PERIOD_S - 1));
+  RTC_ITConfig(RTC_IT_WUT, ENABLE);
+  RTC_WakeUpCmd(ENABLE);
+}
+
+/**
+ * @brief Acknowledge a scheduled wake, called from the RTC interrupt
+ * @retval TRUE if the wakeup timer elapsed
+ */
+bool cathode_wakeup(void)
+{
+  if (RTC_GetITStatus(RTC_IT_WUT) == RESET)
+  {
+    return FALSE;
+  }
+
+  RTC_ClearITPendingBit(RTC_IT_WUT);
+
+  return TRUE;
+}
+
+/**
+ * @brief Render the exercise sequence, the least used cathodes of every tube lit together, one per step
+ * @retval TRUE if a cathode is under-used and the sequence was rendered, FALSE if there is nothing to play
+ * @note Must not be called while the sequencer is running, cathodes beyond DISPLAY_MAX_STEPS wait for the next wake
+ */
+bool cathode_render(void)
+{
+  uint8_t picks[DISPLAY_NUM_TUBES][DISPLAY_MAX_STEPS];
+  uint8_t num_picks[DISPLAY_NUM_TUBES];
+  uint8_t digits[DISPLAY_NUM_TUBES];
+  uint8_t num_steps = 0;
+  uint8_t i;
+  uint8_t t;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    num_picks[t] = cathode_pick(t, picks[t]);
+    if (num_picks[t] > num_steps)
+    {
+      num_steps = num_picks[t];
+    }
+  }
+
+  if (num_steps == 0)
+  {
+    return FALSE;
+  }
+
+  display_clear();
+  for (i=0; i<num_steps; i++)
+  {
+    for (t=0; t<DISPLAY_NUM_TUBES; t++)
+    {
+      digits[t] = (i < num_picks[t]) ? picks[t][i] : DISPLAY_BLANK;
+    }
+    display_add_step(digits, CATHODE_EXERCISE_MS);
+  }
+
+  return TRUE;
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Measure the LSI against fMASTER, the time of CATHODE_LSI_COUNTS wakeup timer counts of RTCCLK / 2 is taken
+ * with TIM2 between two wakeup events (the first one is only a reference, the counter starts some RTCCLK cycles late)
+ * @retval Synchronous prescaler for a 1 Hz ck_spre, CATHODE_RTC_SYNCH_PREDIV if the LSI did not run
+ * @note TIM2 is free until the first display sequence, which configures it again
+ */
+static uint16_t cathode_synch_prediv(void)
+{
+  uint16_t start;
+  uint16_t ticks = 0;
+  uint32_t lsi_hz;
+
+  periph_clk_acquire(CLK_Peripheral_TIM2);
+  TIM2_TimeBaseInit(CATHODE_LSI_TIM_PRESCALER, TIM2_CounterMode_Up, 0xFFFF);
+  TIM2_Cmd(ENABLE);
+
+  RTC_WakeUpCmd(DISABLE);
+  RTC_WakeUpClockConfig(RTC_WakeUpClock_RTCCLK_Div2);
+  RTC_SetWakeUpCounter((uint16_t)(CATHODE_LSI_COUNTS - 1));
+  RTC_WakeUpCmd(ENABLE);
+
+  if (cathode_wait_wakeup() != FALSE)
+  {
+    start = TIM2_GetCounter();
+    if (cathode_wait_wakeup() != FALSE)
+    {
+      ticks = (uint16_t)(TIM2_GetCounter() - start);
+    }
+  }
+
+  /* An event after the last poll must not reach the RTC interrupt once it is enabled */
+  RTC_WakeUpCmd(DISABLE);
+  RTC_ClearFlag(RTC_FLAG_WUTF);
+  TIM2_Cmd(DISABLE);
+  periph_clk_release(CLK_Peripheral_TIM2);
+
+  if (ticks == 0)
+  {
+    return CATHODE_RTC_SYNCH_PREDIV;
+  }
+
+  /* LSI cycles counted, over their time in TIM2 ticks, rounded to the nearest prescaler */
+  lsi_hz = ((uint32_t)(2 * CATHODE_LSI_COUNTS) * (CLK_GetClockFreq() >> CATHODE_LSI_TIM_SHIFT)) / ticks;
+
+  return (uint16_t)(((lsi_hz + ((CATHODE_RTC_ASYNCH_PREDIV + 1) / 2)) / (CATHODE_RTC_ASYNCH_PREDIV + 1)) - 1);
+}
+
+/**
+ * @brief Wait for the next wakeup timer event and acknowledge it
+ * @retval TRUE on the event, FALSE if it did not come within CATHODE_READY_POLLS polls
+ */
+static bool cathode_wait_wakeup(void)
+{
+  uint32_t polls;
+
+  for (polls=0; polls<CATHODE_READY_POLLS; polls++)
+  {
+    if (RTC_GetFlagStatus(RTC_FLAG_WUTF) != RESET)
+    {
+      RTC_ClearFlag(RTC_FLAG_WUTF);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+ * @brief Select the under-used cathodes of a tube, least used first
+ * @param tube: Tube index in step digit order
+ * @param picks: Selected digits, room for DISPLAY_MAX_STEPS
+ * @retval Number of digits selected
+ */
+static uint8_t cathode_pick(uint8_t tube, uint8_t* picks)
+{
+  uint32_t lit[NUM_NIXIE_DIGITS];
+  uint32_t limit = 0;
+  uint8_t num_picks;
+  uint8_t least;
+  uint8_t d;
+
+  for (d=0; d<NUM_NIXIE_DIGITS; d++)
+  {
+    lit[d] = usage_lit_time(tube, d);
+    if (lit[d] > limit)
+    {
+      limit = lit[d];
+    }
+  }
+  limit >>= CATHODE_UNDERUSED_SHIFT;
+
+  for (num_picks=0; num_picks<DISPLAY_MAX_STEPS; num_picks++)
+  {
+    least = NUM_NIXIE_DIGITS;
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      if ((lit[d] < limit) && ((least == NUM_NIXIE_DIGITS) || (lit[d] < lit[least])))
+      {
+        least = d;
+      }
+    }
+    if (least == NUM_NIXIE_DIGITS)
+    {
+      break;
+    }
+
+    picks[num_picks] = least;
+    /* Taken */
+    lit[least] = limit;
+  }
+
+  return num_picks;
+}
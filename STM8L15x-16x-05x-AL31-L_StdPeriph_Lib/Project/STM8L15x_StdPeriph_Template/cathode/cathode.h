@@ -0,0 +1,54 @@
+/**
+ * @file cathode.h
+ * @brief Function prototypes and defines for cathode poisoning prevention, under-used cathodes are lit on a
+ * scheduled RTC wakeup
+ */
+
+#ifndef CATHODE_H_
+#define CATHODE_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_rtc.h"
+#include "display.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Time between scheduled wakes in s (1-65536), RTC wakeup timer clocked at 1 Hz */
+#ifndef CATHODE_PERIOD_S
+#define CATHODE_PERIOD_S 43200UL
+#endif /* CATHODE_PERIOD_S */
+
+/* Time each under-used cathode is lit per wake, in ms (1-1000) */
+#ifndef CATHODE_EXERCISE_MS
+#define CATHODE_EXERCISE_MS 1000
+#endif /* CATHODE_EXERCISE_MS */
+
+/* A cathode is under-used while its lit time is below the most used cathode of its tube >> CATHODE_UNDERUSED_SHIFT */
+#define CATHODE_UNDERUSED_SHIFT 2
+
+/* RTC clocked from the LSI (~38 kHz), 38000 / (124 + 1) / (303 + 1) = 1 Hz calendar clock (ck_spre). The LSE pins
+   (PC5/PC6) drive tube A cathodes on the watch, so the synchronous prescaler is set from the LSI frequency measured at
+   boot instead, the nominal value is kept if the measurement fails. */
+#define CATHODE_RTC_ASYNCH_PREDIV 124
+#define CATHODE_RTC_SYNCH_PREDIV 303
+
+/* LSI measurement, CATHODE_LSI_COUNTS wakeup timer counts of RTCCLK / 2 (~13 ms) timed by TIM2 at fMASTER / 16 */
+#define CATHODE_LSI_COUNTS 256
+#define CATHODE_LSI_TIM_PRESCALER TIM2_Prescaler_16
+#define CATHODE_LSI_TIM_SHIFT 4
+
+/* Status polls before an oscillator start or a wakeup timer count is given up */
+#define CATHODE_READY_POLLS 200000UL
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void cathode_init(void);
+bool cathode_wakeup(void);
+bool cathode_render(void);
+
+#endif /* CATHODE_H_ */
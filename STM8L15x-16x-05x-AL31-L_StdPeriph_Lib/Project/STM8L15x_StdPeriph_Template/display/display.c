@@ -0,0 +1,437 @@
+/**
+ * @file display.c
+ * @brief Time renderer and display sequencer, a time value is turned into a table of display steps once per
+ * wake and TIM2 update interrupts walk the table without blocking the main loop
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "display.h"
+#include "periph_clk.h"
+#include "usage.h"
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Tubes in step digit order, most significant digit first */
+static const nixie_tube_t* const display_tubes[DISPLAY_NUM_TUBES] = {
+  &tube_A,
+  #ifndef STM8_BASEBAND
+  &tube_B
+  #endif /* !STM8_BASEBAND */
+};
+
+static const uint8_t display_blank[DISPLAY_NUM_TUBES] = {
+  DISPLAY_BLANK,
+  #ifndef STM8_BASEBAND
+  DISPLAY_BLANK
+  #endif /* !STM8_BASEBAND */
+};
+
+/* Rendered sequence */
+static display_step_t display_steps[DISPLAY_MAX_STEPS];
+static uint8_t display_num_steps = 0;
+
+/* Sequencer state, owned by the TIM2 update interrupt while running */
+static volatile bool display_running = FALSE;
+static uint8_t display_step = 0;
+static uint16_t display_remaining = 0; /* Ticks of the current step not yet scheduled */
+static bool display_lit = FALSE; /* Current step digits shown (dimmed steps alternate) */
+static uint16_t display_on_ticks = 0;
+static uint16_t display_off_ticks = 0;
+static uint8_t display_shown[DISPLAY_NUM_TUBES]; /* Digit lit on each tube */
+static bool display_breaking = FALSE; /* Switching tubes blanked, the current step digits are shown next */
+static volatile bool display_warming = FALSE; /* TIM2 timing the HV supply warm-up, owned by its interrupt */
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void display_timer_stop(void);
+static uint16_t display_next_phase(void);
+static bool display_break(const uint8_t* digits);
+static void display_show(const uint8_t* digits);
+static void display_account(void);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Render a time into the display sequence, HH then MM split over the tubes
+ *
+ * With one tube each digit is shown on its own, separated by DISPLAY_DIGIT_GAP_MS. With two tubes a field is
+ * shown at once. Fields are separated by DISPLAY_FIELD_GAP_MS.
+ *
+ * @param hours: Hours (0-23)
+ * @param minutes: Minutes (0-59)
+ * @param digit_ms: Time each digit is lit, in ms (1-1000)
+ * @note Must not be called while the sequencer is running
+ */
+void display_render_time(uint8_t hours, uint8_t minutes, uint16_t digit_ms)
+{
+  uint8_t digits[DISPLAY_NUM_DIGITS];
+  uint8_t i;
+  uint16_t gap_ms;
+
+  digits[0] = (uint8_t)(hours / 10);
+  digits[1] = (uint8_t)(hours % 10);
+  digits[2] = (uint8_t)(minutes / 10);
+  digits[3] = (uint8_t)(minutes % 10);
+
+  display_clear();
+
+  for (i=0; i<DISPLAY_NUM_DIGITS; i+=DISPLAY_NUM_TUBES)
+  {
+    /* Gap before every lit step but the first, longer where a new field starts */
+    if (i != 0)
+    {
+      gap_ms = ((i % DISPLAY_FIELD_DIGITS) == 0) ? DISPLAY_FIELD_GAP_MS : DISPLAY_DIGIT_GAP_MS;
+      if (gap_ms != 0)
+      {
+        display_add_step(display_blank, gap_ms);
+      }
+    }
+
+    display_add_step(&digits[i], digit_ms);
+  }
+}
+
+/**
+ * @brief Empty the display sequence
+ * @note Must not be called while the sequencer is running
+ */
+void display_clear(void)
+{
+  display_num_steps = 0;
+}
+
+/**
+ * @brief Append a step to the display sequence
+ * @param digits: Digit per tube, 0-9 or DISPLAY_BLANK
+ * @param ms: Step duration, in ms (1-1000)
+ * @retval TRUE if added, FALSE if the sequence already holds DISPLAY_MAX_STEPS steps
+ * @note Must not be called while the sequencer is running
+ */
+bool display_add_step(const uint8_t* digits, uint16_t ms)
+{
+  display_step_t* step;
+  uint8_t t;
+
+  if (display_num_steps == DISPLAY_MAX_STEPS)
+  {
+    return FALSE;
+  }
+
+  step = &display_steps[display_num_steps++];
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    step->digits[t] = digits[t];
+  }
+  step->ticks = DISPLAY_MS_TO_TICKS(ms);
+
+  return TRUE;
+}
+
+/**
+ * @brief Time the HV supply warm-up on TIM2, returns immediately
+ * @param ticks: Supply rise time in timer ticks (0 for none)
+ * @note Call right after the power supply is enabled. A sequence started before the warm-up ends shows its first
+ * step when it ends, the time in between can be used to prepare what is shown.
+ */
+void display_warmup(uint16_t ticks)
+{
+  if ((display_running != FALSE) || (display_warming != FALSE) || (ticks == 0))
+  {
+    return;
+  }
+
+  display_warming = TRUE;
+
+  periph_clk_acquire(CLK_Peripheral_TIM2);
+
+  TIM2_TimeBaseInit(DISPLAY_TIM_PRESCALER, TIM2_CounterMode_Up, (uint16_t)(ticks - 1));
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+  TIM2_ITConfig(TIM2_IT_Update, ENABLE);
+  TIM2_Cmd(ENABLE);
+}
+
+/**
+ * @brief Start playing the rendered sequence, returns immediately
+ * @param on_ticks: Lit time per PWM cycle while a digit is shown, in timer ticks
+ * @param off_ticks: Blanked time per PWM cycle, 0 for full brightness
+ * @note Power supply must be enabled, display_tick() must be called from the TIM2 update interrupt. The first
+ * step is shown now, or at the end of a display_warmup() in progress. The lit time of the whole sequence is added
+ * to the usage counters here, sequences are always played to the end.
+ */
+void display_start(uint16_t on_ticks, uint16_t off_ticks)
+{
+  uint8_t t;
+
+  if ((display_running != FALSE) || (display_num_steps == 0))
+  {
+    return;
+  }
+
+  /* Tubes may still show the last frame of an animation */
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    display_shown[t] = *display_tubes[t]->curr_digit;
+  }
+  display_on_ticks = on_ticks;
+  display_off_ticks = off_ticks;
+  display_account();
+  display_step = 0;
+  display_remaining = display_steps[0].ticks;
+  display_lit = FALSE;
+  display_breaking = FALSE;
+
+  /* Hand the sequence to the warm-up interrupt, masked so it cannot end the warm-up in between */
+  if (display_warming != FALSE)
+  {
+    TIM2_ITConfig(TIM2_IT_Update, DISABLE);
+    if (display_warming != FALSE)
+    {
+      display_running = TRUE;
+      TIM2_ITConfig(TIM2_IT_Update, ENABLE);
+      return;
+    }
+  }
+
+  display_running = TRUE;
+
+  periph_clk_acquire(CLK_Peripheral_TIM2);
+
+  /* First step is shown now, the update event ends it */
+  TIM2_TimeBaseInit(DISPLAY_TIM_PRESCALER, TIM2_CounterMode_Up, display_next_phase());
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+  TIM2_ITConfig(TIM2_IT_Update, ENABLE);
+  TIM2_Cmd(ENABLE);
+}
+
+/**
+ * @brief Advance the sequence, called from the TIM2 update interrupt
+ * @retval TRUE if the sequence has just finished (tubes blanked, timer stopped)
+ */
+bool display_tick(void)
+{
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+
+  /* Supply is up, show the first step if the sequence is ready, display_start() runs the timer otherwise */
+  if (display_warming != FALSE)
+  {
+    display_warming = FALSE;
+    if (display_running == FALSE)
+    {
+      display_timer_stop();
+    }
+    else
+    {
+      TIM2_SetAutoreload(display_next_phase());
+    }
+    return FALSE;
+  }
+
+  if (display_running == FALSE)
+  {
+    return FALSE;
+  }
+
+  if (display_remaining == 0)
+  {
+    display_step++;
+    if (display_step == display_num_steps)
+    {
+      display_stop();
+      return TRUE;
+    }
+    display_remaining = display_steps[display_step].ticks;
+    display_lit = FALSE;
+  }
+
+  TIM2_SetAutoreload(display_next_phase());
+
+  return FALSE;
+}
+
+/**
+ * @brief Stop the sequence and blank every tube
+ * @note Call before the power supply is disabled, digits cannot be switched off without it
+ */
+void display_stop(void)
+{
+  if ((display_running == FALSE) && (display_warming == FALSE))
+  {
+    return;
+  }
+
+  display_timer_stop();
+
+  display_show(display_blank);
+  display_running = FALSE;
+  display_warming = FALSE;
+}
+
+/**
+ * @brief Check if a sequence is playing
+ * @retval TRUE until the last step has ended or display_stop() is called
+ */
+bool display_busy(void)
+{
+  return display_running;
+}
+
+/**
+ * @brief Check if TIM2 is free for another user
+ * @retval TRUE if neither a sequence nor the HV supply warm-up is running
+ */
+bool display_idle(void)
+{
+  return ((display_running == FALSE) && (display_warming == FALSE)) ? TRUE : FALSE;
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Stop TIM2 and drop its clock
+ */
+static void display_timer_stop(void)
+{
+  TIM2_ITConfig(TIM2_IT_Update, DISABLE);
+  TIM2_Cmd(DISABLE);
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+  periph_clk_release(CLK_Peripheral_TIM2);
+}
+
+/**
+ * @brief Show the current step (or blank it for the off part of a dimmed cycle) and schedule the next update
+ * @retval Auto-reload value ending this phase
+ */
+static uint16_t display_next_phase(void)
+{
+  uint16_t interval = display_remaining;
+  const uint8_t* digits = display_steps[display_step].digits;
+
+  if ((display_lit == FALSE) || (display_off_ticks == 0))
+  {
+    /* Old digits off now, new digits on at the next update */
+    if ((display_breaking == FALSE) && (DISPLAY_SWITCH_TICKS != 0) && (interval > DISPLAY_SWITCH_TICKS) &&
+        display_break(digits))
+    {
+      display_breaking = TRUE;
+      interval = DISPLAY_SWITCH_TICKS;
+      display_remaining -= interval;
+
+      return (uint16_t)(interval - 1);
+    }
+
+    display_breaking = FALSE;
+    display_show(digits);
+    display_lit = TRUE;
+    if ((display_off_ticks != 0) && (display_on_ticks < interval))
+    {
+      interval = display_on_ticks;
+    }
+  }
+  else
+  {
+    display_show(display_blank);
+    display_lit = FALSE;
+    if (display_off_ticks < interval)
+    {
+      interval = display_off_ticks;
+    }
+  }
+
+  display_remaining -= interval;
+
+  return (uint16_t)(interval - 1);
+}
+
+/**
+ * @brief Blank the tubes that would switch from one digit straight to another
+ * @param digits: Digit per tube about to be shown, 0-9 or DISPLAY_BLANK
+ * @retval TRUE if any tube was blanked
+ */
+static bool display_break(const uint8_t* digits)
+{
+  uint8_t next[DISPLAY_NUM_TUBES];
+  uint8_t t;
+  bool switching = FALSE;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    next[t] = display_shown[t];
+    if ((display_shown[t] != DISPLAY_BLANK) && (digits[t] != DISPLAY_BLANK) && (digits[t] != display_shown[t]))
+    {
+      next[t] = DISPLAY_BLANK;
+      switching = TRUE;
+    }
+  }
+
+  if (switching)
+  {
+    display_show(next);
+  }
+
+  return switching;
+}
+
+/**
+ * @brief Switch the tubes whose digit changes, the old digit is always turned off before the new one is driven
+ * @param digits: Digit per tube, 0-9 or DISPLAY_BLANK
+ */
+static void display_show(const uint8_t* digits)
+{
+  uint8_t t;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    if (digits[t] == display_shown[t])
+    {
+      continue;
+    }
+
+    if (display_shown[t] != DISPLAY_BLANK)
+    {
+      nixie_digit_control(display_tubes[t], display_shown[t], DIGIT_OFF, &shared_psu);
+    }
+    if (digits[t] != DISPLAY_BLANK)
+    {
+      nixie_digit_control(display_tubes[t], digits[t], DIGIT_ON, &shared_psu);
+    }
+    display_shown[t] = digits[t];
+  }
+}
+
+/**
+ * @brief Add the lit time of the rendered sequence to the usage counters, dimmed steps count their duty only
+ */
+static void display_account(void)
+{
+  uint8_t i;
+  uint8_t t;
+  uint32_t ticks;
+  uint16_t units;
+
+  for (i=0; i<display_num_steps; i++)
+  {
+    ticks = display_steps[i].ticks;
+    if (display_off_ticks != 0)
+    {
+      ticks = (ticks * display_on_ticks) / ((uint32_t)display_on_ticks + display_off_ticks);
+    }
+    units = (uint16_t)(ticks >> DISPLAY_LIT_SHIFT);
+
+    for (t=0; t<DISPLAY_NUM_TUBES; t++)
+    {
+      if (display_steps[i].digits[t] != DISPLAY_BLANK)
+      {
+        usage_add(t, display_steps[i].digits[t], units);
+      }
+    }
+  }
+}
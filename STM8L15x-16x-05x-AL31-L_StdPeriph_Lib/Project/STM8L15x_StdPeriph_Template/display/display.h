@@ -0,0 +1,90 @@
+/**
+ * @file display.h
+ * @brief Function prototypes, defines and types for the time renderer and the TIM2 driven display sequencer
+ */
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_tim2.h"
+#include "nixie.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Tubes driven by the sequencer, the breakout board mounts tube A only */
+#ifdef STM8_BASEBAND
+#define DISPLAY_NUM_TUBES 1
+#else
+#define DISPLAY_NUM_TUBES 2
+#endif /* STM8_BASEBAND */
+
+/* Time is shown as two fields (HH then MM) of two digits, split over the tubes */
+#define DISPLAY_NUM_FIELDS 2
+#define DISPLAY_FIELD_DIGITS 2
+#define DISPLAY_NUM_DIGITS (DISPLAY_NUM_FIELDS * DISPLAY_FIELD_DIGITS)
+
+/* Blank time between digits of a field shown one after the other, and between HH and MM, in ms (0 for none) */
+#ifndef DISPLAY_DIGIT_GAP_MS
+#define DISPLAY_DIGIT_GAP_MS 50
+#endif /* DISPLAY_DIGIT_GAP_MS */
+#ifndef DISPLAY_FIELD_GAP_MS
+#define DISPLAY_FIELD_GAP_MS 250
+#endif /* DISPLAY_FIELD_GAP_MS */
+
+/* Break before make: a tube switching from one digit straight to another is blanked for this long first (timer
+   driven, taken from the new digit's step) so the old cathode stops conducting before the new one is driven, in
+   us (0 for none). The timer runs one tick longer, covering the handler time before the old digit is switched off. */
+#ifndef DISPLAY_SWITCH_BLANK_US
+#define DISPLAY_SWITCH_BLANK_US 160
+#endif /* DISPLAY_SWITCH_BLANK_US */
+
+/* Every digit lit and every gap blanked, one tube shows a field in DISPLAY_FIELD_DIGITS steps */
+#define DISPLAY_MAX_STEPS ((2 * DISPLAY_NUM_DIGITS) - 1)
+
+/* Tube left off during a step */
+#define DISPLAY_BLANK 0xFF
+
+/* Step timer, TIM2 at SYSCLK / 128 = 62.5kHz (16us per tick), longest step ~1s */
+#define DISPLAY_TIM_PRESCALER TIM2_Prescaler_128
+#define DISPLAY_US_PER_TICK 16
+#define DISPLAY_MS_TO_TICKS(ms) ((uint16_t)(((uint32_t)(ms) * 1000) / DISPLAY_US_PER_TICK))
+#define DISPLAY_US_TO_TICKS(us) ((uint16_t)((us) / DISPLAY_US_PER_TICK))
+#define DISPLAY_SWITCH_TICKS ((DISPLAY_SWITCH_BLANK_US != 0) ? (DISPLAY_US_TO_TICKS(DISPLAY_SWITCH_BLANK_US) + 1) : 0)
+
+/* Lit time per cathode is handed to the usage counters in units of 2^DISPLAY_LIT_SHIFT timer ticks (~1ms) */
+#define DISPLAY_LIT_SHIFT 6
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief One display step, digit per tube held for a number of timer ticks
+ */
+typedef struct
+{
+  uint8_t digits[DISPLAY_NUM_TUBES]; /* 0-9 or DISPLAY_BLANK */
+
+  uint16_t ticks;
+
+} display_step_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void display_render_time(uint8_t hours, uint8_t minutes, uint16_t digit_ms);
+void display_clear(void);
+bool display_add_step(const uint8_t* digits, uint16_t ms);
+void display_warmup(uint16_t ticks);
+void display_start(uint16_t on_ticks, uint16_t off_ticks);
+bool display_tick(void);
+void display_stop(void);
+bool display_busy(void);
+bool display_idle(void);
+
+#endif /* DISPLAY_H_ */
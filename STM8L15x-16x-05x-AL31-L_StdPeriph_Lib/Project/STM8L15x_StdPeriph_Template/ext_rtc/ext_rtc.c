@@ -11,28 +11,57 @@
 #include "stm8l15x_clk.h"
 
 #include "hardwaredefs.h"
+#include "periph_clk.h"
 #include "ext_rtc.h"
 #include "uart.h"
 
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Set once I2C and the RTC have been configured, done on first transaction to keep boot short */
+static bool ext_rtc_ready = FALSE;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void ext_rtc_lazy_init(void);
+static void ext_rtc_release(void);
+
 /******************************************************************************/
 /*                       P U B L I C  F U N C T I O N S                       */
 /******************************************************************************/
 
+/**
+ * @brief Configure I2C and start the RTC if its oscillator is halted
+ * @note Called automatically on first read/write, only needs to be called explicitly to start the RTC early
+*/
 void ext_rtc_init(void)
 {
-  /* Enable I2C module */
-  CLK_PeripheralClockConfig(CLK_Peripheral_I2C1, ENABLE);
+  uint8_t secs;
+
+  /* Set first, the register writes below go through ext_rtc_write() */
+  ext_rtc_ready = TRUE;
+
+  /* Enable I2C module, clock is held until the initial register writes are complete */
+  periph_clk_acquire(CLK_Peripheral_I2C1);
   I2C_Init(I2C1, I2C_SPEED, I2C_OWN_ADDRESS, I2C_Mode_I2C, I2C_DutyCycle_2, I2C_Ack_Enable, I2C_AcknowledgedAddress_7bit);
   I2C_Cmd(I2C1, ENABLE);
 
   /* Configure I2C GPIO to HiZ (board has external 10k pullups) */
-  GPIO_Init(GPIOC, GPIO_Pin_0, GPIO_Mode_Out_OD_HiZ_Fast);
-  GPIO_Init(GPIOC, GPIO_Pin_1, GPIO_Mode_Out_OD_HiZ_Fast);
+  GPIO_Init(RTC_I2C_PORT, RTC_I2C_SDA_PIN, GPIO_Mode_Out_OD_HiZ_Fast);
+  GPIO_Init(RTC_I2C_PORT, RTC_I2C_SCL_PIN, GPIO_Mode_Out_OD_HiZ_Fast);
 
-  /* Must write 0 to RTC to disable the Clock Halt bit and clear data stored in NV (seconds) */
-  ext_rtc_write(RTC_SECS_ADDR, RTC_CLEAR_NV);
-  /* Clear NV (minutes) */
-  ext_rtc_write(RTC_SECS_ADDR, RTC_CLEAR_NV);
+  /* Clock halt is only set out of a power-up without the backup cell, a running clock is left alone (writing the
+     seconds register would also reset its countdown chain) */
+  ext_rtc_read(&secs, 1);
+  if ((secs & CLOCK_HALT_BITMASK) != 0)
+  {
+    /* Must write 0 to RTC to disable the Clock Halt bit and clear data stored in NV (seconds) */
+    ext_rtc_write(RTC_SECS_ADDR, RTC_CLEAR_NV);
+  }
+
+  ext_rtc_release();
 }
 
 /**
@@ -42,6 +71,10 @@ void ext_rtc_init(void)
 */
 void ext_rtc_write(uint8_t addr, uint8_t data)
 {
+  ext_rtc_lazy_init();
+
+  periph_clk_acquire(CLK_Peripheral_I2C1);
+
   /* Generate I2C start condition */
   I2C_GenerateSTART(I2C1, ENABLE);
   while(!I2C_CheckEvent(I2C1, I2C_EVENT_MASTER_MODE_SELECT));
@@ -61,7 +94,7 @@ void ext_rtc_write(uint8_t addr, uint8_t data)
   /* Generate stop condition */
   I2C_GenerateSTOP(I2C1, ENABLE);
 
-  return;
+  ext_rtc_release();
 }
 
 /**
@@ -73,6 +106,10 @@ void ext_rtc_read(uint8_t* bytes, uint8_t len)
 {
   uint8_t i;
 
+  ext_rtc_lazy_init();
+
+  periph_clk_acquire(CLK_Peripheral_I2C1);
+
   /* Generate I2C start event, (EV5) */
   I2C_GenerateSTART(I2C1, ENABLE);
   while(!I2C_CheckEvent(I2C1, I2C_EVENT_MASTER_MODE_SELECT));
@@ -117,6 +154,8 @@ void ext_rtc_read(uint8_t* bytes, uint8_t len)
       I2C_GenerateSTOP(I2C1, ENABLE);
     }
   }
+
+  ext_rtc_release();
 }
 
 /**
@@ -131,6 +170,33 @@ uint8_t ext_rtc_decode(uint8_t val)
   return ten_ticks + ticks;
 }
 
+/**
+ * @brief Decode the BCD hours register, either clock mode
+ * @param val: Encoded RTC hours value
+ * @retval Hours (0-23)
+*/
+uint8_t ext_rtc_decode_hours(uint8_t val)
+{
+  uint8_t hours;
+
+  if ((val & HOURS_12H_BITMASK) == 0)
+  {
+    return (uint8_t)((((val & TEN_HOURS_24H_BITMASK) >> 4) * 10) + (val & SECONDS_BITMASK));
+  }
+
+  /* 12 hour mode, 12 AM is midnight */
+  hours = (uint8_t)((((val & TEN_HOURS_12H_BITMASK) >> 4) * 10) + (val & SECONDS_BITMASK));
+  if (hours == 12)
+  {
+    hours = 0;
+  }
+  if ((val & HOURS_PM_BITMASK) != 0)
+  {
+    hours += 12;
+  }
+  return hours;
+}
+
 /**
  * @brief Function to print BCD encoded RTC value to Host PC
  * @param val: Encoded RTC value
@@ -176,3 +242,32 @@ void ext_rtc_print_val(uint8_t val, print_type_t type)
     break;
   }
 }
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Configure I2C and the RTC if this is the first transaction since reset
+*/
+static void ext_rtc_lazy_init(void)
+{
+  if (ext_rtc_ready == FALSE)
+  {
+    ext_rtc_init();
+  }
+}
+
+/**
+ * @brief Release I2C clock once the stop condition has been sent
+ * @note Gating the clock while the bus is busy would leave the stop condition pending and hang the bus
+*/
+static void ext_rtc_release(void)
+{
+  /* Only the last user needs to wait for the bus to go idle */
+  if (periph_clk_users(CLK_Peripheral_I2C1) == 1)
+  {
+    while(I2C_GetFlagStatus(I2C1, I2C_FLAG_BUSY) == SET);
+  }
+  periph_clk_release(CLK_Peripheral_I2C1);
+}
@@ -18,17 +18,20 @@
 #define RTC_I2C_ADDRESS 0b11010000
 #define RTC_SECS_ADDR 0x00
 #define RTC_MINS_ADDR 0x01
+#define RTC_HOURS_ADDR 0x02
 #define RTC_CLEAR_NV 0x00
 
-/* Useful macro for reducing runtime code size */
-#define ARR_SIZE(x) (sizeof(x) / sizeof((x)[0]))
-
 /* RTC bitmasks */
+#define CLOCK_HALT_BITMASK 0b10000000
 #define TEN_SEC_BITMASK 0b01110000
 #define SECONDS_BITMASK 0b00001111
+#define HOURS_12H_BITMASK 0b01000000
+#define HOURS_PM_BITMASK 0b00100000
+#define TEN_HOURS_12H_BITMASK 0b00010000
+#define TEN_HOURS_24H_BITMASK 0b00110000
 
-/* RTC data payload read size */
-#define RTC_PAY_READ_SIZE 2
+/* RTC data payload read size (seconds, minutes, hours) */
+#define RTC_PAY_READ_SIZE 3
 
 /* Output data string buffer size */
 #define RTC_HOST_PRINT_SIZE 3
@@ -58,6 +61,7 @@ void ext_rtc_init(void);
 void ext_rtc_write(uint8_t addr, uint8_t data);
 void ext_rtc_read(uint8_t* bytes, uint8_t len);
 uint8_t ext_rtc_decode(uint8_t val);
+uint8_t ext_rtc_decode_hours(uint8_t val);
 void ext_rtc_print_val(uint8_t val, print_type_t type);
 
 #endif /* EXT_RTC_H_ */
@@ -0,0 +1,668 @@
+/**
+ * @file frame.c
+ * @brief Precomputed display frames, an animation is rendered once into output data register values for every
+ * tube port and played back at a fixed frame rate without the CPU
+ *
+ * Frames are grouped into segments, a run of frames played a number of times (a PWM cycle repeated for as long
+ * as it is shown) with its last frame optionally held longer, so the interrupts only have constant work at a
+ * frame or a segment pass and nothing is rendered while playing.
+ *
+ * On the breakout board each tube port has a DMA1 channel copying its next frame byte into the port output
+ * register on a TIM2 compare request, the CPU only wakes at the transfer complete interrupt ending a segment pass
+ * and at the TIM2 update interrupt ending a hold. The watch's tubes span more ports than TIM2 has DMA requests,
+ * there the TIM2 update interrupt writes each frame.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "frame.h"
+#include "hardwaredefs.h"
+#include "periph_clk.h"
+#include "usage.h"
+
+#ifndef NIXIE_SPI
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+#ifdef FRAME_DMA
+/**
+ * @brief DMA channel streaming the frames of one port
+ */
+typedef struct
+{
+  uint16_t odr; /* Output data register bus address (first register of the port) */
+
+  DMA_Channel_TypeDef* channel;
+
+  TIM2_DMASource_TypeDef request; /* TIM2 request served by the channel */
+
+} frame_lane_t;
+#endif /* FRAME_DMA */
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Tubes in frame digit order, most significant digit first */
+static const nixie_tube_t* const frame_tubes[DISPLAY_NUM_TUBES] = {
+  &tube_A,
+  #ifndef STM8_BASEBAND
+  &tube_B
+  #endif /* !STM8_BASEBAND */
+};
+
+/* Ports carrying tube cathodes, in frame buffer order */
+static GPIO_TypeDef* const frame_ports[FRAME_NUM_PORTS] = {
+  #ifdef STM8_BASEBAND
+  TUBE_A_PORT_0, TUBE_A_PORT_8
+  #else
+  TUBE_B_PORT_0, TUBE_A_PORT_0, TUBE_A_PORT_2, TUBE_A_PORT_4, TUBE_B_PORT_8
+  #endif /* STM8_BASEBAND */
+};
+
+#ifdef FRAME_DMA
+/* Port output registers (tube A digits 0-7, digits 8-9) and the DMA1 channel serving each TIM2 compare request */
+static const frame_lane_t frame_lanes[FRAME_NUM_PORTS] = {
+  {GPIOE_BASE, DMA1_Channel0, TIM2_DMASource_CC1},
+  {GPIOA_BASE, DMA1_Channel2, TIM2_DMASource_CC2}
+};
+
+/* Every channel ends a pass on the same request, the first one reports it */
+#define FRAME_DMA_PASS_IT DMA1_IT_TC0
+#endif /* FRAME_DMA */
+
+/* Rendered frames, one output data register value per port */
+static uint8_t frame_buf[FRAME_NUM_PORTS][FRAME_MAX_FRAMES];
+static uint8_t frame_count = 0;
+static frame_segment_t frame_segs[FRAME_MAX_SEGMENTS];
+static uint8_t frame_num_segs = 0;
+static uint8_t frame_open = 0; /* First frame not in a segment yet */
+static uint8_t frame_digits[DISPLAY_NUM_TUBES]; /* Digits of the last frame */
+static uint8_t frame_open_digits[DISPLAY_NUM_TUBES]; /* Digits of frame_open, where a repeated segment loops to */
+
+/* Playback state, owned by the frame interrupts while playing */
+static volatile bool frame_playing = FALSE;
+static uint16_t frame_period = 0;
+static uint8_t frame_seg = 0; /* Segment playing, frame_num_segs while the last frame is held */
+static uint8_t frame_passes = 0; /* Passes of the segment left, the current one included */
+#ifndef FRAME_DMA
+static uint8_t frame_next = 0; /* Next frame written by the TIM2 update interrupt */
+#endif /* !FRAME_DMA */
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static bool frame_break(const uint8_t* digits, uint8_t* next);
+static void frame_store(const uint8_t* digits);
+static void frame_close(uint8_t repeats, uint16_t hold);
+static uint8_t frame_port(GPIO_TypeDef* port);
+static uint8_t frame_mask(uint8_t port);
+static void frame_account(void);
+#ifdef FRAME_DMA
+static void frame_arm(void);
+static void frame_requests(FunctionalState state);
+#endif /* FRAME_DMA */
+static void frame_stop(void);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Empty the frame buffer, the next frame follows the digits the tubes show now
+ * @note Must not be called while frames are playing
+ */
+void frame_clear(void)
+{
+  uint8_t t;
+
+  frame_count = 0;
+  frame_num_segs = 0;
+  frame_open = 0;
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    frame_digits[t] = *frame_tubes[t]->curr_digit;
+  }
+}
+
+/**
+ * @brief Append a frame, a tube switching from one digit straight to another gets a blank frame first (break
+ * before make)
+ * @param digits: Digit per tube, 0-9 or DISPLAY_BLANK
+ * @retval TRUE if added, FALSE if the frame buffer is full
+ * @note Must not be called while frames are playing
+ */
+bool frame_add(const uint8_t* digits)
+{
+  uint8_t next[DISPLAY_NUM_TUBES];
+  bool switching;
+
+  switching = frame_break(digits, next);
+  if ((frame_count + (switching ? 2 : 1)) > FRAME_MAX_FRAMES)
+  {
+    return FALSE;
+  }
+
+  if (switching)
+  {
+    frame_store(next);
+  }
+  frame_store(digits);
+
+  return TRUE;
+}
+
+/**
+ * @brief Play the frames added since the last segment a number of times, a switch from the last frame back to
+ * the first gets a blank frame at the end
+ * @param count: Passes over the frames (1-255)
+ * @retval TRUE if added, FALSE if no frame was added since the last segment or the buffers are full
+ * @note Must not be called while frames are playing
+ */
+bool frame_repeat(uint8_t count)
+{
+  uint8_t next[DISPLAY_NUM_TUBES];
+
+  /* One segment is kept for the frames frame_play() closes */
+  if ((frame_count == frame_open) || (count == 0) || ((frame_num_segs + 1) >= FRAME_MAX_SEGMENTS))
+  {
+    return FALSE;
+  }
+
+  if ((count > 1) && frame_break(frame_open_digits, next))
+  {
+    if (frame_count == FRAME_MAX_FRAMES)
+    {
+      return FALSE;
+    }
+    frame_store(next);
+  }
+
+  frame_close(count, 0);
+
+  return TRUE;
+}
+
+/**
+ * @brief Keep the last frame on for longer, the frames added since the last segment are played once
+ * @param ticks: Display timer ticks on top of the frame period, rounded up to one frame period
+ * @retval TRUE if added, FALSE if there is no frame or the buffers are full
+ * @note Must not be called while frames are playing
+ */
+bool frame_hold(uint16_t ticks)
+{
+  frame_segment_t* seg;
+
+  /* Nothing added since the last segment, its last frame is held */
+  if (frame_count == frame_open)
+  {
+    if (frame_num_segs == 0)
+    {
+      return FALSE;
+    }
+    seg = &frame_segs[frame_num_segs - 1];
+    seg->hold = (ticks > (uint16_t)(0xFFFF - seg->hold)) ? 0xFFFF : (uint16_t)(seg->hold + ticks);
+    return TRUE;
+  }
+
+  if ((frame_num_segs + 1) >= FRAME_MAX_SEGMENTS)
+  {
+    return FALSE;
+  }
+
+  frame_close(1, ticks);
+
+  return TRUE;
+}
+
+/**
+ * @brief Start playing the frame buffer, returns immediately
+ * @param period_ticks: Frame period in display timer ticks, at least DISPLAY_SWITCH_TICKS
+ * @retval TRUE if started, FALSE if empty, already playing, TIM2 is in use by the display sequencer or the power
+ * supply is disabled
+ * @note Frames are written one period apart starting one period from now, the last frame is left on the pins and
+ * the tubes' digits follow it. Frames added since the last segment are played once. Pins of the tube ports that
+ * are not cathodes keep their current level and must not be changed until the end is reported by frame_tick() or
+ * frame_dma_tick(). The lit time of the whole animation is added to the usage counters here.
+ */
+bool frame_play(uint16_t period_ticks)
+{
+  uint8_t p;
+  uint8_t i;
+  uint8_t mask;
+  uint8_t base;
+
+  if ((frame_playing != FALSE) || (frame_count == 0) || (display_idle() == FALSE) ||
+      (*shared_psu.psu_enabled == FALSE))
+  {
+    return FALSE;
+  }
+
+  if (frame_count != frame_open)
+  {
+    frame_close(1, 0);
+  }
+
+  if (period_ticks < DISPLAY_SWITCH_TICKS)
+  {
+    period_ticks = DISPLAY_SWITCH_TICKS;
+  }
+  frame_period = period_ticks;
+
+  /* A held frame is on for at least two periods and for at most a timer cycle */
+  for (i=0; i<frame_num_segs; i++)
+  {
+    if ((frame_segs[i].hold != 0) && (frame_segs[i].hold < period_ticks))
+    {
+      frame_segs[i].hold = period_ticks;
+    }
+    if (frame_segs[i].hold > (uint16_t)(0xFFFF - period_ticks))
+    {
+      frame_segs[i].hold = (uint16_t)(0xFFFF - period_ticks);
+    }
+  }
+
+  frame_account();
+
+  /* Non cathode pins are written back with their current level */
+  for (p=0; p<FRAME_NUM_PORTS; p++)
+  {
+    mask = frame_mask(p);
+    base = (uint8_t)(frame_ports[p]->ODR & (uint8_t)~mask);
+    for (i=0; i<frame_count; i++)
+    {
+      frame_buf[p][i] = (uint8_t)((frame_buf[p][i] & mask) | base);
+    }
+  }
+
+  frame_seg = 0;
+  frame_passes = frame_segs[0].repeats;
+  frame_playing = TRUE;
+
+  periph_clk_acquire(CLK_Peripheral_TIM2);
+  TIM2_TimeBaseInit(DISPLAY_TIM_PRESCALER, TIM2_CounterMode_Up, (uint16_t)(period_ticks - 1));
+
+  #ifdef FRAME_DMA
+  periph_clk_acquire(CLK_Peripheral_DMA1);
+  frame_arm();
+  DMA_GlobalCmd(ENABLE);
+
+  /* Both compare requests on the last count of a period, every port takes its frame at the same time */
+  TIM2_SetCompare1((uint16_t)(period_ticks - 1));
+  TIM2_SetCompare2((uint16_t)(period_ticks - 1));
+  frame_requests(ENABLE);
+  #else
+  frame_next = 0;
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+  TIM2_ITConfig(TIM2_IT_Update, ENABLE);
+  #endif /* FRAME_DMA */
+
+  TIM2_Cmd(ENABLE);
+
+  return TRUE;
+}
+
+/**
+ * @brief Called from the TIM2 update interrupt while frames are playing, writes the next frame (watch) or ends a
+ * held frame (breakout board)
+ * @retval TRUE if the animation has just ended (timer stopped)
+ */
+bool frame_tick(void)
+{
+  #ifndef FRAME_DMA
+  const frame_segment_t* seg;
+  uint8_t p;
+  #endif /* !FRAME_DMA */
+
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+
+  if (frame_playing == FALSE)
+  {
+    return FALSE;
+  }
+
+  if (frame_seg == frame_num_segs)
+  {
+    frame_stop();
+    return TRUE;
+  }
+
+  #ifdef FRAME_DMA
+  /* Hold over, the next segment's first frame is written a period from now */
+  TIM2_ITConfig(TIM2_IT_Update, DISABLE);
+  TIM2_SetAutoreload((uint16_t)(frame_period - 1));
+  frame_passes = frame_segs[frame_seg].repeats;
+  frame_arm();
+  frame_requests(ENABLE);
+  #else
+  /* Direct register writes, every port in one pass */
+  for (p=0; p<FRAME_NUM_PORTS; p++)
+  {
+    frame_ports[p]->ODR = frame_buf[p][frame_next];
+  }
+
+  seg = &frame_segs[frame_seg];
+  TIM2_SetAutoreload((uint16_t)(frame_period - 1));
+  frame_next++;
+  if (frame_next == (uint8_t)(seg->first + seg->frames))
+  {
+    frame_passes--;
+    if (frame_passes != 0)
+    {
+      frame_next = seg->first;
+      return FALSE;
+    }
+
+    /* Segments are consecutive, frame_next already is the next one's first frame */
+    frame_seg++;
+    if (seg->hold != 0)
+    {
+      TIM2_SetAutoreload((uint16_t)(frame_period - 1 + seg->hold));
+    }
+    else if (frame_seg == frame_num_segs)
+    {
+      frame_stop();
+      return TRUE;
+    }
+
+    if (frame_seg != frame_num_segs)
+    {
+      frame_passes = frame_segs[frame_seg].repeats;
+    }
+  }
+  #endif /* FRAME_DMA */
+
+  return FALSE;
+}
+
+/**
+ * @brief Called from the DMA1 channel 0/1 interrupt, starts the next segment pass once a pass has been streamed
+ * @retval TRUE if the animation has just ended (channels and timer stopped)
+ */
+bool frame_dma_tick(void)
+{
+  #ifdef FRAME_DMA
+  const frame_segment_t* seg;
+
+  if ((frame_playing == FALSE) || (DMA_GetITStatus(FRAME_DMA_PASS_IT) == RESET))
+  {
+    return FALSE;
+  }
+
+  DMA_ClearITPendingBit(FRAME_DMA_PASS_IT);
+
+  seg = &frame_segs[frame_seg];
+  frame_passes--;
+  if (frame_passes != 0)
+  {
+    frame_arm();
+    return FALSE;
+  }
+
+  frame_seg++;
+  if (seg->hold != 0)
+  {
+    /* No requests while the last frame is held, the update interrupt ends the hold */
+    frame_requests(DISABLE);
+    TIM2_SetAutoreload((uint16_t)(seg->hold - 1));
+    TIM2_ClearITPendingBit(TIM2_IT_Update);
+    TIM2_ITConfig(TIM2_IT_Update, ENABLE);
+    return FALSE;
+  }
+
+  if (frame_seg == frame_num_segs)
+  {
+    frame_stop();
+    return TRUE;
+  }
+
+  frame_passes = frame_segs[frame_seg].repeats;
+  frame_arm();
+  #endif /* FRAME_DMA */
+
+  return FALSE;
+}
+
+/**
+ * @brief Check if frames are playing
+ * @retval TRUE until the animation has ended
+ */
+bool frame_busy(void)
+{
+  return frame_playing;
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Work out the blank frame needed before a frame
+ * @param digits: Digit per tube of the next frame, 0-9 or DISPLAY_BLANK
+ * @param next: Filled with the frame in between, the tubes keeping their digit lit and every other tube blank
+ * @retval TRUE if a tube would switch from one digit straight to another
+ */
+static bool frame_break(const uint8_t* digits, uint8_t* next)
+{
+  uint8_t t;
+  bool switching = FALSE;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    next[t] = (digits[t] == frame_digits[t]) ? digits[t] : DISPLAY_BLANK;
+    if ((frame_digits[t] != DISPLAY_BLANK) && (digits[t] != DISPLAY_BLANK) && (digits[t] != frame_digits[t]))
+    {
+      switching = TRUE;
+    }
+  }
+
+  return switching;
+}
+
+/**
+ * @brief Write one frame of cathode pins to the end of the frame buffer
+ * @param digits: Digit per tube, 0-9 or DISPLAY_BLANK
+ */
+static void frame_store(const uint8_t* digits)
+{
+  const nixie_char_t* cathode;
+  uint8_t p;
+  uint8_t t;
+
+  for (p=0; p<FRAME_NUM_PORTS; p++)
+  {
+    frame_buf[p][frame_count] = 0;
+  }
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    if (digits[t] != DISPLAY_BLANK)
+    {
+      cathode = &frame_tubes[t]->digits[digits[t]];
+      frame_buf[frame_port(cathode->gpio_port)][frame_count] |= cathode->gpio_pin;
+    }
+    if (frame_count == frame_open)
+    {
+      frame_open_digits[t] = digits[t];
+    }
+    frame_digits[t] = digits[t];
+  }
+
+  frame_count++;
+}
+
+/**
+ * @brief Turn the frames added since the last segment into a segment
+ * @param repeats: Passes over the frames
+ * @param hold: Ticks the last frame stays on after its period
+ */
+static void frame_close(uint8_t repeats, uint16_t hold)
+{
+  frame_segment_t* seg = &frame_segs[frame_num_segs++];
+
+  seg->first = frame_open;
+  seg->frames = (uint8_t)(frame_count - frame_open);
+  seg->repeats = repeats;
+  seg->hold = hold;
+  frame_open = frame_count;
+}
+
+/**
+ * @brief Frame buffer index of a tube port
+ */
+static uint8_t frame_port(GPIO_TypeDef* port)
+{
+  uint8_t p;
+
+  for (p=0; (p < (FRAME_NUM_PORTS - 1)) && (frame_ports[p] != port); p++)
+  {
+  }
+
+  return p;
+}
+
+/**
+ * @brief Cathode pins of every tube on a port
+ * @param port: Frame buffer port index
+ */
+static uint8_t frame_mask(uint8_t port)
+{
+  uint8_t mask = 0;
+  uint8_t t;
+  uint8_t d;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      if (frame_tubes[t]->digits[d].gpio_port == frame_ports[port])
+      {
+        mask |= frame_tubes[t]->digits[d].gpio_pin;
+      }
+    }
+  }
+
+  return mask;
+}
+
+/**
+ * @brief Add the lit time of the frame buffer to the usage counters, the last frame is left to whatever shows
+ * the tubes next
+ */
+static void frame_account(void)
+{
+  const nixie_char_t* cathode;
+  const frame_segment_t* seg;
+  const uint8_t* frames;
+  uint32_t ticks;
+  uint8_t t;
+  uint8_t d;
+  uint8_t s;
+  uint8_t i;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      cathode = &frame_tubes[t]->digits[d];
+      frames = frame_buf[frame_port(cathode->gpio_port)];
+      ticks = 0;
+
+      for (s=0; s<frame_num_segs; s++)
+      {
+        seg = &frame_segs[s];
+        for (i=seg->first; i<(uint8_t)(seg->first + seg->frames); i++)
+        {
+          if ((frames[i] & cathode->gpio_pin) != 0)
+          {
+            ticks += (uint32_t)seg->repeats * frame_period;
+            if (i == (uint8_t)(seg->first + seg->frames - 1))
+            {
+              ticks += seg->hold;
+            }
+          }
+        }
+      }
+
+      if ((frames[frame_count - 1] & cathode->gpio_pin) != 0)
+      {
+        ticks -= frame_period;
+      }
+
+      ticks >>= DISPLAY_LIT_SHIFT;
+      if (ticks != 0)
+      {
+        usage_add(t, d, (ticks > 0xFFFF) ? 0xFFFF : (uint16_t)ticks);
+      }
+    }
+  }
+}
+
+#ifdef FRAME_DMA
+/**
+ * @brief Point every channel at the current segment, streamed from the next compare request
+ */
+static void frame_arm(void)
+{
+  const frame_segment_t* seg = &frame_segs[frame_seg];
+  uint8_t p;
+
+  for (p=0; p<FRAME_NUM_PORTS; p++)
+  {
+    DMA_Init(frame_lanes[p].channel, (uint32_t)&frame_buf[p][seg->first], frame_lanes[p].odr, seg->frames,
+             DMA_DIR_MemoryToPeripheral, DMA_Mode_Normal, DMA_MemoryIncMode_Inc, DMA_Priority_High,
+             DMA_MemoryDataSize_Byte);
+    DMA_Cmd(frame_lanes[p].channel, ENABLE);
+  }
+  DMA_ClearITPendingBit(FRAME_DMA_PASS_IT);
+  DMA_ITConfig(frame_lanes[0].channel, DMA_ITx_TC, ENABLE);
+}
+
+/**
+ * @brief Enable or disable the TIM2 compare requests of every channel
+ * @param state: ENABLE or DISABLE
+ */
+static void frame_requests(FunctionalState state)
+{
+  uint8_t p;
+
+  for (p=0; p<FRAME_NUM_PORTS; p++)
+  {
+    TIM2_DMACmd(frame_lanes[p].request, state);
+  }
+}
+#endif /* FRAME_DMA */
+
+/**
+ * @brief Stop the frame timer (and DMA channels), the tubes' digits follow the last frame
+ */
+static void frame_stop(void)
+{
+  uint8_t t;
+  #ifdef FRAME_DMA
+  uint8_t p;
+
+  frame_requests(DISABLE);
+  for (p=0; p<FRAME_NUM_PORTS; p++)
+  {
+    DMA_Cmd(frame_lanes[p].channel, DISABLE);
+  }
+  DMA_ITConfig(frame_lanes[0].channel, DMA_ITx_TC, DISABLE);
+  DMA_GlobalCmd(DISABLE);
+  periph_clk_release(CLK_Peripheral_DMA1);
+  #endif /* FRAME_DMA */
+
+  TIM2_ITConfig(TIM2_IT_Update, DISABLE);
+  TIM2_Cmd(DISABLE);
+  TIM2_ClearITPendingBit(TIM2_IT_Update);
+  periph_clk_release(CLK_Peripheral_TIM2);
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    *frame_tubes[t]->curr_digit = frame_digits[t];
+  }
+  frame_playing = FALSE;
+}
+#endif /* !NIXIE_SPI */
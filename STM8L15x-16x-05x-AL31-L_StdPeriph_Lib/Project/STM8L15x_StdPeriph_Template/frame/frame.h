@@ -0,0 +1,88 @@
+/**
+ * @file frame.h
+ * @brief Function prototypes and defines for precomputed display frames, tube port output values streamed into
+ * the port output registers at a fixed frame rate
+ */
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "display.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Ports carrying tube cathodes, a frame is one output data register value per port. The breakout board's two
+   ports are written by DMA1 (one channel per port, paced by the TIM2 compare requests), the watch's five ports
+   outnumber the TIM2 requests and are written by the TIM2 update interrupt. Buffers hold a rendered print (four
+   digits and three transitions on the breakout board, HH and MM and one transition on the watch), frame counts
+   include break before make frames and stay below 256 (DMA transfer count is 8 bits). The breakout board's
+   buffers fit the longest print exactly (crossfade, 35 frames in 11 segments), they are static RAM. */
+#ifdef STM8_BASEBAND
+#define FRAME_NUM_PORTS 2
+#define FRAME_DMA
+#ifndef FRAME_MAX_FRAMES
+#define FRAME_MAX_FRAMES 36
+#endif /* FRAME_MAX_FRAMES */
+#ifndef FRAME_MAX_SEGMENTS
+#define FRAME_MAX_SEGMENTS 11
+#endif /* FRAME_MAX_SEGMENTS */
+#else
+#define FRAME_NUM_PORTS 5
+#ifndef FRAME_MAX_FRAMES
+#define FRAME_MAX_FRAMES 16
+#endif /* FRAME_MAX_FRAMES */
+#ifndef FRAME_MAX_SEGMENTS
+#define FRAME_MAX_SEGMENTS 6
+#endif /* FRAME_MAX_SEGMENTS */
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Run of consecutive frames played a number of times, the last frame optionally held longer
+ */
+typedef struct
+{
+  uint8_t first; /* First frame buffer index */
+
+  uint8_t frames;
+
+  uint8_t repeats; /* Passes over the frames, 1 or more */
+
+  uint16_t hold; /* Timer ticks the last frame stays on after its period, 0 for none */
+
+} frame_segment_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+#ifdef NIXIE_SPI
+/* Frames are port output values, shift register tubes have no port to stream into: nothing is added or played and
+   prints fall back to the display sequencer */
+#define frame_clear()
+#define frame_add(digits) FALSE
+#define frame_repeat(count) FALSE
+#define frame_hold(ticks) FALSE
+#define frame_play(period_ticks) FALSE
+#define frame_tick() FALSE
+#define frame_dma_tick() FALSE
+#define frame_busy() FALSE
+#else
+void frame_clear(void);
+bool frame_add(const uint8_t* digits);
+bool frame_repeat(uint8_t count);
+bool frame_hold(uint16_t ticks);
+bool frame_play(uint16_t period_ticks);
+bool frame_tick(void);
+bool frame_dma_tick(void);
+bool frame_busy(void);
+#endif /* NIXIE_SPI */
+
+#endif /* FRAME_H_ */
@@ -0,0 +1,129 @@
+/**
+ * @file gpio_fast.c
+ * @brief Batch pin initialization, a table of GPIO_Init() style entries is merged per port so each port register
+ * is written once instead of several times per entry
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "gpio_fast.h"
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static uint8_t gpio_fast_add(gpio_fast_port_t* ports, uint8_t num_ports, GPIO_TypeDef* port, uint8_t pins,
+                             uint8_t mode);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Configure every pin of a table, equivalent to one GPIO_Init() per entry
+ *
+ * Consecutive entries with the same port and mode are merged first, each run is decoded into per port register
+ * values and every port register is then written once, in the order GPIO_Init() uses (CR2 cleared first, so no
+ * interrupt or slope change is seen while a pin changes direction). Entries must not configure the same pin twice.
+ *
+ * @param table: Pin groups to configure
+ * @param len: Number of entries
+ */
+void gpio_fast_init(const gpio_fast_cfg_t* table, uint8_t len)
+{
+  gpio_fast_port_t ports[GPIO_FAST_MAX_PORTS];
+  gpio_fast_port_t* port;
+  GPIO_TypeDef* regs;
+  GPIO_TypeDef* run_port;
+  GPIO_Mode_TypeDef run_mode;
+  uint8_t run_pins;
+  uint8_t num_ports = 0;
+  uint8_t i;
+
+  if (len == 0)
+  {
+    return;
+  }
+
+  run_port = table->port;
+  run_mode = table->mode;
+  run_pins = table->pins;
+  for (i=1, table++; i<len; i++, table++)
+  {
+    /* Both compared without short circuit, one branch per entry */
+    if ((table->port == run_port) & (table->mode == run_mode))
+    {
+      run_pins |= table->pins;
+    }
+    else
+    {
+      num_ports = gpio_fast_add(ports, num_ports, run_port, run_pins, (uint8_t)run_mode);
+      run_port = table->port;
+      run_mode = table->mode;
+      run_pins = table->pins;
+    }
+  }
+  num_ports = gpio_fast_add(ports, num_ports, run_port, run_pins, (uint8_t)run_mode);
+
+  for (i=0, port=ports; i<num_ports; i++, port++)
+  {
+    regs = port->port;
+    regs->CR2 &= (uint8_t)~port->pins;
+    /* Input pins keep their output latch, as with GPIO_Init() */
+    regs->ODR = (uint8_t)((regs->ODR & (uint8_t)~port->ddr) | port->odr);
+    regs->DDR = (uint8_t)((regs->DDR & (uint8_t)~port->pins) | port->ddr);
+    regs->CR1 = (uint8_t)((regs->CR1 & (uint8_t)~port->pins) | port->cr1);
+    regs->CR2 |= port->cr2;
+  }
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Merge a run of pins sharing one mode into the register values of its port
+ * @param ports: Ports merged so far
+ * @param num_ports: Number of ports merged so far
+ * @param port: GPIO port of the run
+ * @param pins: Pins of the run
+ * @param mode: GPIO_Mode_TypeDef of the run
+ * @retval Number of ports merged, unchanged if the run was configured directly (out of ports)
+ */
+static uint8_t gpio_fast_add(gpio_fast_port_t* ports, uint8_t num_ports, GPIO_TypeDef* port, uint8_t pins,
+                             uint8_t mode)
+{
+  gpio_fast_port_t* merged = ports;
+  uint8_t i;
+
+  for (i=0; (i < num_ports) && (merged->port != port); i++, merged++)
+  {
+  }
+
+  if (i == num_ports)
+  {
+    if (num_ports == GPIO_FAST_MAX_PORTS)
+    {
+      GPIO_Init(port, pins, (GPIO_Mode_TypeDef)mode);
+      return num_ports;
+    }
+
+    merged->port = port;
+    merged->pins = 0;
+    merged->ddr = 0;
+    merged->odr = 0;
+    merged->cr1 = 0;
+    merged->cr2 = 0;
+    num_ports++;
+  }
+
+  /* Mode bits selected without branches, each one widened to a full byte mask */
+  merged->pins |= pins;
+  merged->ddr |= (uint8_t)(pins & (uint8_t)(0U - ((mode & GPIO_FAST_MODE_OUT) >> 7)));
+  merged->odr |= (uint8_t)(pins & (uint8_t)(0U - ((mode & (GPIO_FAST_MODE_OUT | GPIO_FAST_MODE_HIGH)) ==
+                                                   (GPIO_FAST_MODE_OUT | GPIO_FAST_MODE_HIGH))));
+  merged->cr1 |= (uint8_t)(pins & (uint8_t)(0U - ((mode & GPIO_FAST_MODE_CR1) >> 6)));
+  merged->cr2 |= (uint8_t)(pins & (uint8_t)(0U - ((mode & GPIO_FAST_MODE_CR2) >> 5)));
+
+  return num_ports;
+}
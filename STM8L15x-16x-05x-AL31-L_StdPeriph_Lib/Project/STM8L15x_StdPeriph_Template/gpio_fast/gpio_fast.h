@@ -0,0 +1,95 @@
+/**
+ * @file gpio_fast.h
+ * @brief Inline GPIO output macros (replace GPIO_SetBits/GPIO_ResetBits/GPIO_ToggleBits on hot paths) and batch
+ * pin initialization
+ *
+ * With a constant port (hardwaredefs.h) and a single bit constant pin, Cosmic compiles these to one BSET/BRES/BCPL
+ * on the ODR address (atomic, safe against interrupts touching the same port). Otherwise (port or pin from a
+ * table, several pins) they compile to an inline read-modify-write of ODR, the same access the library
+ * functions make minus the call, which is not atomic: a handler writing the same port in between is lost.
+ */
+
+#ifndef GPIO_FAST_H_
+#define GPIO_FAST_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_gpio.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/**
+ * @brief Drive output pins high
+ * @param port: GPIO port (GPIOA..GPIOF)
+ * @param pin: Pin mask (GPIO_Pin_x)
+ */
+#define GPIO_FAST_SET(port, pin) ((port)->ODR |= (uint8_t)(pin))
+
+/**
+ * @brief Drive output pins low
+ * @param port: GPIO port (GPIOA..GPIOF)
+ * @param pin: Pin mask (GPIO_Pin_x)
+ */
+#define GPIO_FAST_RESET(port, pin) ((port)->ODR &= (uint8_t)(~(uint8_t)(pin)))
+
+/**
+ * @brief Invert output pins
+ * @param port: GPIO port (GPIOA..GPIOF)
+ * @param pin: Pin mask (GPIO_Pin_x)
+ */
+#define GPIO_FAST_TOGGLE(port, pin) ((port)->ODR ^= (uint8_t)(pin))
+
+/* Distinct ports merged by one gpio_fast_init() call, entries on further ports are configured one by one */
+#define GPIO_FAST_MAX_PORTS 4
+
+/* GPIO_Mode_TypeDef bits, as decoded by GPIO_Init() */
+#define GPIO_FAST_MODE_OUT 0x80 /* DDR */
+#define GPIO_FAST_MODE_CR1 0x40 /* Pull-up (input) or push-pull (output) */
+#define GPIO_FAST_MODE_CR2 0x20 /* Interrupt (input) or fast slope (output) */
+#define GPIO_FAST_MODE_HIGH 0x10 /* ODR, outputs only */
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Initial configuration of a group of pins on one port, same meaning as the GPIO_Init() arguments
+ */
+typedef struct
+{
+  GPIO_TypeDef* port;
+
+  uint8_t pins;
+
+  GPIO_Mode_TypeDef mode;
+
+} gpio_fast_cfg_t;
+
+/**
+ * @brief Register values merged for one port, bits outside pins are left untouched
+ */
+typedef struct
+{
+  GPIO_TypeDef* port;
+
+  uint8_t pins;
+
+  uint8_t ddr;
+
+  uint8_t odr; /* Output pins driven high */
+
+  uint8_t cr1;
+
+  uint8_t cr2;
+
+} gpio_fast_port_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void gpio_fast_init(const gpio_fast_cfg_t* table, uint8_t len);
+
+#endif /* GPIO_FAST_H_ */
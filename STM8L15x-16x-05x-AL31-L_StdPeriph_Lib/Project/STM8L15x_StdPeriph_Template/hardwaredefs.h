@@ -105,6 +105,15 @@
 #endif /* !STM8_BASEBAND */
 
 
+#ifdef NIXIE_SPI
+/* Nixie HV shift register chain (NIXIE_SPI backend), SPI1 on its default pins, the latch (strobe) on the NSS pin */
+#define NIXIE_SPI_PORT GPIOB
+#define NIXIE_SPI_SCK_PIN GPIO_Pin_5
+#define NIXIE_SPI_MOSI_PIN GPIO_Pin_6
+#define NIXIE_SPI_LATCH_PIN GPIO_Pin_4
+#endif /* NIXIE_SPI */
+
+
 /* Power switch/interrupt control */
 #ifdef STM8_BASEBAND
 /* Power switch */
@@ -136,4 +145,19 @@
 #define WAKE_BUTTON_INT EXTI_Pin_0
 #endif /* STM8_BASEBAND */
 
+/* Host communication and external RTC buses (only populated on breakout board) */
+/* External RTC I2C bus (board has external 10k pullups) */
+#define RTC_I2C_PORT GPIOC
+#define RTC_I2C_SDA_PIN GPIO_Pin_0
+#define RTC_I2C_SCL_PIN GPIO_Pin_1
+
+/* Host UART (USART1 remapped to port A) */
+#define HOST_UART_PORT GPIOA
+#define HOST_UART_TX_PIN GPIO_Pin_2
+#define HOST_UART_RX_PIN GPIO_Pin_3
+
+/* Pins which must never be reconfigured by the low power pin table (SWIM debug and NRST) */
+#define RESERVED_PORT GPIOA
+#define RESERVED_PINS (GPIO_Pin_0 | GPIO_Pin_1)
+
 #endif /* HARDWAREDEFS_H_ */
\ No newline at end of file
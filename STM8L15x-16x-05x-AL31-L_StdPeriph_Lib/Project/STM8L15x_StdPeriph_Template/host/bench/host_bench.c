@@ -0,0 +1,271 @@
+/**
+ * @file host_bench.c
+ * @brief Benchmark suite for firmware hot paths, runs on the host emulator and prints a tab separated table
+ *
+ * Output (one row per benchmark, stable names so rows can be diffed between commits):
+ *
+ *   benchmark<TAB>iterations<TAB>ns_per_call<TAB>est_cycles_per_call
+ *
+ * ns_per_call is host time, est_cycles_per_call the emulator's STM8 cycle estimate (basic block cost model, see
+ * host_emu.c, not validated against target code). Both show changes in the amount of work a path does, neither is a
+ * target cycle count or a pass/fail threshold.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "host_emu.h"
+#include "host_ds1307.h"
+#include "stm8l15x_it.h"
+#include "nixie.h"
+#include "ext_rtc.h"
+#include "state_machine.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Default iterations per batch, the best of BENCH_BATCHES batches is reported */
+#define BENCH_ITERATIONS 10000UL
+#define BENCH_BATCHES 5
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Benchmark table entry
+ */
+typedef struct
+{
+  const char* name;
+
+  void (*setup)(void); /* Called before each batch, optional */
+
+  void (*body)(void); /* One call of the measured path */
+
+} bench_t;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void bench_run_all(void);
+static unsigned long long bench_now_ns(void);
+static void bench_setup_psu_on(void);
+static void bench_setup_uart(void);
+static void bench_setup_sleep(void);
+static void bench_nixie_init_pins(void);
+static void bench_nixie_digit_on_off(void);
+static void bench_ext_rtc_decode(void);
+static void bench_ext_rtc_print_val(void);
+static void bench_ext_rtc_read(void);
+static void bench_sm_no_request(void);
+static void bench_sm_power_cycle(void);
+static void bench_exti0(void);
+static void bench_exti1(void);
+static void bench_exti2(void);
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static const bench_t bench_table[] = {
+  {"nixie_init_pins", NULL, bench_nixie_init_pins},
+  {"nixie_digit_control/on_off", bench_setup_psu_on, bench_nixie_digit_on_off},
+  {"ext_rtc_decode", NULL, bench_ext_rtc_decode},
+  {"ext_rtc_print_val", bench_setup_uart, bench_ext_rtc_print_val},
+  {"ext_rtc_read", NULL, bench_ext_rtc_read},
+  {"sm_execute_requests/none", bench_setup_sleep, bench_sm_no_request},
+  {"sm_execute_requests/power_cycle", bench_setup_sleep, bench_sm_power_cycle},
+  {"EXTI0_IRQHandler", bench_setup_sleep, bench_exti0},
+  {"EXTI1_IRQHandler", bench_setup_sleep, bench_exti1},
+  {"EXTI2_IRQHandler", bench_setup_sleep, bench_exti2}
+};
+
+static unsigned long bench_iterations = BENCH_ITERATIONS;
+
+/* RTC on the emulated I2C bus */
+static host_ds1307_t bench_rtc;
+
+/* Sink for results, keeps pure functions from being optimized out */
+static volatile uint8_t bench_sink;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+
+/**
+ * @brief Usage: host_bench [iterations]
+ */
+int main(int argc, char** argv)
+{
+  host_run_result_t result;
+
+  if (argc > 1)
+  {
+    if ((sscanf(argv[1], "%lu", &bench_iterations) != 1) || (bench_iterations == 0))
+    {
+      fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  host_emu_reset();
+  host_ds1307_init(&bench_rtc);
+  host_i2c_attach(&bench_rtc.slave);
+
+  result = host_emu_run(bench_run_all, NULL);
+  if (result != HOST_RUN_RETURNED)
+  {
+    fprintf(stderr, "benchmark aborted: %s\n", (result == HOST_RUN_FAULT) ? host_emu_fault_msg() : "stopped");
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Run every benchmark and print the result table, called inside an emulator run
+ */
+static void bench_run_all(void)
+{
+  uint8_t i;
+  uint8_t batch;
+  unsigned long n;
+  unsigned long long start;
+  unsigned long long elapsed;
+  unsigned long long best;
+  unsigned long long cycles = 0;
+
+  /* Firmware state the measured paths expect */
+  nixie_init_pins(&tube_A, &shared_psu);
+  sm_configure_interrupts(&state_machine);
+
+  printf("benchmark\titerations\tns_per_call\test_cycles_per_call\n");
+
+  for (i=0; i<(sizeof(bench_table) / sizeof(bench_table[0])); i++)
+  {
+    best = ULLONG_MAX;
+    for (batch=0; batch<BENCH_BATCHES; batch++)
+    {
+      if (bench_table[i].setup != NULL)
+      {
+        bench_table[i].setup();
+      }
+
+      cycles = host_cpu_cycles();
+      start = bench_now_ns();
+      for (n=0; n<bench_iterations; n++)
+      {
+        bench_table[i].body();
+      }
+      elapsed = bench_now_ns() - start;
+      cycles = host_cpu_cycles() - cycles;
+
+      if (elapsed < best)
+      {
+        best = elapsed;
+      }
+    }
+
+    printf("%s\t%lu\t%.1f\t%.1f\n", bench_table[i].name, bench_iterations, (double)best / (double)bench_iterations,
+           (double)cycles / (double)bench_iterations);
+  }
+}
+
+/**
+ * @brief Get monotonic host time
+ * @retval Time in nanoseconds
+ */
+static unsigned long long bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((unsigned long long)ts.tv_sec * 1000000000ULL) + (unsigned long long)ts.tv_nsec;
+}
+
+/******************************************************************************/
+/*                            B E N C H M A R K S                             */
+/******************************************************************************/
+
+static void bench_setup_psu_on(void)
+{
+  nixie_enable_psu(&shared_psu);
+}
+
+static void bench_setup_uart(void)
+{
+  host_uart_tx_clear();
+}
+
+static void bench_setup_sleep(void)
+{
+  state_machine.current_state = STATE_SLEEP;
+  state_machine.executing_state = FALSE;
+  state_machine_request.message = STATE_MESSAGE_NONE;
+}
+
+static void bench_nixie_init_pins(void)
+{
+  nixie_init_pins(&tube_A, &shared_psu);
+}
+
+static void bench_nixie_digit_on_off(void)
+{
+  nixie_digit_control(&tube_A, 7, DIGIT_ON, &shared_psu);
+  nixie_digit_control(&tube_A, 7, DIGIT_OFF, &shared_psu);
+}
+
+static void bench_ext_rtc_decode(void)
+{
+  static uint8_t val;
+
+  bench_sink = ext_rtc_decode(val++);
+}
+
+static void bench_ext_rtc_print_val(void)
+{
+  ext_rtc_print_val(0x59, RTC_PRINT_SECONDS);
+  host_uart_tx_clear();
+}
+
+static void bench_ext_rtc_read(void)
+{
+  uint8_t buf[RTC_PAY_READ_SIZE];
+
+  ext_rtc_read(buf, RTC_PAY_READ_SIZE);
+  bench_sink = buf[0];
+}
+
+static void bench_sm_no_request(void)
+{
+  sm_execute_requests(&state_machine, &state_machine_request);
+}
+
+/* Power down followed by power up, exercises the board_power pin tables */
+static void bench_sm_power_cycle(void)
+{
+  state_machine_request.message = STATE_MESSAGE_POWER_DOWN;
+  sm_execute_requests(&state_machine, &state_machine_request);
+  state_machine_request.message = STATE_MESSAGE_SET_SLEEP;
+  sm_execute_requests(&state_machine, &state_machine_request);
+}
+
+static void bench_exti0(void)
+{
+  EXTI0_IRQHandler();
+}
+
+static void bench_exti1(void)
+{
+  EXTI1_IRQHandler();
+}
+
+static void bench_exti2(void)
+{
+  EXTI2_IRQHandler();
+}
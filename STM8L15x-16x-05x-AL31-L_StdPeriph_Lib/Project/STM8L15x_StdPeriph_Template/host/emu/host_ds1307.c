@@ -0,0 +1,294 @@
+/**
+ * @file host_ds1307.c
+ * @brief Behavioural DS1307 RTC model, BCD clock registers with clock halt, 56 byte NVRAM and register pointer
+ *
+ * Follows the DS1307 datasheet at transaction level: the first byte of a write sets the register pointer,
+ * every further byte read or written auto-increments it (wrapping from 0x3F to 0x00), and the clock
+ * registers are read from a user buffer that is loaded on every START so a read never sees a rollover.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <string.h>
+
+#include "host_ds1307.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define HOST_DS1307_MS_PER_SECOND 1000
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Writable bits per clock register, unused bits always read back as 0 */
+static const uint8_t host_ds1307_write_mask[HOST_DS1307_NUM_CLOCK_REGS] = {
+  0xFF, 0x7F, 0x7F, 0x07, 0x3F, 0x1F, 0xFF, 0x93
+};
+
+/* Days per month, February is corrected for leap years */
+static const uint8_t host_ds1307_month_days[12] = {
+  31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static bool host_ds1307_start(void* ctx, bool read);
+static bool host_ds1307_write(void* ctx, uint8_t data);
+static uint8_t host_ds1307_read(void* ctx);
+static void host_ds1307_stop(void* ctx);
+static void host_ds1307_second(host_ds1307_t* rtc);
+static bool host_ds1307_hour(host_ds1307_t* rtc);
+static uint8_t host_ds1307_from_bcd(uint8_t val);
+static uint8_t host_ds1307_to_bcd(uint8_t val);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Put the model into its first power-up state (01/01/00 00:00:00, oscillator halted) and clear faults
+ * @param rtc: Device
+ */
+void host_ds1307_init(host_ds1307_t* rtc)
+{
+  memset(rtc, 0, sizeof(*rtc));
+
+  rtc->slave.address = HOST_DS1307_ADDRESS;
+  rtc->slave.ctx = rtc;
+  rtc->slave.start = host_ds1307_start;
+  rtc->slave.write = host_ds1307_write;
+  rtc->slave.read = host_ds1307_read;
+  rtc->slave.stop = host_ds1307_stop;
+
+  rtc->regs[HOST_DS1307_REG_SECONDS] = HOST_DS1307_CH;
+  rtc->regs[HOST_DS1307_REG_DAY] = 0x01;
+  rtc->regs[HOST_DS1307_REG_DATE] = 0x01;
+  rtc->regs[HOST_DS1307_REG_MONTH] = 0x01;
+}
+
+/**
+ * @brief Let time pass, the clock only advances while the oscillator runs (CH clear)
+ * @param rtc: Device
+ * @param ms: Elapsed time in milliseconds
+ */
+void host_ds1307_tick_ms(host_ds1307_t* rtc, uint32_t ms)
+{
+  if ((rtc->regs[HOST_DS1307_REG_SECONDS] & HOST_DS1307_CH) != 0)
+  {
+    return;
+  }
+
+  ms += rtc->subsecond_ms;
+  while (ms >= HOST_DS1307_MS_PER_SECOND)
+  {
+    host_ds1307_second(rtc);
+    ms -= HOST_DS1307_MS_PER_SECOND;
+  }
+  rtc->subsecond_ms = (uint16_t)ms;
+}
+
+/**
+ * @brief Reset the transaction counters
+ * @param rtc: Device
+ */
+void host_ds1307_clear_counters(host_ds1307_t* rtc)
+{
+  rtc->starts = 0;
+  rtc->stops = 0;
+  rtc->bytes_written = 0;
+  rtc->bytes_read = 0;
+  rtc->nacks = 0;
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Address phase, loads the user buffer
+ */
+static bool host_ds1307_start(void* ctx, bool read)
+{
+  host_ds1307_t* rtc = (host_ds1307_t*)ctx;
+
+  if (rtc->nack_address != 0)
+  {
+    rtc->nack_address--;
+    rtc->nacks++;
+    return FALSE;
+  }
+
+  rtc->starts++;
+  rtc->pointer_next = (read == FALSE) ? TRUE : FALSE;
+  memcpy(rtc->latch, rtc->regs, sizeof(rtc->latch));
+
+  return TRUE;
+}
+
+/**
+ * @brief Byte written by the master, register pointer first then data
+ */
+static bool host_ds1307_write(void* ctx, uint8_t data)
+{
+  host_ds1307_t* rtc = (host_ds1307_t*)ctx;
+
+  if (rtc->nack_data != 0)
+  {
+    rtc->nack_data--;
+    rtc->nacks++;
+    return FALSE;
+  }
+
+  rtc->bytes_written++;
+
+  if (rtc->pointer_next)
+  {
+    rtc->pointer = (uint8_t)(data % HOST_DS1307_NUM_REGS);
+    rtc->pointer_next = FALSE;
+    return TRUE;
+  }
+
+  if (rtc->pointer < HOST_DS1307_NUM_CLOCK_REGS)
+  {
+    data &= host_ds1307_write_mask[rtc->pointer];
+  }
+  rtc->regs[rtc->pointer] = data;
+
+  /* Writing seconds resets the countdown chain */
+  if (rtc->pointer == HOST_DS1307_REG_SECONDS)
+  {
+    rtc->subsecond_ms = 0;
+  }
+
+  rtc->pointer = (uint8_t)((rtc->pointer + 1) % HOST_DS1307_NUM_REGS);
+  return TRUE;
+}
+
+/**
+ * @brief Byte requested by the master, clock registers come from the user buffer
+ */
+static uint8_t host_ds1307_read(void* ctx)
+{
+  host_ds1307_t* rtc = (host_ds1307_t*)ctx;
+  uint8_t data;
+
+  rtc->bytes_read++;
+
+  data = (rtc->pointer < HOST_DS1307_NUM_CLOCK_REGS) ? rtc->latch[rtc->pointer] : rtc->regs[rtc->pointer];
+  rtc->pointer = (uint8_t)((rtc->pointer + 1) % HOST_DS1307_NUM_REGS);
+
+  return data;
+}
+
+static void host_ds1307_stop(void* ctx)
+{
+  ((host_ds1307_t*)ctx)->stops++;
+}
+
+/**
+ * @brief Advance the clock registers by one second, with carry up to the year
+ * @param rtc: Device
+ */
+static void host_ds1307_second(host_ds1307_t* rtc)
+{
+  uint8_t* regs = rtc->regs;
+  uint8_t val;
+  uint8_t days;
+
+  val = (uint8_t)(host_ds1307_from_bcd(regs[HOST_DS1307_REG_SECONDS]) + 1);
+  regs[HOST_DS1307_REG_SECONDS] = host_ds1307_to_bcd((uint8_t)(val % 60));
+  if (val < 60)
+  {
+    return;
+  }
+
+  val = (uint8_t)(host_ds1307_from_bcd(regs[HOST_DS1307_REG_MINUTES]) + 1);
+  regs[HOST_DS1307_REG_MINUTES] = host_ds1307_to_bcd((uint8_t)(val % 60));
+  if (val < 60)
+  {
+    return;
+  }
+
+  if (host_ds1307_hour(rtc) == FALSE)
+  {
+    return;
+  }
+
+  /* Midnight */
+  val = regs[HOST_DS1307_REG_DAY];
+  regs[HOST_DS1307_REG_DAY] = (uint8_t)((val >= 7) ? 1 : (val + 1));
+
+  val = host_ds1307_from_bcd(regs[HOST_DS1307_REG_MONTH]);
+  days = host_ds1307_month_days[(val >= 1 && val <= 12) ? (val - 1) : 0];
+  if ((val == 2) && ((host_ds1307_from_bcd(regs[HOST_DS1307_REG_YEAR]) % 4) == 0))
+  {
+    days++;
+  }
+
+  val = (uint8_t)(host_ds1307_from_bcd(regs[HOST_DS1307_REG_DATE]) + 1);
+  if (val <= days)
+  {
+    regs[HOST_DS1307_REG_DATE] = host_ds1307_to_bcd(val);
+    return;
+  }
+  regs[HOST_DS1307_REG_DATE] = 0x01;
+
+  val = (uint8_t)(host_ds1307_from_bcd(regs[HOST_DS1307_REG_MONTH]) + 1);
+  if (val <= 12)
+  {
+    regs[HOST_DS1307_REG_MONTH] = host_ds1307_to_bcd(val);
+    return;
+  }
+  regs[HOST_DS1307_REG_MONTH] = 0x01;
+
+  val = (uint8_t)(host_ds1307_from_bcd(regs[HOST_DS1307_REG_YEAR]) + 1);
+  regs[HOST_DS1307_REG_YEAR] = host_ds1307_to_bcd((uint8_t)(val % 100));
+}
+
+/**
+ * @brief Advance the hours register in 12 or 24 hour mode
+ * @param rtc: Device
+ * @retval TRUE on rollover to midnight
+ */
+static bool host_ds1307_hour(host_ds1307_t* rtc)
+{
+  uint8_t reg = rtc->regs[HOST_DS1307_REG_HOURS];
+  uint8_t pm;
+  uint8_t val;
+
+  if ((reg & HOST_DS1307_12H) == 0)
+  {
+    val = (uint8_t)(host_ds1307_from_bcd((uint8_t)(reg & 0x3F)) + 1);
+    rtc->regs[HOST_DS1307_REG_HOURS] = host_ds1307_to_bcd((uint8_t)(val % 24));
+    return (val >= 24) ? TRUE : FALSE;
+  }
+
+  /* 12 hour mode, 11 -> 12 toggles AM/PM, 12 -> 1 keeps it */
+  pm = (uint8_t)(reg & HOST_DS1307_PM);
+  val = (uint8_t)(host_ds1307_from_bcd((uint8_t)(reg & 0x1F)) + 1);
+  if (val == 12)
+  {
+    pm ^= HOST_DS1307_PM;
+  }
+  else if (val > 12)
+  {
+    val = 1;
+  }
+  rtc->regs[HOST_DS1307_REG_HOURS] = (uint8_t)(HOST_DS1307_12H | pm | host_ds1307_to_bcd(val));
+
+  return ((val == 12) && (pm == 0)) ? TRUE : FALSE;
+}
+
+static uint8_t host_ds1307_from_bcd(uint8_t val)
+{
+  return (uint8_t)(((val >> 4) * 10) + (val & 0x0F));
+}
+
+static uint8_t host_ds1307_to_bcd(uint8_t val)
+{
+  return (uint8_t)(((val / 10) << 4) | (val % 10));
+}
@@ -0,0 +1,87 @@
+/**
+ * @file host_ds1307.h
+ * @brief Function prototypes, defines and types for the behavioural DS1307 RTC model (emulated I2C1 slave)
+ */
+
+#ifndef HOST_DS1307_H_
+#define HOST_DS1307_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "host_emu.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* 7 bit slave address */
+#define HOST_DS1307_ADDRESS 0x68
+
+/* Register map, clock registers followed by battery backed NVRAM, the register pointer wraps at the end */
+#define HOST_DS1307_NUM_REGS 64
+#define HOST_DS1307_NUM_CLOCK_REGS 8
+#define HOST_DS1307_NVRAM_START 0x08
+
+#define HOST_DS1307_REG_SECONDS 0x00
+#define HOST_DS1307_REG_MINUTES 0x01
+#define HOST_DS1307_REG_HOURS 0x02
+#define HOST_DS1307_REG_DAY 0x03
+#define HOST_DS1307_REG_DATE 0x04
+#define HOST_DS1307_REG_MONTH 0x05
+#define HOST_DS1307_REG_YEAR 0x06
+#define HOST_DS1307_REG_CONTROL 0x07
+
+/* Seconds register clock halt bit, oscillator stopped while set */
+#define HOST_DS1307_CH 0x80
+
+/* Hours register mode bits */
+#define HOST_DS1307_12H 0x40
+#define HOST_DS1307_PM 0x20
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief DS1307 device state, attach with host_i2c_attach(&rtc->slave)
+ */
+typedef struct
+{
+  host_i2c_slave_t slave; /* Bus interface, also holds the clock stretch and stuck bus settings */
+
+  uint8_t regs[HOST_DS1307_NUM_REGS];
+
+  uint8_t latch[HOST_DS1307_NUM_CLOCK_REGS]; /* User buffer, time is copied here on every START */
+
+  uint8_t pointer; /* Register pointer */
+
+  bool pointer_next; /* Next written byte sets the register pointer */
+
+  uint16_t subsecond_ms; /* Countdown chain, reset when the seconds register is written */
+
+  uint8_t nack_address; /* Number of address phases to NACK */
+
+  uint8_t nack_data; /* Number of written bytes to NACK */
+
+  /* Transaction counters */
+  uint32_t starts;
+
+  uint32_t stops;
+
+  uint32_t bytes_written;
+
+  uint32_t bytes_read;
+
+  uint32_t nacks;
+
+} host_ds1307_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void host_ds1307_init(host_ds1307_t* rtc);
+void host_ds1307_tick_ms(host_ds1307_t* rtc, uint32_t ms);
+void host_ds1307_clear_counters(host_ds1307_t* rtc);
+
+#endif /* HOST_DS1307_H_ */
@@ -0,0 +1,773 @@
+/**
+ * @file host_emu.c
+ * @brief Host emulator core, register file, CPU instructions, interrupt dispatch and GPIO/EXTI model
+ *
+ * Registers are plain memory, the firmware and the StdPeriph drivers read and write them exactly as on
+ * the target. Hardware behaviour (flags set by the peripheral, interrupts) is applied by the emulator
+ * at well defined points: when the host injects stimulus, when the firmware polls a status flag through
+ * a StdPeriph driver (see host_periph.c) and when the CPU waits for an interrupt.
+ *
+ * Virtual time advances with firmware execution, bus transfers and idle periods. Firmware and driver
+ * sources are built with -fsanitize-coverage=trace-pc, every executed basic block is charged
+ * HOST_CYCLES_PER_BLOCK CPU cycles at the current SYSCLK. This is a coarse cost model (good for busy
+ * loops and relative comparisons, not for exact cycle counts). The same hook samples GPIO outputs, fires
+ * alarms that are due and services pending interrupts, so stimulus can arrive while firmware is running.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "stm8l15x_it.h"
+
+/******************************************************************************/
+/*                P U B L I C  G L O B A L  V A R I A B L E S                 */
+/******************************************************************************/
+
+/* Emulated register file, indexed by STM8 address (see HOST_IO()) */
+volatile uint8_t host_io[HOST_IO_SIZE];
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Interrupt vector table, index is the IRQ number used in INTERRUPT_HANDLER() */
+static void (* const host_vectors[HOST_NUM_VECTORS])(void) = {
+  NULL, /* Vector 0 is reserved on STM8L */
+  FLASH_IRQHandler,
+  DMA1_CHANNEL0_1_IRQHandler,
+  DMA1_CHANNEL2_3_IRQHandler,
+  RTC_CSSLSE_IRQHandler,
+  EXTIE_F_PVD_IRQHandler,
+  EXTIB_G_IRQHandler,
+  EXTID_H_IRQHandler,
+  EXTI0_IRQHandler,
+  EXTI1_IRQHandler,
+  EXTI2_IRQHandler,
+  EXTI3_IRQHandler,
+  EXTI4_IRQHandler,
+  EXTI5_IRQHandler,
+  EXTI6_IRQHandler,
+  EXTI7_IRQHandler,
+  LCD_AES_IRQHandler,
+  SWITCH_CSS_BREAK_DAC_IRQHandler,
+  ADC1_COMP_IRQHandler,
+  TIM2_UPD_OVF_TRG_BRK_USART2_TX_IRQHandler,
+  TIM2_CC_USART2_RX_IRQHandler,
+  TIM3_UPD_OVF_TRG_BRK_USART3_TX_IRQHandler,
+  TIM3_CC_USART3_RX_IRQHandler,
+  TIM1_UPD_OVF_TRG_COM_IRQHandler,
+  TIM1_CC_IRQHandler,
+  TIM4_UPD_OVF_TRG_IRQHandler,
+  SPI1_IRQHandler,
+  USART1_TX_TIM5_UPD_OVF_TRG_BRK_IRQHandler,
+  USART1_RX_TIM5_CC_IRQHandler,
+  I2C1_SPI2_IRQHandler
+};
+
+/* Pending interrupt vectors (bit per vector) and number of times each vector was serviced */
+static uint32_t host_irq_pending;
+static uint32_t host_irq_serviced[HOST_NUM_VECTORS];
+static host_irq_stats_t host_irq_timing[HOST_NUM_VECTORS];
+
+/* CPU interrupt mask (CC register I bits), interrupts are masked out of reset */
+static bool host_irq_enabled;
+
+/* Set while a handler runs, STM8 interrupts do not nest at equal priority */
+static bool host_in_isr;
+
+/* Active run, entry point is left with longjmp when the idle hook stops the run or on fault */
+static jmp_buf host_run_env;
+static bool host_running;
+static host_idle_hook_t host_idle_hook;
+
+/* Fault description and busy-wait detection */
+static const char* host_fault_msg;
+static uint32_t host_poll_count;
+
+/* Virtual time in picoseconds and CPU cycles charged to firmware */
+static unsigned long long host_time_ps;
+static unsigned long long host_cycles;
+
+/* Time spent in each CPU mode, in picoseconds */
+static host_cpu_mode_t host_cpu_mode;
+static unsigned long long host_residency_ps[HOST_CPU_NUM_MODES];
+
+/* Timed callbacks, deadline in picoseconds */
+static host_alarm_t host_alarms[HOST_NUM_ALARMS];
+static unsigned long long host_alarm_deadline[HOST_NUM_ALARMS];
+
+/* Output tracing, last levels seen per port */
+static host_trace_hook_t host_trace_hook;
+static uint8_t host_gpio_levels[HOST_NUM_GPIO_PORTS];
+static GPIO_TypeDef* const host_gpio_ports[HOST_NUM_GPIO_PORTS] = {
+  GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF
+};
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void host_irq_dispatch(void);
+static void host_irq_acknowledge(uint8_t vector);
+static void host_irq_account(uint8_t vector, unsigned long long ps, unsigned long long cycles);
+static void host_cpu_idle(bool halted);
+static uint8_t host_exti_sensitivity(uint8_t line);
+static void host_time_advance_to(unsigned long long ps);
+static void host_time_set(unsigned long long ps);
+static void host_time_step(unsigned long long ps);
+static bool host_alarm_next(unsigned long long* ps);
+static void host_gpio_sample(void);
+
+/* Coverage instrumentation callback, called by every basic block of firmware code */
+void __sanitizer_cov_trace_pc(void);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Put the register file and every peripheral model into the reset state
+ * @note Firmware globals are not re-initialized, use one firmware run per process
+ */
+void host_emu_reset(void)
+{
+  memset((void*)host_io, 0, sizeof(host_io));
+
+  /* Non-zero register reset values the firmware relies on */
+  CLK->CKDIVR = CLK_CKDIVR_RESET_VALUE;
+  CLK->ICKCR = CLK_ICKCR_RESET_VALUE;
+  CLK->SCSR = CLK_SCSR_RESET_VALUE;
+  TIM1->ARRH = TIM1_ARRH_RESET_VALUE;
+  TIM1->ARRL = TIM1_ARRL_RESET_VALUE;
+  TIM2->ARRH = TIM_ARRH_RESET_VALUE;
+  TIM2->ARRL = TIM_ARRL_RESET_VALUE;
+  USART1->SR = USART_SR_RESET_VALUE;
+
+  host_irq_pending = 0;
+  memset(host_irq_serviced, 0, sizeof(host_irq_serviced));
+  memset(host_irq_timing, 0, sizeof(host_irq_timing));
+  host_irq_enabled = FALSE;
+  host_in_isr = FALSE;
+  host_fault_msg = NULL;
+  host_poll_count = 0;
+
+  host_time_ps = 0;
+  host_cycles = 0;
+  host_cpu_mode = HOST_CPU_RUN;
+  memset(host_residency_ps, 0, sizeof(host_residency_ps));
+  memset(host_alarms, 0, sizeof(host_alarms));
+  host_trace_hook = NULL;
+  memset(host_gpio_levels, 0, sizeof(host_gpio_levels));
+
+  host_periph_reset();
+}
+
+/**
+ * @brief Run firmware code until it returns, the idle hook stops it or the emulator detects a fault
+ * @param entry: Firmware entry point (fw_main for the complete firmware, or any function under test)
+ * @param idle: Called each time the firmware waits with nothing pending, NULL stops on first wait
+ * @retval Reason the run ended
+ */
+host_run_result_t host_emu_run(void (*entry)(void), host_idle_hook_t idle)
+{
+  int result;
+
+  host_idle_hook = idle;
+  host_running = TRUE;
+
+  result = setjmp(host_run_env);
+  if (result == 0)
+  {
+    entry();
+    result = HOST_RUN_RETURNED;
+  }
+
+  host_running = FALSE;
+  return (host_run_result_t)result;
+}
+
+/**
+ * @brief Abort the current run, called by peripheral models on conditions the firmware cannot recover from
+ * @param msg: Static description of the fault
+ */
+void host_emu_fault(const char* msg)
+{
+  host_fault_msg = msg;
+
+  if (host_running == FALSE)
+  {
+    fprintf(stderr, "host_emu: fault outside of a run: %s\n", msg);
+    __builtin_trap();
+  }
+
+  longjmp(host_run_env, HOST_RUN_FAULT);
+}
+
+/**
+ * @brief End the current run (HOST_RUN_STOPPED), for use from alarms and hooks
+ */
+void host_emu_stop(void)
+{
+  longjmp(host_run_env, HOST_RUN_STOPPED);
+}
+
+/**
+ * @brief Get description of the last fault
+ * @retval Fault message, NULL if no fault occurred
+ */
+const char* host_emu_fault_msg(void)
+{
+  return host_fault_msg;
+}
+
+/**
+ * @brief Account a status poll, faults if the firmware keeps polling without anything changing
+ * @param what: Name of the polled flag, used in the fault message
+ */
+void host_emu_poll(const char* what)
+{
+  host_poll_count++;
+  if (host_poll_count > HOST_POLL_LIMIT)
+  {
+    host_emu_fault(what);
+  }
+}
+
+/**
+ * @brief Reset busy-wait detection, called by peripheral models whenever the firmware makes progress
+ */
+void host_emu_progress(void)
+{
+  host_poll_count = 0;
+}
+
+/**
+ * @brief Get virtual time
+ * @retval Nanoseconds since reset
+ */
+unsigned long long host_time_ns(void)
+{
+  return host_time_ps / 1000ULL;
+}
+
+/**
+ * @brief Get CPU cycles charged to firmware code
+ * @retval Cycles since reset (HOST_CYCLES_PER_BLOCK per executed basic block)
+ */
+unsigned long long host_cpu_cycles(void)
+{
+  return host_cycles;
+}
+
+/**
+ * @brief Get time spent in a CPU mode
+ * @param mode: CPU mode
+ * @retval Nanoseconds since reset
+ */
+unsigned long long host_residency_ns(host_cpu_mode_t mode)
+{
+  return (mode < HOST_CPU_NUM_MODES) ? (host_residency_ps[mode] / 1000ULL) : 0;
+}
+
+/**
+ * @brief Let time pass without executing firmware code (bus transfers), alarms that fall due are fired
+ * @param ns: Duration in nanoseconds
+ */
+void host_time_advance_ns(unsigned long long ns)
+{
+  host_time_advance_to(host_time_ps + (ns * 1000ULL));
+}
+
+/**
+ * @brief Schedule a callback, replaces any alarm already set in the same slot
+ * @param id: Alarm slot (HOST_ALARM_STIMULUS or a peripheral model slot)
+ * @param deadline_ns: Virtual time to fire at, fires on the next basic block if already passed
+ * @param alarm: Callback, may schedule the next alarm in its own slot
+ */
+void host_alarm_set(uint8_t id, unsigned long long deadline_ns, host_alarm_t alarm)
+{
+  if (id >= HOST_NUM_ALARMS)
+  {
+    return;
+  }
+
+  host_alarm_deadline[id] = deadline_ns * 1000ULL;
+  host_alarms[id] = alarm;
+}
+
+/**
+ * @brief Remove a scheduled callback
+ * @param id: Alarm slot
+ */
+void host_alarm_cancel(uint8_t id)
+{
+  if (id < HOST_NUM_ALARMS)
+  {
+    host_alarms[id] = NULL;
+  }
+}
+
+/**
+ * @brief Install the output trace hook
+ * @param hook: Called for every output event, NULL disables tracing
+ */
+void host_trace_set_hook(host_trace_hook_t hook)
+{
+  host_trace_hook = hook;
+  host_gpio_sample();
+}
+
+/**
+ * @brief Report an output event to the trace hook, used by the peripheral models
+ * @param event: Event type
+ * @param index: Port or vector
+ * @param value: Levels or data
+ */
+void host_trace_emit(host_trace_t event, uint8_t index, uint8_t value)
+{
+  if (host_trace_hook != NULL)
+  {
+    host_trace_hook(event, index, value);
+  }
+}
+
+/**
+ * @brief Set an interrupt vector pending, it is serviced as soon as interrupts are enabled
+ * @param vector: IRQ number (0 to HOST_NUM_VECTORS - 1)
+ */
+void host_irq_raise(uint8_t vector)
+{
+  if (vector >= HOST_NUM_VECTORS)
+  {
+    return;
+  }
+
+  host_irq_pending |= ((uint32_t)1 << vector);
+}
+
+/**
+ * @brief Get number of times an interrupt vector has been serviced since reset
+ * @param vector: IRQ number
+ * @retval Service count
+ */
+uint32_t host_irq_count(uint8_t vector)
+{
+  return (vector < HOST_NUM_VECTORS) ? host_irq_serviced[vector] : 0;
+}
+
+/**
+ * @brief Get handler timing of an interrupt vector
+ * @param vector: IRQ number
+ * @retval Statistics since reset, NULL for an invalid vector
+ */
+const host_irq_stats_t* host_irq_stats(uint8_t vector)
+{
+  return (vector < HOST_NUM_VECTORS) ? &host_irq_timing[vector] : NULL;
+}
+
+/**
+ * @brief Drive external pin levels, edges raise EXTI interrupts according to the port and EXTI configuration
+ * @param port: GPIO port
+ * @param pins: Pin mask
+ * @param high: New pin level
+ *
+ * Only pin interrupts (EXTI0 to EXTI7) are modelled, port interrupts selected through EXTI_CONF are not.
+ */
+void host_gpio_input(GPIO_TypeDef* port, uint8_t pins, bool high)
+{
+  uint8_t line;
+  uint8_t mask;
+  uint8_t sens;
+  uint8_t old_level;
+  bool edge;
+
+  for (line=0; line<8; line++)
+  {
+    mask = (uint8_t)(1 << line);
+    if ((pins & mask) == 0)
+    {
+      continue;
+    }
+
+    old_level = (uint8_t)(port->IDR & mask);
+    if (high)
+    {
+      port->IDR |= mask;
+    }
+    else
+    {
+      port->IDR &= (uint8_t)~mask;
+    }
+
+    /* Interrupt only for inputs with external interrupt enabled */
+    if (((port->DDR & mask) != 0) || ((port->CR2 & mask) == 0))
+    {
+      continue;
+    }
+
+    sens = host_exti_sensitivity(line);
+    if (high)
+    {
+      edge = (old_level == 0) && ((sens == EXTI_Trigger_Rising) || (sens == EXTI_Trigger_Rising_Falling));
+    }
+    else
+    {
+      edge = (old_level != 0) && (sens != EXTI_Trigger_Rising);
+    }
+
+    if (edge)
+    {
+      EXTI->SR1 |= mask;
+      host_irq_raise((uint8_t)(HOST_VECTOR_EXTI0 + line));
+    }
+  }
+}
+
+/**
+ * @brief Get levels driven on a port
+ * @param port: GPIO port
+ * @retval ODR masked with the pins configured as outputs
+ */
+uint8_t host_gpio_output(GPIO_TypeDef* port)
+{
+  return (uint8_t)(port->ODR & port->DDR);
+}
+
+/******************************************************************************/
+/*                 C P U  I N S T R U C T I O N S  (intrinsics.h)             */
+/******************************************************************************/
+
+/**
+ * @brief RIM, enable interrupts and service anything already pending
+ */
+void host_cpu_rim(void)
+{
+  host_irq_enabled = TRUE;
+  host_irq_dispatch();
+}
+
+/**
+ * @brief SIM, mask interrupts
+ */
+void host_cpu_sim(void)
+{
+  host_irq_enabled = FALSE;
+}
+
+/**
+ * @brief PUSH CC, save the interrupt mask
+ * @retval Non-zero while interrupts are enabled
+ */
+__istate_t host_cpu_get_istate(void)
+{
+  return (__istate_t)host_irq_enabled;
+}
+
+/**
+ * @brief POP CC, restore an interrupt mask saved by host_cpu_get_istate()
+ * @param state: Saved interrupt mask
+ */
+void host_cpu_set_istate(__istate_t state)
+{
+  if (state != 0)
+  {
+    host_cpu_rim();
+  }
+  else
+  {
+    host_cpu_sim();
+  }
+}
+
+/**
+ * @brief WFI, service pending interrupts or hand control to the idle hook
+ */
+void host_cpu_wfi(void)
+{
+  host_cpu_idle(FALSE);
+}
+
+/**
+ * @brief HALT, as WFI but reported to the idle hook so it can account the lower power state
+ */
+void host_cpu_halt(void)
+{
+  host_cpu_idle(TRUE);
+}
+
+/**
+ * @brief Basic block executed, charge CPU time and let the rest of the system catch up
+ */
+void __sanitizer_cov_trace_pc(void)
+{
+  host_cycles += HOST_CYCLES_PER_BLOCK;
+  host_time_advance_to(host_time_ps + (HOST_CYCLES_PER_BLOCK * (HOST_HSI_PS_PER_CYCLE << (CLK->CKDIVR & 0x07))));
+  host_gpio_sample();
+  host_irq_dispatch();
+}
+
+/**
+ * @brief TRAP, software interrupt
+ */
+void host_cpu_trap(void)
+{
+  TRAP_IRQHandler();
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Service every pending interrupt, lowest vector number first (equal software priority)
+ */
+static void host_irq_dispatch(void)
+{
+  uint8_t vector;
+  unsigned long long start_ps;
+  unsigned long long start_cycles;
+
+  if ((host_irq_enabled == FALSE) || host_in_isr)
+  {
+    return;
+  }
+
+  while (host_irq_pending != 0)
+  {
+    for (vector=0; vector<HOST_NUM_VECTORS; vector++)
+    {
+      if ((host_irq_pending & ((uint32_t)1 << vector)) != 0)
+      {
+        break;
+      }
+    }
+
+    host_irq_pending &= ~((uint32_t)1 << vector);
+    host_irq_serviced[vector]++;
+    host_emu_progress();
+    host_trace_emit(HOST_TRACE_IRQ, vector, 0);
+
+    if (host_vectors[vector] != NULL)
+    {
+      start_ps = host_time_ps;
+      start_cycles = host_cycles;
+      host_in_isr = TRUE;
+      host_vectors[vector]();
+      host_in_isr = FALSE;
+      host_irq_account(vector, host_time_ps - start_ps, host_cycles - start_cycles);
+    }
+
+    host_irq_acknowledge(vector);
+  }
+}
+
+/**
+ * @brief Clear the source flag of a serviced interrupt
+ *
+ * Flags on the target are cleared by writing 1 (rc_w1), a memory write cannot express that so the model
+ * clears them once the handler returns. A handler that forgets to clear its flag is not detected.
+ */
+static void host_irq_acknowledge(uint8_t vector)
+{
+  if ((vector >= HOST_VECTOR_EXTI0) && (vector < (HOST_VECTOR_EXTI0 + 8)))
+  {
+    EXTI->SR1 &= (uint8_t)~(1 << (vector - HOST_VECTOR_EXTI0));
+  }
+  else if (vector == HOST_VECTOR_PVD)
+  {
+    PWR->CSR1 &= (uint8_t)~PWR_CSR1_PVDIF;
+  }
+}
+
+/**
+ * @brief Add one handler service to the vector's timing statistics
+ * @param vector: IRQ number
+ * @param ps: Service time in picoseconds
+ * @param cycles: CPU cycles charged during the service
+ */
+static void host_irq_account(uint8_t vector, unsigned long long ps, unsigned long long cycles)
+{
+  host_irq_stats_t* stats = &host_irq_timing[vector];
+  unsigned long long us = ps / 1000000ULL;
+  uint8_t bin = 0;
+
+  stats->count++;
+  stats->total_ns += ps / 1000ULL;
+  if ((ps / 1000ULL) >= stats->max_ns)
+  {
+    stats->max_ns = ps / 1000ULL;
+    stats->max_cycles = cycles;
+  }
+
+  while ((us != 0) && (bin < (HOST_IRQ_HIST_BINS - 1)))
+  {
+    us >>= 1;
+    bin++;
+  }
+  stats->hist[bin]++;
+}
+
+/**
+ * @brief Common WFI/HALT handling
+ * @param halted: TRUE for HALT
+ */
+static void host_cpu_idle(bool halted)
+{
+  unsigned long long next;
+  unsigned long long timer;
+
+  host_emu_progress();
+  host_gpio_sample();
+
+  /* Sleep through scheduled alarms until one of them (or a timer running in wait mode, the RTC wakeup timer) raises
+     an interrupt, timers alone do not keep the run going once no alarm is left */
+  host_cpu_mode = halted ? HOST_CPU_HALT : HOST_CPU_WAIT;
+  while (((host_irq_pending == 0) || (host_irq_enabled == FALSE)) && host_alarm_next(&next))
+  {
+    if (host_periph_next_event(&timer, halted) && ((host_time_ps + timer) < next))
+    {
+      next = host_time_ps + timer;
+    }
+    host_time_advance_to(next);
+  }
+  host_cpu_mode = HOST_CPU_RUN;
+
+  /* Nothing scheduled, the idle hook supplies the next stimulus */
+  if ((host_irq_pending == 0) || (host_irq_enabled == FALSE))
+  {
+    if ((host_idle_hook == NULL) || (host_idle_hook(halted) == FALSE))
+    {
+      longjmp(host_run_env, HOST_RUN_STOPPED);
+    }
+  }
+
+  host_irq_dispatch();
+}
+
+/**
+ * @brief Move virtual time forward, firing due alarms at their own deadline
+ * @param ps: Target time in picoseconds
+ */
+static void host_time_advance_to(unsigned long long ps)
+{
+  unsigned long long next;
+  host_alarm_t alarm;
+  uint8_t id;
+
+  while (host_alarm_next(&next) && (next <= ps))
+  {
+    for (id=0; id<HOST_NUM_ALARMS; id++)
+    {
+      if ((host_alarms[id] != NULL) && (host_alarm_deadline[id] == next))
+      {
+        break;
+      }
+    }
+
+    host_time_set(next);
+    alarm = host_alarms[id];
+    host_alarms[id] = NULL;
+    alarm();
+  }
+
+  host_time_set(ps);
+}
+
+/**
+ * @brief Set virtual time, accounting the elapsed time to the CPU mode and the peripheral timers
+ * @param ps: New time in picoseconds, ignored if not in the future
+ *
+ * DMA transfers drive outputs on their own, time stops at each one so the outputs are sampled when they change.
+ */
+static void host_time_set(unsigned long long ps)
+{
+  unsigned long long transfer;
+  bool halted = (host_cpu_mode == HOST_CPU_HALT) ? TRUE : FALSE;
+
+  while (host_periph_next_transfer(&transfer, halted) && ((host_time_ps + transfer) <= ps))
+  {
+    host_time_step(host_time_ps + transfer);
+    host_gpio_sample();
+  }
+
+  host_time_step(ps);
+}
+
+/**
+ * @brief Move virtual time forward without stopping
+ * @param ps: New time in picoseconds, ignored if not in the future
+ */
+static void host_time_step(unsigned long long ps)
+{
+  if (ps <= host_time_ps)
+  {
+    return;
+  }
+
+  host_residency_ps[host_cpu_mode] += ps - host_time_ps;
+  /* fMASTER is stopped in HALT, only the RTC keeps counting */
+  host_periph_advance(ps - host_time_ps, (host_cpu_mode == HOST_CPU_HALT) ? TRUE : FALSE);
+  host_time_ps = ps;
+}
+
+/**
+ * @brief Get the earliest scheduled alarm
+ * @param ps: Deadline in picoseconds
+ * @retval TRUE if an alarm is scheduled
+ */
+static bool host_alarm_next(unsigned long long* ps)
+{
+  bool found = FALSE;
+  uint8_t id;
+
+  for (id=0; id<HOST_NUM_ALARMS; id++)
+  {
+    if ((host_alarms[id] != NULL) && ((found == FALSE) || (host_alarm_deadline[id] < *ps)))
+    {
+      *ps = host_alarm_deadline[id];
+      found = TRUE;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * @brief Report ports whose driven levels changed since the last sample
+ */
+static void host_gpio_sample(void)
+{
+  uint8_t i;
+  uint8_t levels;
+
+  if (host_trace_hook == NULL)
+  {
+    return;
+  }
+
+  for (i=0; i<HOST_NUM_GPIO_PORTS; i++)
+  {
+    levels = host_gpio_output(host_gpio_ports[i]);
+    if (levels != host_gpio_levels[i])
+    {
+      host_gpio_levels[i] = levels;
+      host_trace_hook(HOST_TRACE_GPIO, i, levels);
+    }
+  }
+}
+
+/**
+ * @brief Get configured EXTI sensitivity of a pin interrupt line
+ * @param line: EXTI line (0 to 7)
+ * @retval EXTI_Trigger_TypeDef value
+ */
+static uint8_t host_exti_sensitivity(uint8_t line)
+{
+  uint8_t cr = (line < 4) ? EXTI->CR1 : EXTI->CR2;
+
+  return (uint8_t)((cr >> ((line % 4) * 2)) & 0x03);
+}
@@ -0,0 +1,254 @@
+/**
+ * @file host_emu.h
+ * @brief Function prototypes, defines and types for the host register-level peripheral emulator
+ */
+
+#ifndef HOST_EMU_H_
+#define HOST_EMU_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Number of interrupt vectors dispatched by the emulator (IRQ0 to IRQ29) */
+#define HOST_NUM_VECTORS 30
+
+/* Interrupt vector numbers used by the firmware, see stm8l15x_it.c */
+#define HOST_VECTOR_DMA1_CHANNEL0_1 2
+#define HOST_VECTOR_DMA1_CHANNEL2_3 3
+#define HOST_VECTOR_RTC 4
+#define HOST_VECTOR_PVD 5
+#define HOST_VECTOR_EXTI0 8
+#define HOST_VECTOR_TIM2_UPDATE 19
+#define HOST_VECTOR_TIM1_UPDATE 23
+
+/* Handler duration histogram, bin n counts services shorter than 2^n us (last bin is open ended) */
+#define HOST_IRQ_HIST_BINS 8
+
+/* CPU clock period with SYSCLK from the HSI (16 MHz) and no prescaler, CLK_CKDIVR scales it */
+#define HOST_HSI_PS_PER_CYCLE 62500ULL
+
+/* Average STM8 cycles charged per basic block of firmware code (coarse cost model, see host_emu.c) */
+#define HOST_CYCLES_PER_BLOCK 5
+
+/* Timed callbacks, one slot per user */
+#define HOST_ALARM_STIMULUS 0
+#define HOST_NUM_ALARMS 4
+
+/* GPIO ports sampled for output changes (GPIOA to GPIOF) */
+#define HOST_NUM_GPIO_PORTS 6
+
+/* UART frame length (start, 8 data, stop) */
+#define HOST_UART_FRAME_BITS 10
+
+/* Status polls without any other peripheral access before the emulator declares the firmware stuck */
+#define HOST_POLL_LIMIT 100000UL
+
+/* I2C bit times per bus event (START/STOP condition, byte plus acknowledge) */
+#define HOST_I2C_CONDITION_BITS 1
+#define HOST_I2C_BYTE_BITS 9
+
+/* Buffer sizes of the emulated host UART */
+#define HOST_UART_TX_SIZE 1024
+#define HOST_UART_RX_SIZE 256
+
+/* Factory Vrefint conversion byte (device information area) */
+#define HOST_VREFINT_FACTORY_ADDR 0x4910
+#define HOST_VREFINT_FACTORY_MSB 0x0600
+#define HOST_VREFINT_FACTORY_MV 3000UL
+
+/* Data EEPROM (low density device), backed by the register file, and the time of one word write (erase and
+   program) */
+#define HOST_EEPROM_START 0x1000
+#define HOST_EEPROM_SIZE 256
+#define HOST_EEPROM_WRITE_NS 6000000ULL
+
+/* Device defaults applied on reset */
+#define HOST_DEFAULT_VDD_MV 3000
+
+/* Brown-out reset threshold (highest falling edge level), a lower VDD resets the MCU and is reported as a fault */
+#define HOST_BOR_MV 1800
+#define HOST_DEFAULT_VREFINT_FACTORY 0x87
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Reason a firmware run returned control to the host
+ */
+typedef enum
+{
+  HOST_RUN_RETURNED, /* Entry function returned */
+
+  HOST_RUN_STOPPED, /* Idle hook ended the run */
+
+  HOST_RUN_FAULT /* Emulator detected a fault, see host_emu_fault_msg() */
+
+} host_run_result_t;
+
+/**
+ * @brief Called whenever the firmware waits (WFI) or halts with no interrupt pending
+ * @param halted: TRUE if the CPU executed HALT, FALSE for WFI
+ * @retval TRUE to continue running (after injecting stimulus), FALSE to end the run
+ */
+typedef bool (*host_idle_hook_t)(bool halted);
+
+/**
+ * @brief CPU power mode, virtual time is accounted to the mode it was spent in
+ */
+typedef enum
+{
+  HOST_CPU_RUN, /* Executing code, including busy waits on peripherals */
+
+  HOST_CPU_WAIT, /* WFI */
+
+  HOST_CPU_HALT, /* HALT */
+
+  HOST_CPU_NUM_MODES
+
+} host_cpu_mode_t;
+
+/**
+ * @brief Interrupt handler timing, measured from handler entry to return in virtual time
+ */
+typedef struct
+{
+  uint32_t count;
+
+  unsigned long long total_ns;
+
+  unsigned long long max_ns;
+
+  unsigned long long max_cycles; /* CPU cycles charged during the longest service */
+
+  uint32_t hist[HOST_IRQ_HIST_BINS];
+
+} host_irq_stats_t;
+
+/**
+ * @brief Timed callback, runs when virtual time reaches its deadline (also in the middle of firmware code)
+ */
+typedef void (*host_alarm_t)(void);
+
+/**
+ * @brief Output events reported to the trace hook
+ */
+typedef enum
+{
+  HOST_TRACE_GPIO, /* Driven levels of a port changed, index is the port (0 = GPIOA), value the new levels */
+
+  HOST_TRACE_UART_TX, /* Byte transmitted on USART1 */
+
+  HOST_TRACE_SPI_TX, /* Byte shifted out on SPI1 MOSI, most significant bit first */
+
+  HOST_TRACE_IRQ /* Interrupt serviced, index is the vector */
+
+} host_trace_t;
+
+/**
+ * @brief Called for every output event, timestamp with host_time_ns()
+ */
+typedef void (*host_trace_hook_t)(host_trace_t event, uint8_t index, uint8_t value);
+
+/**
+ * @brief I2C slave device attached to the emulated I2C1 bus, every callback is optional
+ */
+typedef struct
+{
+  uint8_t address; /* 7 bit slave address */
+
+  void* ctx;
+
+  bool (*start)(void* ctx, bool read); /* Address phase, return TRUE to acknowledge */
+
+  bool (*write)(void* ctx, uint8_t data); /* Byte written by master, return TRUE to acknowledge */
+
+  uint8_t (*read)(void* ctx); /* Byte requested by master */
+
+  void (*stop)(void* ctx); /* Stop condition */
+
+  uint16_t stretch; /* Clock stretching, status polls each data byte is held off for */
+
+  bool sda_stuck; /* Slave holds SDA low, the bus never becomes free */
+
+} host_i2c_slave_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+
+/* Emulator core */
+void host_emu_reset(void);
+host_run_result_t host_emu_run(void (*entry)(void), host_idle_hook_t idle);
+void host_emu_fault(const char* msg);
+const char* host_emu_fault_msg(void);
+void host_emu_stop(void);
+void host_emu_poll(const char* what);
+void host_emu_progress(void);
+
+/* Virtual time */
+unsigned long long host_time_ns(void);
+unsigned long long host_cpu_cycles(void);
+unsigned long long host_residency_ns(host_cpu_mode_t mode);
+void host_time_advance_ns(unsigned long long ns);
+void host_alarm_set(uint8_t id, unsigned long long deadline_ns, host_alarm_t alarm);
+void host_alarm_cancel(uint8_t id);
+
+/* Output tracing */
+void host_trace_set_hook(host_trace_hook_t hook);
+void host_trace_emit(host_trace_t event, uint8_t index, uint8_t value);
+
+/* Interrupts */
+void host_irq_raise(uint8_t vector);
+uint32_t host_irq_count(uint8_t vector);
+const host_irq_stats_t* host_irq_stats(uint8_t vector);
+
+/* GPIO and EXTI */
+void host_gpio_input(GPIO_TypeDef* port, uint8_t pins, bool high);
+uint8_t host_gpio_output(GPIO_TypeDef* port);
+
+/* USART1 */
+void host_uart_rx_push(const char* data, uint16_t len);
+const char* host_uart_tx(void);
+uint16_t host_uart_tx_len(void);
+void host_uart_tx_clear(void);
+unsigned long long host_uart_tx_ns(void);
+
+/* DMA1 */
+uint32_t host_dma_transfers(uint8_t channel);
+
+/* SPI1 */
+uint32_t host_spi_tx_bytes(void);
+void host_spi_stall(bool stalled);
+
+/* I2C1 */
+void host_i2c_attach(host_i2c_slave_t* slave);
+uint32_t host_i2c_bus_bits(void);
+unsigned long long host_i2c_bus_ns(void);
+
+/* LSI oscillator */
+void host_lsi_set_hz(unsigned long hz);
+
+/* Supply voltage (ADC Vrefint conversion and PVD) */
+void host_vdd_set_mv(uint16_t mv);
+uint16_t host_vdd_mv(void);
+
+/* Data EEPROM, erased (0x00) on reset */
+void host_eeprom_load(uint16_t offset, const uint8_t* data, uint16_t len);
+uint8_t host_eeprom_read(uint16_t offset);
+uint32_t host_eeprom_writes(uint16_t offset);
+unsigned long long host_eeprom_ns(void);
+
+/* Peripheral model reset and timers, called from host_emu.c */
+void host_periph_reset(void);
+void host_periph_advance(unsigned long long ps, bool halted);
+bool host_periph_next_event(unsigned long long* ps, bool halted);
+bool host_periph_next_transfer(unsigned long long* ps, bool halted);
+
+#endif /* HOST_EMU_H_ */
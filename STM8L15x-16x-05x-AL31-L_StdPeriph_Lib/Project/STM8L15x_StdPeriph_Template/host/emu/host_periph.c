@@ -0,0 +1,1448 @@
+/**
+ * @file host_periph.c
+ * @brief Host peripheral models (CLK, PWR, ADC, USART1, I2C1, SPI1 transmit, FLASH/data EEPROM, TIM1/TIM2 time base, TIM2 compare and SPI1 DMA requests, DMA1, RTC wakeup timer), hooked into StdPeriph drivers with ld --wrap
+ *
+ * Each __wrap_X replaces calls to the StdPeriph function X made from the firmware, the original driver is
+ * still available as __real_X and is called to perform the register access. The model then updates the
+ * registers the way the peripheral would.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <string.h>
+
+#include "host_emu.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Number of PVD thresholds selectable by PWR_CSR1 PLS */
+#define HOST_PVD_NUM_LEVELS 8
+
+/* DMA1 channels, and the channels serving the TIM2 compare requests (CC1, CC2) and SPI1 transmit requests */
+#define HOST_DMA_NUM_CHANNELS 4
+#define HOST_DMA_TIM2_CC1 0
+#define HOST_DMA_TIM2_CC2 2
+#define HOST_DMA_SPI1_TX 2
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* PVD threshold per PLS setting in millivolts, the last setting selects the external PVD_IN pin */
+static const uint16_t host_pvd_levels_mv[HOST_PVD_NUM_LEVELS] = {
+  1850, 2050, 2260, 2450, 2650, 2850, 3050, 0
+};
+
+/* Supply voltage seen by the ADC and PVD */
+static uint16_t host_vdd;
+
+/* LSI frequency, the RC oscillator spreads widely between parts */
+static unsigned long host_lsi_hz;
+
+/* USART1 transmit log and receive queue */
+static char host_uart_tx_buf[HOST_UART_TX_SIZE + 1];
+static uint16_t host_uart_tx_count;
+static char host_uart_rx_buf[HOST_UART_RX_SIZE];
+static uint16_t host_uart_rx_head;
+static uint16_t host_uart_rx_tail;
+
+/* I2C1 bus state */
+static host_i2c_slave_t* host_i2c_dev;
+static bool host_i2c_acked; /* Slave acknowledged the current address phase */
+static bool host_i2c_reading; /* Current transfer is master receiver */
+static bool host_i2c_stop_pending; /* STOP requested while receiving */
+static bool host_i2c_last_loaded; /* Final byte of a receive transfer is in DR */
+static uint16_t host_i2c_hold; /* Remaining clock stretch polls */
+static uint8_t host_i2c_held_sr1; /* Transmit flags set once the stretch ends */
+static uint32_t host_i2c_bits; /* Bus bit times used since reset */
+static unsigned long long host_i2c_ns; /* Bus time used since reset */
+static unsigned long long host_uart_ns; /* Transmit time used since reset */
+
+/* Data EEPROM write cycles per byte and time spent writing */
+static uint32_t host_eeprom_cycles[HOST_EEPROM_SIZE];
+static unsigned long long host_eeprom_busy_ns;
+
+/* Up-counting time bases (TIM1, TIM2), registers shared by both layouts */
+typedef struct
+{
+  volatile uint8_t* cr1;
+
+  volatile uint8_t* ier;
+
+  volatile uint8_t* sr1;
+
+  volatile uint8_t* egr;
+
+  volatile uint8_t* cntrh; /* CNTRL follows */
+
+  volatile uint8_t* arrh; /* ARRL follows */
+
+  volatile uint8_t* der; /* Compare DMA requests (CC1, CC2), NULL if not modelled */
+
+  volatile uint8_t* ccr1h; /* CCR1L, CCR2H, CCR2L follow */
+
+  uint8_t vector;
+
+  unsigned long long ps; /* Time not yet converted to counter ticks, in picoseconds */
+
+} host_tim_t;
+
+#define HOST_NUM_TIMERS 2
+
+static host_tim_t host_tims[HOST_NUM_TIMERS];
+
+/* RTC wakeup timer, time not yet converted to wakeup events in picoseconds */
+static unsigned long long host_rtc_ps;
+
+/* DMA1 channels, memory buffer (host address, the 16 bit address registers cannot hold it) and transfer count set
+   by DMA_Init(), transfers made since reset */
+static DMA_Channel_TypeDef* host_dma_channels[HOST_DMA_NUM_CHANNELS];
+static volatile uint8_t* host_dma_mem[HOST_DMA_NUM_CHANNELS];
+static uint8_t host_dma_size[HOST_DMA_NUM_CHANNELS];
+static uint32_t host_dma_count[HOST_DMA_NUM_CHANNELS];
+
+/* Bytes shifted out on SPI1 since reset */
+static uint32_t host_spi_tx_count;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void host_clk_sync(void);
+static void host_pvd_sync(void);
+static void host_uart_sync(void);
+static void host_i2c_sync(void);
+static void host_i2c_idle(void);
+static void host_i2c_bus(uint8_t bits);
+static unsigned long long host_fmaster_hz(void);
+static unsigned long long host_tim_period(uint8_t id);
+static void host_tim_advance(host_tim_t* tim, unsigned long long period, unsigned long long ps);
+static void host_tim_compare(host_tim_t* tim, unsigned long count, unsigned long long ticks, unsigned long arr);
+static unsigned long host_tim_next_compare(host_tim_t* tim, unsigned long count, unsigned long arr);
+static void host_dma_request(uint8_t ch);
+static void host_spi_sync(void);
+static void host_rtc_sync(void);
+static unsigned long long host_rtc_interval(void);
+static void host_rtc_advance(unsigned long long ps);
+
+/* Original StdPeriph drivers */
+FlagStatus __real_CLK_GetFlagStatus(CLK_FLAG_TypeDef CLK_FLAG);
+FlagStatus __real_PWR_GetFlagStatus(PWR_FLAG_TypeDef PWR_FLAG);
+void __real_ADC_SoftwareStartConv(ADC_TypeDef* ADCx);
+FlagStatus __real_ADC_GetFlagStatus(ADC_TypeDef* ADCx, ADC_FLAG_TypeDef ADC_FLAG);
+void __real_USART_SendData8(USART_TypeDef* USARTx, uint8_t Data);
+uint8_t __real_USART_ReceiveData8(USART_TypeDef* USARTx);
+FlagStatus __real_USART_GetFlagStatus(USART_TypeDef* USARTx, USART_FLAG_TypeDef USART_FLAG);
+void __real_I2C_GenerateSTART(I2C_TypeDef* I2Cx, FunctionalState NewState);
+void __real_I2C_GenerateSTOP(I2C_TypeDef* I2Cx, FunctionalState NewState);
+void __real_I2C_Send7bitAddress(I2C_TypeDef* I2Cx, uint8_t Address, I2C_Direction_TypeDef I2C_Direction);
+void __real_I2C_SendData(I2C_TypeDef* I2Cx, uint8_t Data);
+uint8_t __real_I2C_ReceiveData(I2C_TypeDef* I2Cx);
+void __real_FLASH_Unlock(FLASH_MemType_TypeDef FLASH_MemType);
+ErrorStatus __real_I2C_CheckEvent(I2C_TypeDef* I2Cx, I2C_Event_TypeDef I2C_Event);
+FlagStatus __real_I2C_GetFlagStatus(I2C_TypeDef* I2Cx, I2C_FLAG_TypeDef I2C_FLAG);
+void __real_SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState);
+void __real_SPI_DMACmd(SPI_TypeDef* SPIx, SPI_DMAReq_TypeDef SPI_DMAReq, FunctionalState NewState);
+FlagStatus __real_SPI_GetFlagStatus(SPI_TypeDef* SPIx, SPI_FLAG_TypeDef SPI_FLAG);
+
+/* Models, prototypes only needed to keep -Wmissing-prototypes quiet */
+FlagStatus __wrap_CLK_GetFlagStatus(CLK_FLAG_TypeDef CLK_FLAG);
+FlagStatus __wrap_PWR_GetFlagStatus(PWR_FLAG_TypeDef PWR_FLAG);
+void __wrap_ADC_SoftwareStartConv(ADC_TypeDef* ADCx);
+FlagStatus __wrap_ADC_GetFlagStatus(ADC_TypeDef* ADCx, ADC_FLAG_TypeDef ADC_FLAG);
+void __wrap_USART_SendData8(USART_TypeDef* USARTx, uint8_t Data);
+uint8_t __wrap_USART_ReceiveData8(USART_TypeDef* USARTx);
+FlagStatus __wrap_USART_GetFlagStatus(USART_TypeDef* USARTx, USART_FLAG_TypeDef USART_FLAG);
+void __wrap_I2C_GenerateSTART(I2C_TypeDef* I2Cx, FunctionalState NewState);
+void __wrap_I2C_GenerateSTOP(I2C_TypeDef* I2Cx, FunctionalState NewState);
+void __wrap_I2C_Send7bitAddress(I2C_TypeDef* I2Cx, uint8_t Address, I2C_Direction_TypeDef I2C_Direction);
+void __wrap_I2C_SendData(I2C_TypeDef* I2Cx, uint8_t Data);
+uint8_t __wrap_I2C_ReceiveData(I2C_TypeDef* I2Cx);
+ErrorStatus __wrap_I2C_CheckEvent(I2C_TypeDef* I2Cx, I2C_Event_TypeDef I2C_Event);
+FlagStatus __wrap_I2C_GetFlagStatus(I2C_TypeDef* I2Cx, I2C_FLAG_TypeDef I2C_FLAG);
+void __wrap_SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState);
+void __wrap_SPI_DMACmd(SPI_TypeDef* SPIx, SPI_DMAReq_TypeDef SPI_DMAReq, FunctionalState NewState);
+FlagStatus __wrap_SPI_GetFlagStatus(SPI_TypeDef* SPIx, SPI_FLAG_TypeDef SPI_FLAG);
+uint8_t __wrap_FLASH_ReadByte(uint32_t Address);
+void __wrap_FLASH_Unlock(FLASH_MemType_TypeDef FLASH_MemType);
+void __wrap_FLASH_ProgramWord(uint32_t Address, uint32_t Data);
+FLASH_Status_TypeDef __wrap_FLASH_WaitForLastOperation(FLASH_MemType_TypeDef FLASH_MemType);
+void __wrap_DMA_Init(DMA_Channel_TypeDef* DMA_Channelx, uint32_t DMA_Memory0BaseAddr,
+                     uint16_t DMA_PeripheralMemory1BaseAddr, uint8_t DMA_BufferSize, DMA_DIR_TypeDef DMA_DIR,
+                     DMA_Mode_TypeDef DMA_Mode, DMA_MemoryIncMode_TypeDef DMA_MemoryIncMode,
+                     DMA_Priority_TypeDef DMA_Priority, DMA_MemoryDataSize_TypeDef DMA_MemoryDataSize);
+void __real_DMA_Init(DMA_Channel_TypeDef* DMA_Channelx, uint32_t DMA_Memory0BaseAddr,
+                     uint16_t DMA_PeripheralMemory1BaseAddr, uint8_t DMA_BufferSize, DMA_DIR_TypeDef DMA_DIR,
+                     DMA_Mode_TypeDef DMA_Mode, DMA_MemoryIncMode_TypeDef DMA_MemoryIncMode,
+                     DMA_Priority_TypeDef DMA_Priority, DMA_MemoryDataSize_TypeDef DMA_MemoryDataSize);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Reset every peripheral model, called from host_emu_reset() after the register file is cleared
+ */
+void host_periph_reset(void)
+{
+  host_vdd = HOST_DEFAULT_VDD_MV;
+  host_lsi_hz = LSI_VALUE;
+  host_io[HOST_VREFINT_FACTORY_ADDR] = HOST_DEFAULT_VREFINT_FACTORY;
+
+  host_uart_tx_count = 0;
+  host_uart_tx_buf[0] = '\0';
+  host_uart_rx_head = 0;
+  host_uart_rx_tail = 0;
+
+  host_i2c_dev = NULL;
+  host_i2c_bits = 0;
+  host_i2c_ns = 0;
+  host_uart_ns = 0;
+  memset(host_eeprom_cycles, 0, sizeof(host_eeprom_cycles));
+  host_eeprom_busy_ns = 0;
+  host_tims[0].cr1 = &TIM1->CR1;
+  host_tims[0].ier = &TIM1->IER;
+  host_tims[0].sr1 = &TIM1->SR1;
+  host_tims[0].egr = &TIM1->EGR;
+  host_tims[0].cntrh = &TIM1->CNTRH;
+  host_tims[0].arrh = &TIM1->ARRH;
+  host_tims[0].der = NULL;
+  host_tims[0].ccr1h = NULL;
+  host_tims[0].vector = HOST_VECTOR_TIM1_UPDATE;
+  host_tims[0].ps = 0;
+  host_tims[1].cr1 = &TIM2->CR1;
+  host_tims[1].ier = &TIM2->IER;
+  host_tims[1].sr1 = &TIM2->SR1;
+  host_tims[1].egr = &TIM2->EGR;
+  host_tims[1].cntrh = &TIM2->CNTRH;
+  host_tims[1].arrh = &TIM2->ARRH;
+  host_tims[1].der = &TIM2->DER;
+  host_tims[1].ccr1h = &TIM2->CCR1H;
+  host_tims[1].vector = HOST_VECTOR_TIM2_UPDATE;
+  host_tims[1].ps = 0;
+  host_rtc_ps = 0;
+  host_dma_channels[0] = DMA1_Channel0;
+  host_dma_channels[1] = DMA1_Channel1;
+  host_dma_channels[2] = DMA1_Channel2;
+  host_dma_channels[3] = DMA1_Channel3;
+  memset((void*)host_dma_mem, 0, sizeof(host_dma_mem));
+  memset(host_dma_size, 0, sizeof(host_dma_size));
+  memset(host_dma_count, 0, sizeof(host_dma_count));
+  host_spi_tx_count = 0;
+  SPI1->SR = SPI_SR_TXE;
+  host_i2c_idle();
+}
+
+/**
+ * @brief Let the peripheral timers run, TIM1 counts up at fMASTER / (PSCR + 1) and TIM2 at fMASTER / 2^PSCR while
+ * clocked and enabled, the RTC wakeup timer counts from the LSI/LSE also in HALT
+ * @param ps: Elapsed time in picoseconds
+ * @param halted: TRUE if the time was spent in HALT (fMASTER stopped)
+ *
+ * Counter overflow past ARR sets UIF and raises the update interrupt if enabled, a software update event (EGR UG)
+ * restarts the counter and sets UIF. Prescaler and ARR are used as written (no preload), only the up-counting
+ * time base is modelled. TIM2 counting to CCR1/CCR2 sets CC1IF/CC2IF and, with the request enabled in DER, makes
+ * a DMA1 transfer. Every elapsed wakeup period sets WUTF and raises the RTC interrupt if enabled.
+ */
+void host_periph_advance(unsigned long long ps, bool halted)
+{
+  uint8_t id;
+
+  host_rtc_sync();
+  host_rtc_advance(ps);
+
+  if (halted)
+  {
+    return;
+  }
+
+  for (id=0; id<HOST_NUM_TIMERS; id++)
+  {
+    host_tim_advance(&host_tims[id], host_tim_period(id), ps);
+  }
+}
+
+/**
+ * @brief Get the time until the next timer update or RTC wakeup interrupt, or the next TIM2 compare DMA request
+ * @param ps: Picoseconds from now
+ * @param halted: TRUE in HALT, only the RTC keeps counting
+ * @retval TRUE if a timer is running with its interrupt or a DMA request enabled
+ */
+bool host_periph_next_event(unsigned long long* ps, bool halted)
+{
+  unsigned long long period;
+  unsigned long long next;
+  unsigned long arr;
+  unsigned long count;
+  host_tim_t* tim;
+  bool found = FALSE;
+  uint8_t id;
+
+  period = host_rtc_interval();
+  if ((period != 0) && ((RTC->CR2 & RTC_CR2_WUTIE) != 0))
+  {
+    *ps = period - host_rtc_ps;
+    found = TRUE;
+  }
+
+  for (id=0; (halted == FALSE) && (id < HOST_NUM_TIMERS); id++)
+  {
+    tim = &host_tims[id];
+    period = host_tim_period(id);
+    if (period == 0)
+    {
+      continue;
+    }
+
+    arr = ((unsigned long)tim->arrh[0] << 8) | tim->arrh[1];
+    count = ((unsigned long)tim->cntrh[0] << 8) | tim->cntrh[1];
+    if ((*tim->ier & TIM_IER_UIE) != 0)
+    {
+      next = (((arr >= count) ? (arr - count) : 0) + 1) * period - tim->ps;
+    }
+    else if ((tim->der != NULL) && ((*tim->der & (TIM2_DMASource_CC1 | TIM2_DMASource_CC2)) != 0))
+    {
+      next = host_tim_next_compare(tim, count, arr) * period - tim->ps;
+    }
+    else
+    {
+      continue;
+    }
+    if ((found == FALSE) || (next < *ps))
+    {
+      *ps = next;
+      found = TRUE;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * @brief Get the time until the next TIM2 compare DMA request
+ * @param ps: Picoseconds from now
+ * @param halted: TRUE in HALT, timers are stopped
+ * @retval TRUE if a timer is running with a DMA request enabled
+ */
+bool host_periph_next_transfer(unsigned long long* ps, bool halted)
+{
+  unsigned long long period;
+  unsigned long arr;
+  unsigned long count;
+  host_tim_t* tim;
+  uint8_t id;
+
+  for (id=0; (halted == FALSE) && (id < HOST_NUM_TIMERS); id++)
+  {
+    tim = &host_tims[id];
+    period = host_tim_period(id);
+    if ((period == 0) || (tim->der == NULL) || ((*tim->der & (TIM2_DMASource_CC1 | TIM2_DMASource_CC2)) == 0))
+    {
+      continue;
+    }
+
+    arr = ((unsigned long)tim->arrh[0] << 8) | tim->arrh[1];
+    count = ((unsigned long)tim->cntrh[0] << 8) | tim->cntrh[1];
+    *ps = host_tim_next_compare(tim, count, arr) * period - tim->ps;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+ * @brief Preset data EEPROM content (contents written before this boot), does not count as a write
+ * @param offset: Offset from the start of data EEPROM
+ * @param data: Bytes
+ * @param len: Number of bytes, clipped to the end of data EEPROM
+ */
+void host_eeprom_load(uint16_t offset, const uint8_t* data, uint16_t len)
+{
+  uint16_t i;
+
+  for (i=0; (i < len) && ((offset + i) < HOST_EEPROM_SIZE); i++)
+  {
+    host_io[HOST_EEPROM_START + offset + i] = data[i];
+  }
+}
+
+/**
+ * @brief Read a data EEPROM byte
+ * @param offset: Offset from the start of data EEPROM
+ * @retval Byte, 0 outside data EEPROM
+ */
+uint8_t host_eeprom_read(uint16_t offset)
+{
+  return (offset < HOST_EEPROM_SIZE) ? host_io[HOST_EEPROM_START + offset] : 0;
+}
+
+/**
+ * @brief Get the number of write cycles a data EEPROM byte has seen
+ * @param offset: Offset from the start of data EEPROM
+ * @retval Writes since reset
+ */
+uint32_t host_eeprom_writes(uint16_t offset)
+{
+  return (offset < HOST_EEPROM_SIZE) ? host_eeprom_cycles[offset] : 0;
+}
+
+/**
+ * @brief Get the time the firmware spent writing data EEPROM
+ * @retval Write time since reset in ns
+ */
+unsigned long long host_eeprom_ns(void)
+{
+  return host_eeprom_busy_ns;
+}
+
+/**
+ * @brief Queue bytes to be received by USART1, lost if the USART1 clock is gated (receiver stopped)
+ * @param data: Bytes sent by the host PC
+ * @param len: Number of bytes
+ */
+void host_uart_rx_push(const char* data, uint16_t len)
+{
+  uint16_t i;
+
+  if ((CLK->PCKENR1 & (uint8_t)(1 << (CLK_Peripheral_USART1 & 0x0F))) == 0)
+  {
+    return;
+  }
+
+  for (i=0; i<len; i++)
+  {
+    if ((uint16_t)((host_uart_rx_tail + 1) % HOST_UART_RX_SIZE) == host_uart_rx_head)
+    {
+      host_emu_fault("host UART receive queue overflow");
+    }
+    host_uart_rx_buf[host_uart_rx_tail] = data[i];
+    host_uart_rx_tail = (uint16_t)((host_uart_rx_tail + 1) % HOST_UART_RX_SIZE);
+  }
+}
+
+/**
+ * @brief Get the number of transfers a DMA1 channel has made
+ * @param channel: Channel number (0 to 3)
+ * @retval Transfers since reset
+ */
+uint32_t host_dma_transfers(uint8_t channel)
+{
+  return (channel < HOST_DMA_NUM_CHANNELS) ? host_dma_count[channel] : 0;
+}
+
+/**
+ * @brief Get the number of bytes SPI1 has shifted out
+ * @retval Bytes since reset
+ */
+uint32_t host_spi_tx_bytes(void)
+{
+  return host_spi_tx_count;
+}
+
+/**
+ * @brief Stop the SPI1 shift clock, the last byte handed over never leaves (TXE clear, BSY set) until it runs again
+ * @param stalled: TRUE to stop the clock
+ */
+void host_spi_stall(bool stalled)
+{
+  SPI1->SR = stalled ? SPI_SR_BSY : SPI_SR_TXE;
+}
+
+/**
+ * @brief Get everything transmitted on USART1 since reset or the last host_uart_tx_clear()
+ * @retval NULL terminated transmit log
+ */
+const char* host_uart_tx(void)
+{
+  return host_uart_tx_buf;
+}
+
+/**
+ * @brief Get number of bytes in the transmit log
+ * @retval Byte count
+ */
+uint16_t host_uart_tx_len(void)
+{
+  return host_uart_tx_count;
+}
+
+/**
+ * @brief Empty the transmit log
+ */
+void host_uart_tx_clear(void)
+{
+  host_uart_tx_count = 0;
+  host_uart_tx_buf[0] = '\0';
+}
+
+/**
+ * @brief Get time spent transmitting
+ * @retval Nanoseconds of frames sent on USART1 since reset
+ */
+unsigned long long host_uart_tx_ns(void)
+{
+  return host_uart_ns;
+}
+
+/**
+ * @brief Attach a slave device to I2C1, replaces any previously attached device
+ * @param slave: Device, NULL leaves the bus empty (every address is NACKed)
+ */
+void host_i2c_attach(host_i2c_slave_t* slave)
+{
+  host_i2c_dev = slave;
+}
+
+/**
+ * @brief Get bus time used by the firmware, divide by the bus speed for seconds
+ * @retval Bit times (conditions plus bytes with acknowledge) since reset, clock stretching excluded
+ */
+uint32_t host_i2c_bus_bits(void)
+{
+  return host_i2c_bits;
+}
+
+/**
+ * @brief Get bus time used by the firmware
+ * @retval Nanoseconds at the programmed SCL rate since reset, clock stretching excluded
+ */
+unsigned long long host_i2c_bus_ns(void)
+{
+  return host_i2c_ns;
+}
+
+/**
+ * @brief Change the LSI frequency, the RTC clocked from it runs fast or slow
+ * @param hz: LSI frequency in Hz (LSI_VALUE after reset)
+ */
+void host_lsi_set_hz(unsigned long hz)
+{
+  host_lsi_hz = hz;
+}
+
+/**
+ * @brief Change supply voltage, PVD crossings raise the PVD interrupt if enabled, below HOST_BOR_MV the run faults
+ * @param mv: VDD in millivolts
+ */
+void host_vdd_set_mv(uint16_t mv)
+{
+  host_vdd = mv;
+  if (mv < HOST_BOR_MV)
+  {
+    host_emu_fault("brown-out reset");
+  }
+  host_pvd_sync();
+}
+
+/**
+ * @brief Get supply voltage
+ * @retval VDD in millivolts
+ */
+uint16_t host_vdd_mv(void)
+{
+  return host_vdd;
+}
+
+/******************************************************************************/
+/*                    C L K  /  P W R  /  A D C  /  F L A S H                 */
+/******************************************************************************/
+
+FlagStatus __wrap_CLK_GetFlagStatus(CLK_FLAG_TypeDef CLK_FLAG)
+{
+  host_emu_poll("CLK_GetFlagStatus");
+  host_clk_sync();
+  return __real_CLK_GetFlagStatus(CLK_FLAG);
+}
+
+FlagStatus __wrap_PWR_GetFlagStatus(PWR_FLAG_TypeDef PWR_FLAG)
+{
+  host_emu_poll("PWR_GetFlagStatus");
+
+  /* Internal reference is modelled as always settled */
+  PWR->CSR2 |= PWR_CR2_VREFINTF;
+  host_pvd_sync();
+
+  return __real_PWR_GetFlagStatus(PWR_FLAG);
+}
+
+/**
+ * @brief Conversion completes immediately, only the Vrefint channel has a modelled input
+ */
+void __wrap_ADC_SoftwareStartConv(ADC_TypeDef* ADCx)
+{
+  uint16_t raw = 0;
+  uint16_t cal;
+
+  host_emu_progress();
+  __real_ADC_SoftwareStartConv(ADCx);
+
+  if (((ADCx->CR1 & ADC_CR1_ADON) != 0) && ((ADCx->SQR[0] & (uint8_t)ADC_Channel_Vrefint) != 0) && (host_vdd != 0))
+  {
+    cal = (uint16_t)(HOST_VREFINT_FACTORY_MSB | host_io[HOST_VREFINT_FACTORY_ADDR]);
+    raw = (uint16_t)((HOST_VREFINT_FACTORY_MV * cal) / host_vdd);
+    if (raw > 0x0FFF)
+    {
+      raw = 0x0FFF;
+    }
+  }
+
+  ADCx->DRH = (uint8_t)(raw >> 8);
+  ADCx->DRL = (uint8_t)raw;
+  ADCx->SR |= ADC_SR_EOC;
+  ADCx->CR1 &= (uint8_t)~ADC_CR1_START;
+}
+
+FlagStatus __wrap_ADC_GetFlagStatus(ADC_TypeDef* ADCx, ADC_FLAG_TypeDef ADC_FLAG)
+{
+  host_emu_poll("ADC_GetFlagStatus");
+  return __real_ADC_GetFlagStatus(ADCx, ADC_FLAG);
+}
+
+/**
+ * @brief Byte read from the flash/option/factory area, only the area covered by the register file is backed
+ */
+uint8_t __wrap_FLASH_ReadByte(uint32_t Address)
+{
+  host_emu_progress();
+
+  if (Address >= HOST_IO_SIZE)
+  {
+    return 0;
+  }
+
+  return host_io[Address];
+}
+
+/**
+ * @brief Memory unlock, the data EEPROM write protection (DUL) is released by the key sequence
+ */
+void __wrap_FLASH_Unlock(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  __real_FLASH_Unlock(FLASH_MemType);
+  if (FLASH_MemType == FLASH_MemType_Data)
+  {
+    FLASH->IAPSR |= FLASH_IAPSR_DUL;
+  }
+}
+
+/**
+ * @brief Word write, only data EEPROM is modelled, the CPU is held for the write time
+ *
+ * A write to locked or program memory is discarded and sets WR_PG_DIS, completed writes set EOP and HVOFF.
+ */
+void __wrap_FLASH_ProgramWord(uint32_t Address, uint32_t Data)
+{
+  uint16_t offset = (uint16_t)(Address - HOST_EEPROM_START);
+  uint8_t i;
+
+  host_emu_progress();
+
+  if ((Address < HOST_EEPROM_START) || ((offset + 4) > HOST_EEPROM_SIZE) || ((FLASH->IAPSR & FLASH_IAPSR_DUL) == 0))
+  {
+    FLASH->IAPSR |= FLASH_IAPSR_WR_PG_DIS;
+    return;
+  }
+
+  /* Bytes in target (big endian) memory order, as the library copies them from Data */
+  for (i=0; i<4; i++)
+  {
+    host_io[Address + i] = (uint8_t)(Data >> (8 * (3 - i)));
+    host_eeprom_cycles[offset + i]++;
+  }
+  host_eeprom_busy_ns += HOST_EEPROM_WRITE_NS;
+  host_time_advance_ns(HOST_EEPROM_WRITE_NS);
+  FLASH->IAPSR |= (uint8_t)(FLASH_IAPSR_EOP | FLASH_IAPSR_HVOFF);
+}
+
+/**
+ * @brief Status poll after a write, the write already completed in __wrap_FLASH_ProgramWord()
+ */
+FLASH_Status_TypeDef __wrap_FLASH_WaitForLastOperation(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  uint8_t status = FLASH->IAPSR;
+
+  (void)FLASH_MemType;
+  host_emu_progress();
+
+  /* Flags clear on read */
+  FLASH->IAPSR &= (uint8_t)~(FLASH_IAPSR_EOP | FLASH_IAPSR_HVOFF | FLASH_IAPSR_WR_PG_DIS);
+
+  return ((status & FLASH_IAPSR_WR_PG_DIS) != 0) ? FLASH_Status_Write_Protection_Error : FLASH_Status_Successful_Operation;
+}
+
+/******************************************************************************/
+/*                                D M A 1                                     */
+/******************************************************************************/
+
+/**
+ * @brief Channel setup, the memory buffer is kept as a host address
+ */
+void __wrap_DMA_Init(DMA_Channel_TypeDef* DMA_Channelx, uint32_t DMA_Memory0BaseAddr,
+                     uint16_t DMA_PeripheralMemory1BaseAddr, uint8_t DMA_BufferSize, DMA_DIR_TypeDef DMA_DIR,
+                     DMA_Mode_TypeDef DMA_Mode, DMA_MemoryIncMode_TypeDef DMA_MemoryIncMode,
+                     DMA_Priority_TypeDef DMA_Priority, DMA_MemoryDataSize_TypeDef DMA_MemoryDataSize)
+{
+  uint8_t ch;
+
+  host_emu_progress();
+  __real_DMA_Init(DMA_Channelx, DMA_Memory0BaseAddr, DMA_PeripheralMemory1BaseAddr, DMA_BufferSize, DMA_DIR,
+                  DMA_Mode, DMA_MemoryIncMode, DMA_Priority, DMA_MemoryDataSize);
+
+  for (ch=0; ch<HOST_DMA_NUM_CHANNELS; ch++)
+  {
+    if (host_dma_channels[ch] == DMA_Channelx)
+    {
+      host_dma_mem[ch] = (volatile uint8_t*)DMA_Memory0BaseAddr;
+      host_dma_size[ch] = DMA_BufferSize;
+    }
+  }
+}
+
+/******************************************************************************/
+/*                                S P I 1                                     */
+/******************************************************************************/
+
+/**
+ * @brief Enabling the SPI with transmit DMA requests already enabled starts the transfer
+ */
+void __wrap_SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState)
+{
+  host_emu_progress();
+  __real_SPI_Cmd(SPIx, NewState);
+  host_spi_sync();
+}
+
+/**
+ * @brief Enabling the transmit DMA requests of an enabled SPI starts the transfer
+ */
+void __wrap_SPI_DMACmd(SPI_TypeDef* SPIx, SPI_DMAReq_TypeDef SPI_DMAReq, FunctionalState NewState)
+{
+  host_emu_progress();
+  __real_SPI_DMACmd(SPIx, SPI_DMAReq, NewState);
+  host_spi_sync();
+}
+
+/**
+ * @brief Status poll, transfers complete immediately so TXE stays set and BSY clear (unless host_spi_stall())
+ */
+FlagStatus __wrap_SPI_GetFlagStatus(SPI_TypeDef* SPIx, SPI_FLAG_TypeDef SPI_FLAG)
+{
+  host_emu_poll("SPI_GetFlagStatus");
+  return __real_SPI_GetFlagStatus(SPIx, SPI_FLAG);
+}
+
+/******************************************************************************/
+/*                              U S A R T 1                                   */
+/******************************************************************************/
+
+/**
+ * @brief Transmission completes immediately, TXE and TC stay set from reset
+ */
+void __wrap_USART_SendData8(USART_TypeDef* USARTx, uint8_t Data)
+{
+  uint16_t divider;
+  unsigned long long ns;
+
+  host_emu_progress();
+  __real_USART_SendData8(USARTx, Data);
+
+  if (host_uart_tx_count < HOST_UART_TX_SIZE)
+  {
+    host_uart_tx_buf[host_uart_tx_count++] = (char)Data;
+    host_uart_tx_buf[host_uart_tx_count] = '\0';
+  }
+  host_trace_emit(HOST_TRACE_UART_TX, 0, Data);
+
+  /* Firmware waits for TXE before the next byte, account the frame time here, BRR holds fMASTER / baud */
+  divider = (uint16_t)(((uint16_t)(USARTx->BRR2 & 0xF0) << 8) | ((uint16_t)USARTx->BRR1 << 4) | (USARTx->BRR2 & 0x0F));
+  ns = (HOST_UART_FRAME_BITS * divider * 1000000000ULL) / host_fmaster_hz();
+  host_uart_ns += ns;
+  host_time_advance_ns(ns);
+}
+
+uint8_t __wrap_USART_ReceiveData8(USART_TypeDef* USARTx)
+{
+  host_emu_progress();
+  host_uart_sync();
+
+  if ((USARTx->SR & USART_SR_RXNE) != 0)
+  {
+    host_uart_rx_head = (uint16_t)((host_uart_rx_head + 1) % HOST_UART_RX_SIZE);
+    USARTx->SR &= (uint8_t)~USART_SR_RXNE;
+  }
+
+  return __real_USART_ReceiveData8(USARTx);
+}
+
+FlagStatus __wrap_USART_GetFlagStatus(USART_TypeDef* USARTx, USART_FLAG_TypeDef USART_FLAG)
+{
+  host_emu_poll("USART_GetFlagStatus");
+  host_uart_sync();
+  return __real_USART_GetFlagStatus(USARTx, USART_FLAG);
+}
+
+/******************************************************************************/
+/*                                I 2 C 1                                     */
+/******************************************************************************/
+
+void __wrap_I2C_GenerateSTART(I2C_TypeDef* I2Cx, FunctionalState NewState)
+{
+  host_emu_progress();
+  __real_I2C_GenerateSTART(I2Cx, NewState);
+
+  if (NewState == DISABLE)
+  {
+    return;
+  }
+
+  /* A slave holding SDA low keeps the bus busy, start is never granted */
+  if ((host_i2c_dev != NULL) && host_i2c_dev->sda_stuck)
+  {
+    I2Cx->SR1 = 0;
+    I2Cx->SR3 = I2C_SR3_BUSY;
+    return;
+  }
+
+  /* Start (or repeated start) is always granted, the bus has a single master */
+  host_i2c_bus(HOST_I2C_CONDITION_BITS);
+  host_i2c_hold = 0;
+  host_i2c_held_sr1 = 0;
+  host_i2c_acked = FALSE;
+  host_i2c_reading = FALSE;
+  host_i2c_stop_pending = FALSE;
+  host_i2c_last_loaded = FALSE;
+  I2Cx->SR1 = I2C_SR1_SB;
+  I2Cx->SR2 = 0;
+  I2Cx->SR3 = (uint8_t)(I2C_SR3_BUSY | I2C_SR3_MSL);
+  I2Cx->CR2 &= (uint8_t)~I2C_CR2_START;
+}
+
+void __wrap_I2C_Send7bitAddress(I2C_TypeDef* I2Cx, uint8_t Address, I2C_Direction_TypeDef I2C_Direction)
+{
+  bool read = (I2C_Direction == I2C_Direction_Receiver) ? TRUE : FALSE;
+
+  host_emu_progress();
+  __real_I2C_Send7bitAddress(I2Cx, Address, I2C_Direction);
+
+  host_i2c_bus(HOST_I2C_BYTE_BITS);
+  host_i2c_reading = read;
+  host_i2c_acked = FALSE;
+  if ((host_i2c_dev != NULL) && (host_i2c_dev->address == (uint8_t)(Address >> 1)))
+  {
+    host_i2c_acked = (host_i2c_dev->start == NULL) ? TRUE : host_i2c_dev->start(host_i2c_dev->ctx, read);
+  }
+
+  if (host_i2c_acked)
+  {
+    /* First received byte is stretched like every following one */
+    host_i2c_hold = read ? host_i2c_dev->stretch : 0;
+    I2Cx->SR1 = (uint8_t)(I2C_SR1_ADDR | (read ? 0 : I2C_SR1_TXE));
+    I2Cx->SR3 = (uint8_t)(I2C_SR3_BUSY | I2C_SR3_MSL | (read ? 0 : I2C_SR3_TRA));
+  }
+  else
+  {
+    I2Cx->SR1 = 0;
+    I2Cx->SR2 |= I2C_SR2_AF;
+  }
+}
+
+void __wrap_I2C_SendData(I2C_TypeDef* I2Cx, uint8_t Data)
+{
+  bool ack;
+
+  host_emu_progress();
+  __real_I2C_SendData(I2Cx, Data);
+
+  if ((host_i2c_acked == FALSE) || host_i2c_reading)
+  {
+    return;
+  }
+
+  host_i2c_bus(HOST_I2C_BYTE_BITS);
+  ack = (host_i2c_dev->write == NULL) ? TRUE : host_i2c_dev->write(host_i2c_dev->ctx, Data);
+  if (ack && (host_i2c_dev->stretch != 0))
+  {
+    /* Byte moved to the shift register, slave holds SCL after the acknowledge */
+    I2Cx->SR1 = 0;
+    host_i2c_held_sr1 = (uint8_t)(I2C_SR1_TXE | I2C_SR1_BTF);
+    host_i2c_hold = host_i2c_dev->stretch;
+  }
+  else if (ack)
+  {
+    I2Cx->SR1 = (uint8_t)(I2C_SR1_TXE | I2C_SR1_BTF);
+  }
+  else
+  {
+    I2Cx->SR1 = I2C_SR1_TXE;
+    I2Cx->SR2 |= I2C_SR2_AF;
+  }
+}
+
+uint8_t __wrap_I2C_ReceiveData(I2C_TypeDef* I2Cx)
+{
+  uint8_t data;
+
+  host_emu_progress();
+  host_i2c_sync();
+
+  data = __real_I2C_ReceiveData(I2Cx);
+  I2Cx->SR1 &= (uint8_t)~(I2C_SR1_RXNE | I2C_SR1_BTF);
+
+  /* Final byte read out, stop condition goes on the bus */
+  if (host_i2c_stop_pending && host_i2c_last_loaded)
+  {
+    if ((host_i2c_dev != NULL) && (host_i2c_dev->stop != NULL))
+    {
+      host_i2c_dev->stop(host_i2c_dev->ctx);
+    }
+    host_i2c_idle();
+  }
+
+  return data;
+}
+
+/**
+ * @brief STOP ends a transmit transfer immediately, a receive transfer after one more byte
+ */
+void __wrap_I2C_GenerateSTOP(I2C_TypeDef* I2Cx, FunctionalState NewState)
+{
+  host_emu_progress();
+  __real_I2C_GenerateSTOP(I2Cx, NewState);
+
+  if (NewState == DISABLE)
+  {
+    return;
+  }
+
+  host_i2c_bus(HOST_I2C_CONDITION_BITS);
+
+  if (host_i2c_reading && host_i2c_acked)
+  {
+    host_i2c_stop_pending = TRUE;
+    host_i2c_last_loaded = ((I2Cx->SR1 & I2C_SR1_RXNE) != 0) ? TRUE : FALSE;
+    return;
+  }
+
+  if (host_i2c_acked && (host_i2c_dev->stop != NULL))
+  {
+    host_i2c_dev->stop(host_i2c_dev->ctx);
+  }
+  host_i2c_idle();
+}
+
+ErrorStatus __wrap_I2C_CheckEvent(I2C_TypeDef* I2Cx, I2C_Event_TypeDef I2C_Event)
+{
+  ErrorStatus status;
+
+  host_emu_poll("I2C_CheckEvent");
+  host_i2c_sync();
+  status = __real_I2C_CheckEvent(I2Cx, I2C_Event);
+
+  /* Reading SR1 then SR3 clears ADDR */
+  if ((status == SUCCESS) && ((I2Cx->SR1 & I2C_SR1_ADDR) != 0))
+  {
+    I2Cx->SR1 &= (uint8_t)~I2C_SR1_ADDR;
+  }
+
+  return status;
+}
+
+FlagStatus __wrap_I2C_GetFlagStatus(I2C_TypeDef* I2Cx, I2C_FLAG_TypeDef I2C_FLAG)
+{
+  host_emu_poll("I2C_GetFlagStatus");
+  host_i2c_sync();
+  return __real_I2C_GetFlagStatus(I2Cx, I2C_FLAG);
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Oscillators become ready as soon as they are enabled
+ */
+static void host_clk_sync(void)
+{
+  if ((CLK->ICKCR & CLK_ICKCR_HSION) != 0)
+  {
+    CLK->ICKCR |= CLK_ICKCR_HSIRDY;
+  }
+  if ((CLK->ICKCR & CLK_ICKCR_LSION) != 0)
+  {
+    CLK->ICKCR |= CLK_ICKCR_LSIRDY;
+  }
+  if ((CLK->ECKCR & CLK_ECKCR_HSEON) != 0)
+  {
+    CLK->ECKCR |= CLK_ECKCR_HSERDY;
+  }
+  if ((CLK->ECKCR & CLK_ECKCR_LSEON) != 0)
+  {
+    CLK->ECKCR |= CLK_ECKCR_LSERDY;
+  }
+}
+
+/**
+ * @brief Update PVD output from VDD, raise the PVD interrupt when the output changes
+ */
+static void host_pvd_sync(void)
+{
+  uint16_t level;
+  uint8_t below;
+
+  if ((PWR->CSR1 & PWR_CSR1_PVDE) == 0)
+  {
+    PWR->CSR1 &= (uint8_t)~PWR_CSR1_PVDOF;
+    return;
+  }
+
+  level = host_pvd_levels_mv[(PWR->CSR1 & PWR_CSR1_PLS) >> 1];
+  below = (host_vdd < level) ? PWR_CSR1_PVDOF : 0;
+
+  if ((PWR->CSR1 & PWR_CSR1_PVDOF) == below)
+  {
+    return;
+  }
+
+  PWR->CSR1 = (uint8_t)((PWR->CSR1 & (uint8_t)~PWR_CSR1_PVDOF) | below | PWR_CSR1_PVDIF);
+  if ((PWR->CSR1 & PWR_CSR1_PVDIEN) != 0)
+  {
+    host_irq_raise(HOST_VECTOR_PVD);
+  }
+}
+
+/**
+ * @brief Move the next queued byte into DR
+ */
+static void host_uart_sync(void)
+{
+  if (((USART1->SR & USART_SR_RXNE) == 0) && (host_uart_rx_head != host_uart_rx_tail))
+  {
+    USART1->DR = (uint8_t)host_uart_rx_buf[host_uart_rx_head];
+    USART1->SR |= USART_SR_RXNE;
+  }
+}
+
+/**
+ * @brief Load the next byte from the slave while the master is receiving
+ */
+static void host_i2c_sync(void)
+{
+  /* Slave is stretching the clock */
+  if (host_i2c_hold != 0)
+  {
+    host_i2c_hold--;
+    if (host_i2c_hold == 0)
+    {
+      I2C1->SR1 |= host_i2c_held_sr1;
+      host_i2c_held_sr1 = 0;
+    }
+    return;
+  }
+
+  /* Reception starts once the master has seen and cleared ADDR */
+  if ((host_i2c_reading == FALSE) || (host_i2c_acked == FALSE) || ((I2C1->SR1 & (I2C_SR1_ADDR | I2C_SR1_RXNE)) != 0))
+  {
+    return;
+  }
+
+  if (host_i2c_stop_pending && host_i2c_last_loaded)
+  {
+    return;
+  }
+
+  host_i2c_bus(HOST_I2C_BYTE_BITS);
+  I2C1->DR = (host_i2c_dev->read == NULL) ? 0xFF : host_i2c_dev->read(host_i2c_dev->ctx);
+  I2C1->SR1 = I2C_SR1_RXNE;
+  I2C1->SR3 = (uint8_t)(I2C_SR3_BUSY | I2C_SR3_MSL);
+  host_i2c_hold = host_i2c_dev->stretch;
+
+  if (host_i2c_stop_pending)
+  {
+    host_i2c_last_loaded = TRUE;
+  }
+}
+
+/**
+ * @brief Account bus activity and its duration, SCL period is 2 * CCR * tCK in standard mode (tCK = 1 / FREQR MHz)
+ * @param bits: Bit times on the bus
+ */
+static void host_i2c_bus(uint8_t bits)
+{
+  uint16_t ccr = (uint16_t)(((uint16_t)(I2C1->CCRH & 0x0F) << 8) | I2C1->CCRL);
+  unsigned long long ns;
+
+  host_i2c_bits += bits;
+  if (I2C1->FREQR != 0)
+  {
+    ns = ((unsigned long long)bits * 2ULL * ccr * 1000ULL) / I2C1->FREQR;
+    host_i2c_ns += ns;
+    host_time_advance_ns(ns);
+  }
+}
+
+/**
+ * @brief Get peripheral clock, HSI divided by the SYSCLK prescaler
+ * @retval fMASTER in Hz
+ */
+static unsigned long long host_fmaster_hz(void)
+{
+  return 16000000ULL >> (CLK->CKDIVR & 0x07);
+}
+
+/**
+ * @brief Get a timer counter period, fMASTER divided by the prescaler
+ * @param id: Timer (0 = TIM1, 1 = TIM2)
+ * @retval Picoseconds per count, 0 if the timer is not clocked or not counting
+ */
+static unsigned long long host_tim_period(uint8_t id)
+{
+  unsigned long long cycle = HOST_HSI_PS_PER_CYCLE << (CLK->CKDIVR & 0x07);
+
+  if ((*host_tims[id].cr1 & TIM_CR1_CEN) == 0)
+  {
+    return 0;
+  }
+
+  if (id == 0)
+  {
+    if ((CLK->PCKENR2 & (uint8_t)(1 << (CLK_Peripheral_TIM1 & 0x0F))) == 0)
+    {
+      return 0;
+    }
+    return cycle * ((((unsigned long)TIM1->PSCRH << 8) | TIM1->PSCRL) + 1);
+  }
+
+  if ((CLK->PCKENR1 & (uint8_t)(1 << (CLK_Peripheral_TIM2 & 0x0F))) == 0)
+  {
+    return 0;
+  }
+  return cycle << (TIM2->PSCR & 0x07);
+}
+
+/**
+ * @brief Count a timer forward
+ * @param tim: Timer
+ * @param period: Picoseconds per count, 0 if stopped
+ * @param ps: Elapsed time in picoseconds
+ */
+static void host_tim_advance(host_tim_t* tim, unsigned long long period, unsigned long long ps)
+{
+  unsigned long long count;
+  unsigned long arr;
+
+  /* Software update event (UG, self clearing) restarts the counter */
+  if ((*tim->egr & TIM_EGR_UG) != 0)
+  {
+    *tim->egr &= (uint8_t)~TIM_EGR_UG;
+    tim->cntrh[0] = 0;
+    tim->cntrh[1] = 0;
+    tim->ps = 0;
+    *tim->sr1 |= TIM_SR1_UIF;
+  }
+
+  if (period == 0)
+  {
+    tim->ps = 0;
+    return;
+  }
+
+  tim->ps += ps;
+  if (tim->ps < period)
+  {
+    return;
+  }
+
+  arr = ((unsigned long)tim->arrh[0] << 8) | tim->arrh[1];
+  count = ((unsigned long)tim->cntrh[0] << 8) | tim->cntrh[1];
+  if (tim->der != NULL)
+  {
+    host_tim_compare(tim, count, tim->ps / period, arr);
+  }
+  count += tim->ps / period;
+  tim->ps %= period;
+
+  if (count > arr)
+  {
+    count = (count - (arr + 1)) % (arr + 1);
+    *tim->sr1 |= TIM_SR1_UIF;
+    if ((*tim->ier & TIM_IER_UIE) != 0)
+    {
+      host_irq_raise(tim->vector);
+    }
+  }
+
+  tim->cntrh[0] = (uint8_t)(count >> 8);
+  tim->cntrh[1] = (uint8_t)count;
+}
+
+/**
+ * @brief Compare matches while a timer counts forward, each sets its CCxIF and makes the DMA transfer it requests
+ * @param tim: Timer
+ * @param count: Counter value before counting
+ * @param ticks: Counts made
+ * @param arr: Auto-reload value
+ * @note Matches of one advance are made CC1 first, advances are no longer than a period while a request is enabled
+ */
+static void host_tim_compare(host_tim_t* tim, unsigned long count, unsigned long long ticks, unsigned long arr)
+{
+  unsigned long long match;
+  unsigned long ccr;
+  uint8_t cc;
+  uint8_t request;
+
+  for (cc=0; cc<2; cc++)
+  {
+    request = (cc == 0) ? TIM2_DMASource_CC1 : TIM2_DMASource_CC2;
+    ccr = ((unsigned long)tim->ccr1h[2 * cc] << 8) | tim->ccr1h[(2 * cc) + 1];
+    if (ccr > arr)
+    {
+      continue;
+    }
+
+    /* Counter values reached are count + 1 ... count + ticks, modulo ARR + 1 */
+    match = count + 1 + ((ccr + (arr + 1) - ((count + 1) % (arr + 1))) % (arr + 1));
+    for (; match <= (count + ticks); match += arr + 1)
+    {
+      *tim->sr1 |= (uint8_t)(TIM_SR1_CC1IF << cc);
+      if ((*tim->der & request) != 0)
+      {
+        host_dma_request((cc == 0) ? HOST_DMA_TIM2_CC1 : HOST_DMA_TIM2_CC2);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the counts until the next compare match with a DMA request enabled
+ * @param tim: Timer
+ * @param count: Counter value
+ * @param arr: Auto-reload value
+ * @retval Counts (1 to ARR + 1), ARR + 1 if no compare value is in range
+ */
+static unsigned long host_tim_next_compare(host_tim_t* tim, unsigned long count, unsigned long arr)
+{
+  unsigned long next = arr + 1;
+  unsigned long ccr;
+  unsigned long counts;
+  uint8_t cc;
+
+  for (cc=0; cc<2; cc++)
+  {
+    ccr = ((unsigned long)tim->ccr1h[2 * cc] << 8) | tim->ccr1h[(2 * cc) + 1];
+    if (((*tim->der & ((cc == 0) ? TIM2_DMASource_CC1 : TIM2_DMASource_CC2)) == 0) || (ccr > arr))
+    {
+      continue;
+    }
+
+    counts = (ccr + (arr + 1) - (count % (arr + 1))) % (arr + 1);
+    counts = (counts == 0) ? (arr + 1) : counts;
+    next = (counts < next) ? counts : next;
+  }
+
+  return next;
+}
+
+/**
+ * @brief Serve a DMA request, one byte from the memory buffer to the peripheral register the channel points at
+ * @param ch: DMA1 channel
+ *
+ * Only memory to peripheral byte transfers are modelled. Half and complete transfers set HTIF/TCIF and raise the
+ * channel pair's interrupt if enabled, circular mode restarts the buffer.
+ */
+static void host_dma_request(uint8_t ch)
+{
+  DMA_Channel_TypeDef* channel = host_dma_channels[ch];
+  uint16_t addr = (uint16_t)(((uint16_t)channel->CPARH << 8) | channel->CPARL);
+  uint8_t index;
+  uint8_t flags = 0;
+
+  if (((CLK->PCKENR2 & (uint8_t)(1 << (CLK_Peripheral_DMA1 & 0x0F))) == 0) || ((DMA1->GCSR & DMA_GCSR_GE) == 0) ||
+      ((channel->CCR & DMA_CCR_CE) == 0) || (channel->CNBTR == 0))
+  {
+    return;
+  }
+
+  if (((channel->CCR & (DMA_CCR_DTD | DMA_CCR_MEM)) != DMA_CCR_DTD) || ((channel->CSPR & DMA_CSPR_16BM) != 0) ||
+      (host_dma_mem[ch] == NULL) || (addr >= HOST_IO_SIZE))
+  {
+    host_emu_fault("DMA1 transfer not modelled (memory to peripheral bytes only)");
+  }
+
+  index = (uint8_t)(host_dma_size[ch] - channel->CNBTR);
+  host_io[addr] = ((channel->CCR & DMA_CCR_IDM) != 0) ? host_dma_mem[ch][index] : host_dma_mem[ch][-(int)index];
+  host_dma_count[ch]++;
+  channel->CNBTR--;
+
+  if (channel->CNBTR == (host_dma_size[ch] / 2))
+  {
+    channel->CSPR |= DMA_CSPR_HTIF;
+    flags |= DMA_CCR_HTIE;
+  }
+  if (channel->CNBTR == 0)
+  {
+    channel->CSPR |= DMA_CSPR_TCIF;
+    flags |= DMA_CCR_TCIE;
+    if ((channel->CCR & DMA_CCR_ARM) != 0)
+    {
+      channel->CNBTR = host_dma_size[ch];
+    }
+  }
+
+  if ((channel->CCR & flags) != 0)
+  {
+    host_irq_raise((ch < 2) ? HOST_VECTOR_DMA1_CHANNEL0_1 : HOST_VECTOR_DMA1_CHANNEL2_3);
+  }
+}
+
+/**
+ * @brief Serve the SPI1 transmit DMA requests, the whole buffer is shifted out at once
+ *
+ * TXE requests a byte whenever the data register is empty, the transfer is modelled as complete as soon as the
+ * SPI (master, clocked and enabled) has its requests and the DMA channel is ready. Each byte is reported to the
+ * trace hook, bus time is not charged (the CPU is free while DMA feeds the SPI).
+ */
+static void host_spi_sync(void)
+{
+  DMA_Channel_TypeDef* channel = host_dma_channels[HOST_DMA_SPI1_TX];
+  uint32_t count;
+  uint8_t i;
+  uint8_t n;
+
+  if (((CLK->PCKENR1 & CLK_PCKENR1_SPI1) == 0) || ((SPI1->CR1 & (SPI_CR1_SPE | SPI_CR1_MSTR)) !=
+      (SPI_CR1_SPE | SPI_CR1_MSTR)) || ((SPI1->CR3 & SPI_CR3_TXDMAEN) == 0))
+  {
+    return;
+  }
+
+  n = channel->CNBTR;
+  for (i=0; i<n; i++)
+  {
+    count = host_dma_count[HOST_DMA_SPI1_TX];
+    host_dma_request(HOST_DMA_SPI1_TX);
+    if (host_dma_count[HOST_DMA_SPI1_TX] == count)
+    {
+      return;
+    }
+
+    host_spi_tx_count++;
+    host_trace_emit(HOST_TRACE_SPI_TX, 0, SPI1->DR);
+  }
+}
+
+/**
+ * @brief Initialization and wakeup timer write flags follow their request bits immediately, calendar shadow
+ * registers are always synchronized (RSF set again right after software clears it)
+ */
+static void host_rtc_sync(void)
+{
+  RTC->ISR1 |= RTC_ISR1_RSF;
+
+  if ((RTC->ISR1 & RTC_ISR1_INIT) != 0)
+  {
+    RTC->ISR1 |= RTC_ISR1_INITF;
+  }
+  else
+  {
+    RTC->ISR1 &= (uint8_t)~RTC_ISR1_INITF;
+  }
+
+  if ((RTC->CR2 & RTC_CR2_WUTE) == 0)
+  {
+    RTC->ISR1 |= RTC_ISR1_WUTWF;
+    host_rtc_ps = 0;
+  }
+  else
+  {
+    RTC->ISR1 &= (uint8_t)~RTC_ISR1_WUTWF;
+  }
+}
+
+/**
+ * @brief Get the RTC wakeup period, (WUTR + 1) counts of RTCCLK / 16..2 or of the 1 Hz ck_spre (prescaled by
+ * (APRER + 1) * (SPRER + 1)), 2^16 more counts with WUCKSEL 11x
+ * @retval Picoseconds between wakeup events, 0 if the RTC is not clocked or the wakeup timer is stopped
+ */
+static unsigned long long host_rtc_interval(void)
+{
+  unsigned long long count;
+  unsigned long long hz;
+  uint8_t wucksel = (uint8_t)(RTC->CR1 & RTC_CR1_WUCKSEL);
+
+  if (((CLK->PCKENR2 & (uint8_t)(1 << (CLK_Peripheral_RTC & 0x0F))) == 0) || ((RTC->CR2 & RTC_CR2_WUTE) == 0))
+  {
+    return 0;
+  }
+
+  switch (CLK->CRTCR & CLK_CRTCR_RTCSEL)
+  {
+    case CLK_RTCCLKSource_LSI:
+      hz = host_lsi_hz;
+      break;
+    case CLK_RTCCLKSource_LSE:
+      hz = LSE_VALUE;
+      break;
+    default:
+      return 0;
+  }
+  hz >>= (CLK->CRTCR & CLK_CRTCR_RTCDIV) >> 5;
+
+  /* Period of one count first, a day in picoseconds times the prescalers would overflow */
+  count = (((unsigned long long)RTC->WUTRH << 8) | RTC->WUTRL) + 1;
+  if ((wucksel & 0x04) == 0)
+  {
+    return count * (((16ULL >> wucksel) * 1000000000000ULL) / hz);
+  }
+
+  if ((wucksel & 0x02) != 0)
+  {
+    count += 0x10000;
+  }
+  return count * (((RTC->APRER + 1ULL) * ((((unsigned long long)RTC->SPRERH << 8) | RTC->SPRERL) + 1) *
+                   1000000000000ULL) / hz);
+}
+
+/**
+ * @brief Count the wakeup timer forward
+ * @param ps: Elapsed time in picoseconds
+ */
+static void host_rtc_advance(unsigned long long ps)
+{
+  unsigned long long interval = host_rtc_interval();
+
+  if (interval == 0)
+  {
+    host_rtc_ps = 0;
+    return;
+  }
+
+  host_rtc_ps += ps;
+  if (host_rtc_ps < interval)
+  {
+    return;
+  }
+
+  host_rtc_ps %= interval;
+  RTC->ISR2 |= RTC_ISR2_WUTF;
+  if ((RTC->CR2 & RTC_CR2_WUTIE) != 0)
+  {
+    host_irq_raise(HOST_VECTOR_RTC);
+  }
+}
+
+/**
+ * @brief Release the bus
+ */
+static void host_i2c_idle(void)
+{
+  host_i2c_acked = FALSE;
+  host_i2c_reading = FALSE;
+  host_i2c_stop_pending = FALSE;
+  host_i2c_last_loaded = FALSE;
+  host_i2c_hold = 0;
+  host_i2c_held_sr1 = 0;
+  I2C1->SR1 = 0;
+  I2C1->SR3 = ((host_i2c_dev != NULL) && host_i2c_dev->sda_stuck) ? I2C_SR3_BUSY : 0;
+  I2C1->CR2 &= (uint8_t)~I2C_CR2_STOP;
+}
@@ -0,0 +1,435 @@
+/**
+ * @file host_energy.c
+ * @brief Whole-day energy estimate, runs a day of typical use on the breakout board firmware and integrates
+ * a per-component current model over the residency of each component
+ *
+ * Usage: host_energy <current_model.txt> [--presses N] [--hours H] [--vdd MV] [--capacity-mah N]
+ *                    [--max-mah-per-day X]
+ *
+ * Scenario: the watch is switched to sleep 1 s after reset, then N print presses (50 ms each) are spread
+ * evenly over the simulated period and the RTC keeps time. Residency comes from the emulator: CPU
+ * run/wait/halt time, HV supply on time and lit cathode time from the pin trace, I2C bus time and UART
+ * transmit time. The result is scaled to 24 hours.
+ *
+ * Current model, one "<component> <mA>" per line ('#' starts a comment), every component must be listed:
+ * mcu_run_ma, mcu_wait_ma, mcu_halt_ma, psu_ma, digit_ma (per lit cathode), i2c_ma, uart_ma, board_ma.
+ *
+ * Build the firmware variant to compare with add_firmware_variant() (e.g. SM_DISPLAY_PERIODS=1 or
+ * SM_SLEEP_HALT=1) and link host_energy against it.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "nixie.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define ENERGY_LINE_SIZE 128
+
+#define ENERGY_NS_PER_MS 1000000ULL
+#define ENERGY_NS_PER_S 1000000000ULL
+#define ENERGY_S_PER_HOUR 3600.0
+#define ENERGY_HOURS_PER_DAY 24.0
+
+/* Scenario defaults */
+#define ENERGY_PRESSES 48
+#define ENERGY_HOURS 24
+#define ENERGY_VDD_MV 3000
+
+/* Switch timing */
+#define ENERGY_SLEEP_PRESS_NS (1ULL * ENERGY_NS_PER_S)
+#define ENERGY_PRESS_NS (50ULL * ENERGY_NS_PER_MS)
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Modelled components
+ */
+typedef enum
+{
+  ENERGY_MCU_RUN,
+
+  ENERGY_MCU_WAIT,
+
+  ENERGY_MCU_HALT,
+
+  ENERGY_PSU,
+
+  ENERGY_DIGIT,
+
+  ENERGY_I2C,
+
+  ENERGY_UART,
+
+  ENERGY_BOARD,
+
+  ENERGY_NUM_COMPONENTS
+
+} energy_component_t;
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Current model keys, in component order */
+static const char* const energy_names[ENERGY_NUM_COMPONENTS] = {
+  "mcu_run_ma", "mcu_wait_ma", "mcu_halt_ma", "psu_ma", "digit_ma", "i2c_ma", "uart_ma", "board_ma"
+};
+
+/* Ports in trace order (index used by HOST_TRACE_GPIO) */
+static GPIO_TypeDef* const energy_ports[HOST_NUM_GPIO_PORTS] = {
+  GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF
+};
+
+/* Tube A cathodes, from the board definition */
+static GPIO_TypeDef* const energy_digit_ports[NUM_NIXIE_DIGITS] = {
+  TUBE_A_PORT_0, TUBE_A_PORT_1, TUBE_A_PORT_2, TUBE_A_PORT_3, TUBE_A_PORT_4,
+  TUBE_A_PORT_5, TUBE_A_PORT_6, TUBE_A_PORT_7, TUBE_A_PORT_8, TUBE_A_PORT_9
+};
+static const uint8_t energy_digit_pins[NUM_NIXIE_DIGITS] = {
+  DIGIT_A_0, DIGIT_A_1, DIGIT_A_2, DIGIT_A_3, DIGIT_A_4, DIGIT_A_5, DIGIT_A_6, DIGIT_A_7, DIGIT_A_8, DIGIT_A_9
+};
+
+static double energy_ma[ENERGY_NUM_COMPONENTS];
+
+/* Scenario */
+static uint16_t energy_presses = ENERGY_PRESSES;
+static unsigned long long energy_end_ns = ENERGY_HOURS * 3600ULL * ENERGY_NS_PER_S;
+static uint16_t energy_next; /* Next stimulus event, see energy_event_time() */
+static unsigned long long energy_rtc_ns; /* RTC model advanced up to here */
+static host_ds1307_t energy_rtc;
+
+/* Residency integrated from the pin trace, in ns (digit time is summed over lit cathodes) */
+static uint8_t energy_levels[HOST_NUM_GPIO_PORTS];
+static bool energy_psu_on;
+static uint8_t energy_digits_lit;
+static unsigned long long energy_last_ns;
+static unsigned long long energy_psu_ns;
+static unsigned long long energy_digit_ns;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static bool energy_load_model(const char* path);
+static unsigned long long energy_event_time(uint16_t event);
+static void energy_alarm(void);
+static void energy_trace(host_trace_t event, uint8_t index, uint8_t value);
+static void energy_integrate(void);
+static void energy_gpio(uint8_t port, uint8_t levels);
+static uint8_t energy_port_index(GPIO_TypeDef* port);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(int argc, char** argv)
+{
+  int i;
+  unsigned hours;
+  unsigned vdd_mv = ENERGY_VDD_MV;
+  double capacity_mah = 0.0;
+  double max_mah = 0.0;
+  double seconds[ENERGY_NUM_COMPONENTS];
+  double total = 0.0;
+  double mah;
+  double scale;
+  host_run_result_t result;
+  energy_component_t c;
+  int status = 0;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <current_model.txt> [--presses N] [--hours H] [--vdd MV] [--capacity-mah N] "
+                    "[--max-mah-per-day X]\n", argv[0]);
+    return 2;
+  }
+
+  for (i=2; i<argc; i++)
+  {
+    if ((strcmp(argv[i], "--presses") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%hu", &energy_presses);
+    }
+    else if ((strcmp(argv[i], "--hours") == 0) && ((i + 1) < argc) && (sscanf(argv[++i], "%u", &hours) == 1) &&
+             (hours != 0))
+    {
+      energy_end_ns = hours * 3600ULL * ENERGY_NS_PER_S;
+    }
+    else if ((strcmp(argv[i], "--vdd") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%u", &vdd_mv);
+    }
+    else if ((strcmp(argv[i], "--capacity-mah") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%lf", &capacity_mah);
+    }
+    else if ((strcmp(argv[i], "--max-mah-per-day") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%lf", &max_mah);
+    }
+    else
+    {
+      fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  if (energy_load_model(argv[1]) == FALSE)
+  {
+    return 2;
+  }
+
+  host_emu_reset();
+  host_vdd_set_mv((uint16_t)vdd_mv);
+  host_ds1307_init(&energy_rtc);
+  host_i2c_attach(&energy_rtc.slave);
+
+  /* Switch inputs idle high (pull-ups) */
+  host_gpio_input(POWER_SWITCH_PORT, (uint8_t)(POWER_SWITCH_PIN_0 | POWER_SWITCH_PIN_1 | POWER_SWITCH_PIN_2), TRUE);
+
+  host_trace_set_hook(energy_trace);
+  host_alarm_set(HOST_ALARM_STIMULUS, energy_event_time(0), energy_alarm);
+
+  result = host_emu_run(fw_main, NULL);
+  if (result == HOST_RUN_FAULT)
+  {
+    fprintf(stderr, "firmware fault at %llu ms: %s\n", host_time_ns() / ENERGY_NS_PER_MS, host_emu_fault_msg());
+    return 1;
+  }
+  if (host_time_ns() < energy_end_ns)
+  {
+    fprintf(stderr, "firmware stopped at %llu ms\n", host_time_ns() / ENERGY_NS_PER_MS);
+    return 1;
+  }
+  energy_integrate();
+
+  seconds[ENERGY_MCU_RUN] = (double)host_residency_ns(HOST_CPU_RUN) / ENERGY_NS_PER_S;
+  seconds[ENERGY_MCU_WAIT] = (double)host_residency_ns(HOST_CPU_WAIT) / ENERGY_NS_PER_S;
+  seconds[ENERGY_MCU_HALT] = (double)host_residency_ns(HOST_CPU_HALT) / ENERGY_NS_PER_S;
+  seconds[ENERGY_PSU] = (double)energy_psu_ns / ENERGY_NS_PER_S;
+  seconds[ENERGY_DIGIT] = (double)energy_digit_ns / ENERGY_NS_PER_S;
+  seconds[ENERGY_I2C] = (double)host_i2c_bus_ns() / ENERGY_NS_PER_S;
+  seconds[ENERGY_UART] = (double)host_uart_tx_ns() / ENERGY_NS_PER_S;
+  seconds[ENERGY_BOARD] = (double)host_time_ns() / ENERGY_NS_PER_S;
+
+  scale = ENERGY_HOURS_PER_DAY / (seconds[ENERGY_BOARD] / ENERGY_S_PER_HOUR);
+
+  printf("component\tseconds\tcurrent_ma\tmah_per_day\n");
+  for (c=ENERGY_MCU_RUN; c<ENERGY_NUM_COMPONENTS; c++)
+  {
+    mah = ((energy_ma[c] * seconds[c]) / ENERGY_S_PER_HOUR) * scale;
+    total += mah;
+    printf("%s\t%.3f\t%g\t%.4f\n", energy_names[c], seconds[c], energy_ma[c], mah);
+  }
+  printf("total\t%.3f\t-\t%.4f\n", seconds[ENERGY_BOARD], total);
+  if ((capacity_mah > 0.0) && (total > 0.0))
+  {
+    printf("battery_days\t%.1f\n", capacity_mah / total);
+  }
+
+  if ((max_mah > 0.0) && (total > max_mah))
+  {
+    fprintf(stderr, "%.4f mAh/day over %.4f\n", total, max_mah);
+    status = 1;
+  }
+
+  return status;
+}
+
+/**
+ * @brief Read the current model
+ * @param path: Model file
+ * @retval TRUE if every component was given
+ */
+static bool energy_load_model(const char* path)
+{
+  FILE* f = fopen(path, "r");
+  char line[ENERGY_LINE_SIZE];
+  char name[ENERGY_LINE_SIZE];
+  double ma;
+  unsigned line_no = 0;
+  bool found[ENERGY_NUM_COMPONENTS] = {FALSE};
+  energy_component_t c;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return FALSE;
+  }
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    line_no++;
+    line[strcspn(line, "\r\n#")] = '\0';
+    if (sscanf(line, "%127s %lf", name, &ma) != 2)
+    {
+      continue;
+    }
+
+    for (c=ENERGY_MCU_RUN; c<ENERGY_NUM_COMPONENTS; c++)
+    {
+      if (strcmp(name, energy_names[c]) == 0)
+      {
+        energy_ma[c] = ma;
+        found[c] = TRUE;
+        break;
+      }
+    }
+    if (c == ENERGY_NUM_COMPONENTS)
+    {
+      fprintf(stderr, "%s:%u: unknown component %s\n", path, line_no, name);
+      fclose(f);
+      return FALSE;
+    }
+  }
+  fclose(f);
+
+  for (c=ENERGY_MCU_RUN; c<ENERGY_NUM_COMPONENTS; c++)
+  {
+    if (found[c] == FALSE)
+    {
+      fprintf(stderr, "%s: missing %s\n", path, energy_names[c]);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+ * @brief Time of a scenario event: sleep press/release, print press/release pairs, then the end of the run
+ * @param event: Event number
+ * @retval Nanoseconds from reset
+ */
+static unsigned long long energy_event_time(uint16_t event)
+{
+  unsigned long long period;
+
+  if (event < 2)
+  {
+    return ENERGY_SLEEP_PRESS_NS + (event * ENERGY_PRESS_NS);
+  }
+
+  event -= 2;
+  if (event >= (2 * energy_presses))
+  {
+    return energy_end_ns;
+  }
+
+  /* Presses centred in equal slices of the period */
+  period = energy_end_ns / energy_presses;
+  return (period * (event / 2)) + (period / 2) + ((event % 2) * ENERGY_PRESS_NS);
+}
+
+/**
+ * @brief Stimulus alarm, keeps the RTC running and applies the next scenario event
+ */
+static void energy_alarm(void)
+{
+  uint16_t event = energy_next++;
+  unsigned long long now = host_time_ns();
+
+  host_ds1307_tick_ms(&energy_rtc, (uint32_t)((now - energy_rtc_ns) / ENERGY_NS_PER_MS));
+  energy_rtc_ns = now - ((now - energy_rtc_ns) % ENERGY_NS_PER_MS);
+
+  if (event < 2)
+  {
+    host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_1, (event == 0) ? FALSE : TRUE);
+  }
+  else if ((event - 2) < (2 * energy_presses))
+  {
+    host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_0, (((event - 2) % 2) == 0) ? FALSE : TRUE);
+  }
+  else
+  {
+    host_emu_stop();
+    return;
+  }
+
+  host_alarm_set(HOST_ALARM_STIMULUS, energy_event_time(energy_next), energy_alarm);
+}
+
+/**
+ * @brief Output event hook
+ */
+static void energy_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  switch (event)
+  {
+    case HOST_TRACE_GPIO:
+      energy_integrate();
+      energy_gpio(index, value);
+      break;
+    case HOST_TRACE_UART_TX:
+    case HOST_TRACE_IRQ:
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Accumulate supply and cathode on time up to now
+ */
+static void energy_integrate(void)
+{
+  unsigned long long now = host_time_ns();
+  unsigned long long elapsed = now - energy_last_ns;
+
+  if (energy_psu_on)
+  {
+    energy_psu_ns += elapsed;
+    energy_digit_ns += elapsed * energy_digits_lit;
+  }
+  energy_last_ns = now;
+}
+
+/**
+ * @brief Track supply enable and lit cathodes from a port change
+ */
+static void energy_gpio(uint8_t port, uint8_t levels)
+{
+  uint8_t i;
+
+  energy_levels[port] = levels;
+
+  /* HV supply enable is active low */
+  if (energy_ports[port] == NIXIE_SUPPLY_PORT)
+  {
+    energy_psu_on = ((levels & NIXIE_SUPPLY_PIN) == 0) ? TRUE : FALSE;
+  }
+
+  /* Cathodes only draw current while the HV supply runs */
+  energy_digits_lit = 0;
+  for (i=0; i<NUM_NIXIE_DIGITS; i++)
+  {
+    if ((energy_levels[energy_port_index(energy_digit_ports[i])] & energy_digit_pins[i]) != 0)
+    {
+      energy_digits_lit++;
+    }
+  }
+}
+
+/**
+ * @brief Trace index of a port
+ */
+static uint8_t energy_port_index(GPIO_TypeDef* port)
+{
+  uint8_t i;
+
+  for (i=0; (i < (HOST_NUM_GPIO_PORTS - 1)) && (energy_ports[i] != port); i++)
+  {
+  }
+
+  return i;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file host_stm8l15x.h
+ * @brief Host build device header, force included ahead of every source file (gcc -include)
+ *
+ * The host compiler is presented to the StdPeriph library as IAR (the plain C dialect closest to a
+ * desktop compiler), memory/interrupt keywords are removed and every peripheral register block is
+ * redirected from its fixed STM8 address into the emulated register file host_io[].
+ */
+
+#ifndef HOST_STM8L15X_H_
+#define HOST_STM8L15X_H_
+
+/******************************************************************************/
+/*                       C O M P I L E R  K E Y W O R D S                     */
+/******************************************************************************/
+#define __ICCSTM8__
+#define __far
+#define __near
+#define __tiny
+#define __eeprom
+#define __interrupt
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Size of the emulated register file, covers the whole STM8 I/O and option/factory byte area */
+#define HOST_IO_SIZE 0x8000
+
+/* Convert an STM8 peripheral base address to its location in the emulated register file */
+#define HOST_IO(base) (&host_io[(base)])
+
+extern volatile uint8_t host_io[HOST_IO_SIZE];
+
+/* Peripheral register blocks, same order as stm8l15x.h */
+#undef SYSCFG
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#undef GPIOF
+#undef GPIOG
+#undef GPIOH
+#undef GPIOI
+#undef RTC
+#undef FLASH
+#undef EXTI
+#undef RST
+#undef PWR
+#undef CLK
+#undef CSSLSE
+#undef WWDG
+#undef IWDG
+#undef WFE
+#undef BEEP
+#undef SPI1
+#undef SPI2
+#undef I2C1
+#undef USART1
+#undef USART2
+#undef USART3
+#undef LCD
+#undef TIM1
+#undef TIM2
+#undef TIM3
+#undef TIM4
+#undef TIM5
+#undef IRTIM
+#undef ITC
+#undef DAC
+#undef DMA1
+#undef DMA1_Channel0
+#undef DMA1_Channel1
+#undef DMA1_Channel2
+#undef DMA1_Channel3
+#undef DM
+#undef RI
+#undef COMP
+#undef AES
+#undef ADC1
+#undef CFG
+#undef OPT
+
+#define SYSCFG        ((SYSCFG_TypeDef *) HOST_IO(SYSCFG_BASE))
+#define GPIOA         ((GPIO_TypeDef *) HOST_IO(GPIOA_BASE))
+#define GPIOB         ((GPIO_TypeDef *) HOST_IO(GPIOB_BASE))
+#define GPIOC         ((GPIO_TypeDef *) HOST_IO(GPIOC_BASE))
+#define GPIOD         ((GPIO_TypeDef *) HOST_IO(GPIOD_BASE))
+#define GPIOE         ((GPIO_TypeDef *) HOST_IO(GPIOE_BASE))
+#define GPIOF         ((GPIO_TypeDef *) HOST_IO(GPIOF_BASE))
+#define GPIOG         ((GPIO_TypeDef *) HOST_IO(GPIOG_BASE))
+#define GPIOH         ((GPIO_TypeDef *) HOST_IO(GPIOH_BASE))
+#define GPIOI         ((GPIO_TypeDef *) HOST_IO(GPIOI_BASE))
+#define RTC           ((RTC_TypeDef *) HOST_IO(RTC_BASE))
+#define FLASH         ((FLASH_TypeDef *) HOST_IO(FLASH_BASE))
+#define EXTI          ((EXTI_TypeDef *) HOST_IO(EXTI_BASE))
+#define RST           ((RST_TypeDef *) HOST_IO(RST_BASE))
+#define PWR           ((PWR_TypeDef *) HOST_IO(PWR_BASE))
+#define CLK           ((CLK_TypeDef *) HOST_IO(CLK_BASE))
+#define CSSLSE        ((CSSLSE_TypeDef *) HOST_IO(CSSLSE_BASE))
+#define WWDG          ((WWDG_TypeDef *) HOST_IO(WWDG_BASE))
+#define IWDG          ((IWDG_TypeDef *) HOST_IO(IWDG_BASE))
+#define WFE           ((WFE_TypeDef *) HOST_IO(WFE_BASE))
+#define BEEP          ((BEEP_TypeDef *) HOST_IO(BEEP_BASE))
+#define SPI1          ((SPI_TypeDef *) HOST_IO(SPI1_BASE))
+#define SPI2          ((SPI_TypeDef *) HOST_IO(SPI2_BASE))
+#define I2C1          ((I2C_TypeDef *) HOST_IO(I2C1_BASE))
+#define USART1        ((USART_TypeDef *) HOST_IO(USART1_BASE))
+#define USART2        ((USART_TypeDef *) HOST_IO(USART2_BASE))
+#define USART3        ((USART_TypeDef *) HOST_IO(USART3_BASE))
+#define LCD           ((LCD_TypeDef *) HOST_IO(LCD_BASE))
+#define TIM1          ((TIM1_TypeDef *) HOST_IO(TIM1_BASE))
+#define TIM2          ((TIM_TypeDef *) HOST_IO(TIM2_BASE))
+#define TIM3          ((TIM_TypeDef *) HOST_IO(TIM3_BASE))
+#define TIM4          ((TIM4_TypeDef *) HOST_IO(TIM4_BASE))
+#define TIM5          ((TIM_TypeDef *) HOST_IO(TIM5_BASE))
+#define IRTIM         ((IRTIM_TypeDef *) HOST_IO(IRTIM_BASE))
+#define ITC           ((ITC_TypeDef *) HOST_IO(ITC_BASE))
+#define DAC           ((DAC_TypeDef *) HOST_IO(DAC_BASE))
+#define DMA1          ((DMA_TypeDef *) HOST_IO(DMA1_BASE))
+#define DMA1_Channel0 ((DMA_Channel_TypeDef *) HOST_IO(DMA1_Channel0_BASE))
+#define DMA1_Channel1 ((DMA_Channel_TypeDef *) HOST_IO(DMA1_Channel1_BASE))
+#define DMA1_Channel2 ((DMA_Channel_TypeDef *) HOST_IO(DMA1_Channel2_BASE))
+#define DMA1_Channel3 ((DMA_Channel_TypeDef *) HOST_IO(DMA1_Channel3_BASE))
+#define DM            ((DM_TypeDef *) HOST_IO(DM_BASE))
+#define RI            ((RI_TypeDef *) HOST_IO(RI_BASE))
+#define COMP          ((COMP_TypeDef *) HOST_IO(COMP_BASE))
+#define AES           ((AES_TypeDef *) HOST_IO(AES_BASE))
+#define ADC1          ((ADC_TypeDef *) HOST_IO(ADC1_BASE))
+#define CFG           ((CFG_TypeDef *) HOST_IO(CFG_BASE))
+#define OPT           ((OPT_TypeDef *) HOST_IO(OPT_BASE))
+
+/* Interrupt handlers become plain functions, dispatched by the emulator (see host_emu.c) */
+#undef INTERRUPT_HANDLER
+#undef INTERRUPT_HANDLER_TRAP
+#undef INTERRUPT
+#define INTERRUPT_HANDLER(a,b) void a(void)
+#define INTERRUPT_HANDLER_TRAP(a) void a(void)
+#define INTERRUPT
+
+#endif /* HOST_STM8L15X_H_ */
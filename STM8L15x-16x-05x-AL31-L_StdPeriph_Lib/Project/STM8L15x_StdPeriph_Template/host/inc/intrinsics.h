@@ -0,0 +1,40 @@
+/**
+ * @file intrinsics.h
+ * @brief Host replacement for the IAR STM8 intrinsics used by stm8l15x.h, CPU instructions call into the emulator
+ */
+
+#ifndef HOST_INTRINSICS_H_
+#define HOST_INTRINSICS_H_
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/* Saved interrupt mask, non-zero while interrupts are enabled */
+typedef unsigned char __istate_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void host_cpu_rim(void);
+void host_cpu_sim(void);
+__istate_t host_cpu_get_istate(void);
+void host_cpu_set_istate(__istate_t state);
+void host_cpu_wfi(void);
+void host_cpu_halt(void);
+void host_cpu_trap(void);
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define __enable_interrupt() host_cpu_rim()
+#define __disable_interrupt() host_cpu_sim()
+#define __get_interrupt_state() host_cpu_get_istate()
+#define __set_interrupt_state(state) host_cpu_set_istate(state)
+#define __no_operation() ((void)0)
+#define __trap() host_cpu_trap()
+#define __wait_for_interrupt() host_cpu_wfi()
+#define __wait_for_event() host_cpu_wfi()
+#define __halt() host_cpu_halt()
+
+#endif /* HOST_INTRINSICS_H_ */
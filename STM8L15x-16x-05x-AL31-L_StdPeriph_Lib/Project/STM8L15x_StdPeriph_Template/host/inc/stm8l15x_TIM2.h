@@ -0,0 +1,7 @@
+/**
+ * @file stm8l15x_TIM2.h
+ * @brief stm8l15x_tim2.c includes its header with upper case "TIM2", which only resolves on case insensitive
+ * file systems (Windows, where STVD builds it)
+ */
+
+#include "stm8l15x_tim2.h"
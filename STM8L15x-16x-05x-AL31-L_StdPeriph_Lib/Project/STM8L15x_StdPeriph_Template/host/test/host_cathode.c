@@ -0,0 +1,148 @@
+/**
+ * @file host_cathode.c
+ * @brief Cathode exercise test, a watch that only ever showed 00:00 lights every other cathode on its scheduled
+ * RTC wakes, with the HV supply enabled once per wake, on time with a slow LSI
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "cathode.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define CAT_NS_PER_MS 1000000ULL
+#define CAT_NS_PER_S 1000000000ULL
+
+/* Print presses before the first scheduled wake, the DS1307 model is not ticked so every print shows 00:00 */
+#define CAT_PRESSES 3
+#define CAT_PRESS_NS (100ULL * CAT_NS_PER_MS)
+#define CAT_RELEASE_NS (50ULL * CAT_NS_PER_MS)
+#define CAT_PRESS_GAP_NS (2000ULL * CAT_NS_PER_MS)
+
+/* Two scheduled wakes, nine unused cathodes need two exercise sequences */
+#define CAT_WAKES 2
+#define CAT_END_NS (((CAT_WAKES * CATHODE_PERIOD_S) + 60) * CAT_NS_PER_S)
+
+/* LSI 10 % slow, the second wake comes over an hour late unless the RTC prescaler is trimmed at boot */
+#define CAT_LSI_HZ 34000UL
+
+/* HV supply windows recorded */
+#define CAT_MAX_WINDOWS 8
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static host_ds1307_t cat_rtc;
+
+/* Print presses, then wait out the scheduled wakes */
+static const host_test_presses_t cat_presses = {
+  CAT_PRESSES, CAT_PRESS_NS, CAT_RELEASE_NS, CAT_PRESS_GAP_NS, CAT_END_NS, NULL
+};
+
+/* Cathodes lit (bit per digit) during each HV supply window */
+static bool cat_psu_on;
+static uint8_t cat_windows;
+static uint16_t cat_lit[CAT_MAX_WINDOWS];
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void cat_trace(host_trace_t event, uint8_t index, uint8_t value);
+static uint8_t cat_count(uint16_t mask);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  uint16_t all = 0;
+  uint8_t i;
+
+  host_emu_reset();
+  host_lsi_set_hz(CAT_LSI_HZ);
+  host_ds1307_init(&cat_rtc);
+  host_i2c_attach(&cat_rtc.slave);
+  host_test_trace(cat_trace);
+  host_test_presses(&cat_presses);
+
+  host_test_run(fw_main, HOST_RUN_STOPPED, "firmware runs until the scenario ends");
+
+  for (i=0; i<cat_windows; i++)
+  {
+    printf("window %u: cathodes 0x%03x\n", i, cat_lit[i]);
+    all |= cat_lit[i];
+  }
+
+  host_test_check(host_irq_count(HOST_VECTOR_RTC) == CAT_WAKES, "one RTC interrupt per period");
+  host_test_check(cat_windows == (CAT_PRESSES + CAT_WAKES), "HV supply enabled once per print and once per wake");
+  for (i=0; (i < CAT_PRESSES) && (i < cat_windows); i++)
+  {
+    host_test_check(cat_lit[i] == 0x001, "prints only light cathode 0");
+  }
+  if (cat_windows == (CAT_PRESSES + CAT_WAKES))
+  {
+    host_test_check(cat_count(cat_lit[CAT_PRESSES]) == DISPLAY_MAX_STEPS, "first wake exercises a full sequence");
+    host_test_check((cat_lit[CAT_PRESSES] & 0x001) == 0, "used cathode not exercised");
+    host_test_check((cat_lit[CAT_PRESSES] & cat_lit[CAT_PRESSES + 1]) == 0, "second wake picks the rest");
+  }
+  host_test_check(all == 0x3FF, "every cathode lit");
+
+  return host_test_result();
+}
+
+/**
+ * @brief Output event hook, collects the cathodes lit per HV supply window
+ */
+static void cat_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  bool psu_on;
+
+  if (event != HOST_TRACE_GPIO)
+  {
+    return;
+  }
+
+  /* HV supply enable is active low */
+  if (index == host_test_port_index(NIXIE_SUPPLY_PORT))
+  {
+    psu_on = ((value & NIXIE_SUPPLY_PIN) == 0) ? TRUE : FALSE;
+    if (psu_on && (cat_psu_on == FALSE) && (cat_windows < CAT_MAX_WINDOWS))
+    {
+      cat_windows++;
+    }
+    cat_psu_on = psu_on;
+  }
+
+  if ((cat_psu_on == FALSE) || (cat_windows == 0))
+  {
+    return;
+  }
+
+  cat_lit[cat_windows - 1] |= host_test_lit(0);
+}
+
+/**
+ * @brief Number of cathodes in a mask
+ */
+static uint8_t cat_count(uint16_t mask)
+{
+  uint8_t count = 0;
+
+  for (; mask != 0; mask >>= 1)
+  {
+    count += (uint8_t)(mask & 1);
+  }
+
+  return count;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file host_display.c
+ * @brief Digit switching test, no two cathodes of a tube are ever driven together and a tube switching from one
+ * digit straight to another stays blank for the break before make interval
+ *
+ * Built against a firmware variant without gaps between digits, so prints (12:34) and cathode exercise wakes
+ * switch digits back to back.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "cathode.h"
+#include "display.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define DSP_NS_PER_US 1000ULL
+#define DSP_NS_PER_MS 1000000ULL
+#define DSP_NS_PER_S 1000000000ULL
+
+/* Print presses, then wait out the scheduled wakes */
+#define DSP_PRESSES 3
+#define DSP_PRESS_NS (100ULL * DSP_NS_PER_MS)
+#define DSP_RELEASE_NS (50ULL * DSP_NS_PER_MS)
+#define DSP_PRESS_GAP_NS (2000ULL * DSP_NS_PER_MS)
+#define DSP_WAKES 2
+#define DSP_END_NS (((DSP_WAKES * CATHODE_PERIOD_S) + 10) * DSP_NS_PER_S)
+
+/* Shown time, every digit differs from the one before it */
+#define DSP_HOURS_BCD 0x12
+#define DSP_MINUTES_BCD 0x34
+#define DSP_PRINT_SWITCHES 3
+
+/* Blank time of a switch, a longer one is a gap step rather than a switch */
+#define DSP_BREAK_NS ((unsigned long long)DISPLAY_SWITCH_BLANK_US * DSP_NS_PER_US)
+#define DSP_SWITCH_MAX_NS DSP_NS_PER_MS
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static host_ds1307_t dsp_rtc;
+
+/* Print presses, then wait out the scheduled wakes */
+static const host_test_presses_t dsp_presses = {
+  DSP_PRESSES, DSP_PRESS_NS, DSP_RELEASE_NS, DSP_PRESS_GAP_NS, DSP_END_NS, NULL
+};
+
+/* Cathode drive state, recorded at every GPIO event */
+static uint8_t dsp_on = NIXIE_DIGIT_NONE;
+static uint8_t dsp_last = NIXIE_DIGIT_NONE;
+static unsigned long long dsp_off_ns;
+static uint32_t dsp_events;
+static uint32_t dsp_overlaps;
+static uint32_t dsp_switches;
+static unsigned long long dsp_min_break_ns = ~0ULL;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void dsp_trace(host_trace_t event, uint8_t index, uint8_t value);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  host_emu_reset();
+  host_ds1307_init(&dsp_rtc);
+  dsp_rtc.regs[HOST_DS1307_REG_MINUTES] = DSP_MINUTES_BCD;
+  dsp_rtc.regs[HOST_DS1307_REG_HOURS] = DSP_HOURS_BCD;
+  host_i2c_attach(&dsp_rtc.slave);
+  host_test_trace(dsp_trace);
+
+  host_test_presses(&dsp_presses);
+
+  host_test_run(fw_main, HOST_RUN_STOPPED, "firmware runs until the scenario ends");
+
+  printf("GPIO events %u, overlaps %u, switches %u, shortest break %.3f us (configured %.3f us)\n", dsp_events,
+         dsp_overlaps, dsp_switches, (double)dsp_min_break_ns / DSP_NS_PER_US, (double)DSP_BREAK_NS / DSP_NS_PER_US);
+
+  host_test_check(host_irq_count(HOST_VECTOR_RTC) == DSP_WAKES, "one RTC interrupt per period");
+  host_test_check(dsp_overlaps == 0, "one cathode per tube driven at every instant");
+  host_test_check(dsp_switches > (DSP_PRESSES * DSP_PRINT_SWITCHES), "prints and wakes switch digits back to back");
+  host_test_check(dsp_min_break_ns >= DSP_BREAK_NS, "switches blanked for the break before make interval");
+
+  return host_test_result();
+}
+
+/**
+ * @brief Output event hook, checks the cathodes driven after every GPIO write and times each digit switch
+ */
+static void dsp_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  uint8_t i;
+  uint8_t driven = 0;
+  uint8_t digit = NIXIE_DIGIT_NONE;
+  uint16_t lit;
+  unsigned long long gap_ns;
+
+  if (event != HOST_TRACE_GPIO)
+  {
+    return;
+  }
+
+  dsp_events++;
+
+  lit = host_test_lit(0);
+  for (i=0; i<NUM_NIXIE_DIGITS; i++)
+  {
+    if ((lit & (1U << i)) != 0)
+    {
+      driven++;
+      digit = i;
+    }
+  }
+
+  if (driven > 1)
+  {
+    dsp_overlaps++;
+    return;
+  }
+
+  if ((digit == NIXIE_DIGIT_NONE) && (dsp_on != NIXIE_DIGIT_NONE))
+  {
+    dsp_last = dsp_on;
+    dsp_off_ns = host_time_ns();
+  }
+  else if ((digit != NIXIE_DIGIT_NONE) && (dsp_on == NIXIE_DIGIT_NONE) && (dsp_last != NIXIE_DIGIT_NONE) &&
+           (digit != dsp_last))
+  {
+    /* A new digit within the switch window of the old one, longer blanks are gap steps or dimming */
+    gap_ns = host_time_ns() - dsp_off_ns;
+    if (gap_ns < DSP_SWITCH_MAX_NS)
+    {
+      dsp_switches++;
+      dsp_min_break_ns = (gap_ns < dsp_min_break_ns) ? gap_ns : dsp_min_break_ns;
+    }
+  }
+
+  dsp_on = digit;
+}
+
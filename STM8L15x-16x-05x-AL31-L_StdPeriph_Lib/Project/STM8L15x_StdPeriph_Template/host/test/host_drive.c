@@ -0,0 +1,204 @@
+/**
+ * @file host_drive.c
+ * @brief Voltage compensated drive test, prints at falling cell voltages are lit at full duty on a healthy cell, for
+ * the duty that holds the average cell current at its full duty value at NIXIE_DRIVE_FULL_MV on a low one and
+ * refused below the cutoff
+ *
+ * The cell current is taken as proportional to duty / VDD^2 (see nixie_drive_on_us()), lit time is measured on
+ * the tube A cathodes. The cell sags by BATTERY_PSU_SAG_MV while the HV supply is on, the emulator resets (faults)
+ * below its brown-out threshold: the cutoff must keep every print that enables the supply clear of it.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "battery.h"
+#include "display.h"
+#include "state_machine.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define DRV_NS_PER_US 1000ULL
+#define DRV_NS_PER_MS 1000000ULL
+
+/* One print per cell voltage, a full brightness print lasts about 1.3 s */
+#define DRV_PRESS_NS (100ULL * DRV_NS_PER_MS)
+#define DRV_RELEASE_NS (50ULL * DRV_NS_PER_MS)
+#define DRV_PRINT_NS (2000ULL * DRV_NS_PER_MS)
+
+/* Lit time and cell current tolerance (timer ticks and handler time), longest lit time of a dimmed print */
+#define DRV_TOLERANCE 0.03
+#define DRV_PWM_SLACK_NS (50ULL * DRV_NS_PER_US)
+
+#define DRV_NUM_LEVELS (sizeof(drv_levels_mv) / sizeof(drv_levels_mv[0]))
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Cell voltages, full duty (down to BATTERY_LOW_MV), compensated low battery (shorter print), just above and below
+   the cutoff */
+static const uint16_t drv_levels_mv[] = {
+  3000, 2950, 2750, 2620, 2500
+};
+
+static host_ds1307_t drv_rtc;
+
+/* Lit time and supply starts per print, recorded at every GPIO event */
+static uint8_t drv_print;
+static bool drv_pressed;
+static bool drv_lit;
+static bool drv_supply_on;
+static uint8_t drv_enables[DRV_NUM_LEVELS];
+static uint16_t drv_min_vdd_mv = HOST_DEFAULT_VDD_MV;
+static unsigned long long drv_on_ns;
+static unsigned long long drv_lit_ns[DRV_NUM_LEVELS];
+static unsigned long long drv_max_on_ns[DRV_NUM_LEVELS];
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void drv_press(uint8_t press);
+static void drv_trace(host_trace_t event, uint8_t index, uint8_t value);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  /* One print per cell voltage */
+  const host_test_presses_t presses = {
+    DRV_NUM_LEVELS, DRV_PRESS_NS, DRV_RELEASE_NS, DRV_PRINT_NS, 0, drv_press
+  };
+  uint8_t i;
+  double full;
+  double duty;
+  double expected;
+  double current;
+  bool lit = TRUE;
+  bool cut = TRUE;
+  bool capped = TRUE;
+  bool pwm = TRUE;
+  bool supply = TRUE;
+
+  host_emu_reset();
+  host_ds1307_init(&drv_rtc);
+  host_i2c_attach(&drv_rtc.slave);
+  host_test_trace(drv_trace);
+
+  host_test_presses(&presses);
+
+  host_test_run(fw_main, HOST_RUN_STOPPED, "firmware runs until the scenario ends");
+
+  printf("lowest VDD with the HV supply on %u mV, brown-out reset below %u mV\n", drv_min_vdd_mv, HOST_BOR_MV);
+  printf("vdd_mv\tlit_ms\texpected_ms\tduty\tcell_current\tlongest_on_us\n");
+  for (i=0; i<DRV_NUM_LEVELS; i++)
+  {
+    full = (double)DISPLAY_NUM_DIGITS * SM_DISPLAY_PERIOD_MS * DRV_NS_PER_MS *
+           ((drv_levels_mv[i] < BATTERY_LOW_MV) ? SM_DISPLAY_PERIODS_LOW_BATT : SM_DISPLAY_PERIODS);
+    duty = (double)drv_levels_mv[i] / NIXIE_DRIVE_FULL_MV;
+    duty = (duty > 1.0) ? 1.0 : (duty * duty);
+    expected = full * duty;
+
+    /* Average cell current relative to full duty at NIXIE_DRIVE_FULL_MV */
+    current = ((double)drv_lit_ns[i] / full) * ((double)NIXIE_DRIVE_FULL_MV / drv_levels_mv[i]) *
+              ((double)NIXIE_DRIVE_FULL_MV / drv_levels_mv[i]);
+
+    printf("%u\t%.1f\t%.1f\t%.3f\t%.3f\t%.1f\n", drv_levels_mv[i], (double)drv_lit_ns[i] / DRV_NS_PER_MS,
+           expected / DRV_NS_PER_MS, (double)drv_lit_ns[i] / full, current,
+           (double)drv_max_on_ns[i] / DRV_NS_PER_US);
+
+    if (drv_levels_mv[i] < BATTERY_CUTOFF_MV)
+    {
+      cut &= ((drv_lit_ns[i] == 0) && (drv_enables[i] == 0)) ? TRUE : FALSE;
+      continue;
+    }
+
+    supply &= (drv_enables[i] == 1) ? TRUE : FALSE;
+
+    lit &= ((drv_lit_ns[i] > (expected * (1.0 - DRV_TOLERANCE))) &&
+            (drv_lit_ns[i] < (expected * (1.0 + DRV_TOLERANCE)))) ? TRUE : FALSE;
+    capped &= (current < (1.0 + DRV_TOLERANCE)) ? TRUE : FALSE;
+    if (duty < 1.0)
+    {
+      pwm &= (drv_max_on_ns[i] < ((NIXIE_DRIVE_PERIOD_US * DRV_NS_PER_US) + DRV_PWM_SLACK_NS)) ? TRUE : FALSE;
+    }
+  }
+
+  host_test_check(lit, "prints lit for the compensated duty");
+  host_test_check(capped, "average cell current held at its full duty value");
+  host_test_check(pwm, "dimmed digits switched within the PWM cycle");
+  host_test_check(cut, "prints refused below the cutoff, supply left off");
+  host_test_check(supply, "supply started once per print");
+  host_test_check(drv_min_vdd_mv >= HOST_BOR_MV, "cell above the brown-out reset at every supply start");
+
+  return host_test_result();
+}
+
+/**
+ * @brief Sets the cell voltage of the next print
+ */
+static void drv_press(uint8_t press)
+{
+  host_vdd_set_mv(drv_levels_mv[press]);
+  drv_print = press;
+  drv_pressed = TRUE;
+}
+
+/**
+ * @brief Output event hook, sags the cell while the HV supply is on and times every lit interval of tube A against
+ * the print of the current cell voltage
+ */
+static void drv_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  bool lit;
+  bool supply_on;
+  uint16_t sagged_mv;
+  unsigned long long on_ns;
+
+  if ((event != HOST_TRACE_GPIO) || (drv_pressed == FALSE))
+  {
+    return;
+  }
+
+  /* Supply enable is active low */
+  supply_on = host_test_high(NIXIE_SUPPLY_PORT, NIXIE_SUPPLY_PIN) ? FALSE : TRUE;
+  if (supply_on && !drv_supply_on)
+  {
+    drv_enables[drv_print]++;
+    sagged_mv = (uint16_t)(drv_levels_mv[drv_print] - BATTERY_PSU_SAG_MV);
+    drv_min_vdd_mv = (sagged_mv < drv_min_vdd_mv) ? sagged_mv : drv_min_vdd_mv;
+    host_vdd_set_mv(sagged_mv);
+  }
+  else if (!supply_on && drv_supply_on)
+  {
+    host_vdd_set_mv(drv_levels_mv[drv_print]);
+  }
+  drv_supply_on = supply_on;
+
+  lit = (host_test_lit(0) != 0) ? TRUE : FALSE;
+
+  if (lit && !drv_lit)
+  {
+    drv_on_ns = host_time_ns();
+  }
+  else if (!lit && drv_lit)
+  {
+    on_ns = host_time_ns() - drv_on_ns;
+    drv_lit_ns[drv_print] += on_ns;
+    drv_max_on_ns[drv_print] = (on_ns > drv_max_on_ns[drv_print]) ? on_ns : drv_max_on_ns[drv_print];
+  }
+
+  drv_lit = lit;
+}
+
@@ -0,0 +1,307 @@
+/**
+ * @file host_ds1307.c
+ * @brief ext_rtc driver tests against the DS1307 model, also reports bus usage per driver call
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_ds1307.h"
+#include "ext_rtc.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Expected bus usage: START, address, register pointer, repeated START, address, data bytes, STOP */
+#define DS_READ_BITS ((3 * HOST_I2C_CONDITION_BITS) + ((3 + RTC_PAY_READ_SIZE) * HOST_I2C_BYTE_BITS))
+#define DS_WRITE_BITS ((2 * HOST_I2C_CONDITION_BITS) + (3 * HOST_I2C_BYTE_BITS))
+
+/* Clock stretch used by the stretching test, in status polls per byte */
+#define DS_STRETCH_POLLS 500
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Test case, runs inside an emulator run
+ */
+typedef struct
+{
+  const char* name;
+
+  void (*run)(void);
+
+  bool expect_fault; /* Firmware is expected to hang (fault detected by the emulator) */
+
+} ds_test_t;
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static host_ds1307_t ds_rtc;
+static int ds_failures;
+static const char* ds_current;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void ds_check(bool condition, const char* what);
+static void ds_set_time(uint8_t hours, uint8_t day, uint8_t date, uint8_t month, uint8_t year);
+static void ds_test_init(void);
+static void ds_test_init_running(void);
+static void ds_test_read(void);
+static void ds_test_write(void);
+static void ds_test_rollover(void);
+static void ds_test_pointer(void);
+static void ds_test_latch(void);
+static void ds_test_stretch(void);
+static void ds_test_nack(void);
+static void ds_test_stuck_bus(void);
+
+/* Order matters, the driver initializes once and the fault cases leave the bus in an undefined state */
+static const ds_test_t ds_tests[] = {
+  {"init clears clock halt", ds_test_init, FALSE},
+  {"init keeps a running clock", ds_test_init_running, FALSE},
+  {"read time", ds_test_read, FALSE},
+  {"write register", ds_test_write, FALSE},
+  {"calendar rollover", ds_test_rollover, FALSE},
+  {"pointer auto-increment and NVRAM", ds_test_pointer, FALSE},
+  {"time latched on START", ds_test_latch, FALSE},
+  {"clock stretching", ds_test_stretch, FALSE},
+  {"address NACK hangs the driver", ds_test_nack, TRUE},
+  {"stuck SDA hangs the driver", ds_test_stuck_bus, TRUE}
+};
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+
+int main(void)
+{
+  uint8_t i;
+  host_run_result_t result;
+
+  host_emu_reset();
+  host_ds1307_init(&ds_rtc);
+  host_i2c_attach(&ds_rtc.slave);
+
+  for (i=0; i<(sizeof(ds_tests) / sizeof(ds_tests[0])); i++)
+  {
+    ds_current = ds_tests[i].name;
+    result = host_emu_run(ds_tests[i].run, NULL);
+
+    if (ds_tests[i].expect_fault)
+    {
+      ds_check(result == HOST_RUN_FAULT, "emulator detects the hang");
+    }
+    else if (result != HOST_RUN_RETURNED)
+    {
+      ds_check(FALSE, (result == HOST_RUN_FAULT) ? host_emu_fault_msg() : "run stopped");
+    }
+  }
+
+  printf("%s\n", (ds_failures == 0) ? "PASS" : "FAIL");
+  return (ds_failures == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Record a test expectation
+ * @param condition: Expectation result
+ * @param what: Description printed on failure
+ */
+static void ds_check(bool condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("FAILED (%s): %s\n", ds_current, what);
+    ds_failures++;
+  }
+}
+
+/**
+ * @brief Set the clock to hh:59:59 on a given date (BCD values)
+ */
+static void ds_set_time(uint8_t hours, uint8_t day, uint8_t date, uint8_t month, uint8_t year)
+{
+  ds_rtc.regs[HOST_DS1307_REG_SECONDS] = 0x59;
+  ds_rtc.regs[HOST_DS1307_REG_MINUTES] = 0x59;
+  ds_rtc.regs[HOST_DS1307_REG_HOURS] = hours;
+  ds_rtc.regs[HOST_DS1307_REG_DAY] = day;
+  ds_rtc.regs[HOST_DS1307_REG_DATE] = date;
+  ds_rtc.regs[HOST_DS1307_REG_MONTH] = month;
+  ds_rtc.regs[HOST_DS1307_REG_YEAR] = year;
+}
+
+/******************************************************************************/
+/*                                T E S T S                                   */
+/******************************************************************************/
+
+static void ds_test_init(void)
+{
+  /* Oscillator is halted out of power-up */
+  host_ds1307_tick_ms(&ds_rtc, 5000);
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_SECONDS] == HOST_DS1307_CH, "clock halted before init");
+
+  ext_rtc_init();
+  ds_check((ds_rtc.regs[HOST_DS1307_REG_SECONDS] & HOST_DS1307_CH) == 0, "CH bit cleared");
+
+  host_ds1307_tick_ms(&ds_rtc, 61500);
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_SECONDS] == 0x01, "seconds running");
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_MINUTES] == 0x01, "minutes running");
+}
+
+static void ds_test_init_running(void)
+{
+  uint16_t subsecond_ms;
+
+  /* Reset or battery insert with the backup cell holding the time */
+  host_ds1307_tick_ms(&ds_rtc, 36500);
+  subsecond_ms = ds_rtc.subsecond_ms;
+
+  host_ds1307_clear_counters(&ds_rtc);
+  ext_rtc_init();
+  ds_check(ds_rtc.bytes_written == 1, "only the register pointer written");
+  ds_check(ds_rtc.subsecond_ms == subsecond_ms, "countdown chain kept");
+
+  /* Back to the time the next test expects */
+  host_ds1307_tick_ms(&ds_rtc, 60000 - 36500);
+  ds_check((ds_rtc.regs[HOST_DS1307_REG_SECONDS] == 0x01) && (ds_rtc.regs[HOST_DS1307_REG_MINUTES] == 0x02),
+           "seconds and minutes kept");
+}
+
+static void ds_test_read(void)
+{
+  uint8_t buf[RTC_PAY_READ_SIZE] = {0};
+  uint32_t bits = host_i2c_bus_bits();
+
+  host_ds1307_clear_counters(&ds_rtc);
+  ext_rtc_read(buf, RTC_PAY_READ_SIZE);
+  bits = host_i2c_bus_bits() - bits;
+
+  ds_check((buf[0] == 0x01) && (buf[1] == 0x02), "seconds and minutes read");
+  ds_check(ds_rtc.starts == 2, "START and repeated START");
+  ds_check(ds_rtc.stops == 1, "single STOP");
+  ds_check(ds_rtc.bytes_written == 1, "register pointer written");
+  ds_check(ds_rtc.bytes_read == RTC_PAY_READ_SIZE, "payload read");
+  ds_check(bits == DS_READ_BITS, "bus bit times");
+
+  printf("ext_rtc_read: %u address phases, %u bus bits, %u us at %u Hz\n", (unsigned)ds_rtc.starts, (unsigned)bits,
+         (unsigned)((bits * 1000000UL) / I2C_SPEED), (unsigned)I2C_SPEED);
+}
+
+static void ds_test_write(void)
+{
+  uint32_t bits = host_i2c_bus_bits();
+
+  host_ds1307_clear_counters(&ds_rtc);
+  ext_rtc_write(HOST_DS1307_REG_MINUTES, 0x42);
+  bits = host_i2c_bus_bits() - bits;
+
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_MINUTES] == 0x42, "minutes written");
+  ds_check((ds_rtc.starts == 1) && (ds_rtc.stops == 1) && (ds_rtc.bytes_written == 2), "single transaction");
+  ds_check(bits == DS_WRITE_BITS, "bus bit times");
+
+  printf("ext_rtc_write: %u address phases, %u bus bits, %u us at %u Hz\n", (unsigned)ds_rtc.starts, (unsigned)bits,
+         (unsigned)((bits * 1000000UL) / I2C_SPEED), (unsigned)I2C_SPEED);
+}
+
+static void ds_test_rollover(void)
+{
+  /* New year, day of week wraps 7 -> 1 */
+  ds_set_time(0x23, 7, 0x31, 0x12, 0x99);
+  host_ds1307_tick_ms(&ds_rtc, 1000);
+  ds_check(memcmp(ds_rtc.regs, "\x00\x00\x00\x01\x01\x01\x00", 7) == 0, "31/12/99 23:59:59 -> 01/01/00 00:00:00");
+
+  /* Leap and common years */
+  ds_set_time(0x23, 3, 0x28, 0x02, 0x24);
+  host_ds1307_tick_ms(&ds_rtc, 1000);
+  ds_check((ds_rtc.regs[HOST_DS1307_REG_DATE] == 0x29) && (ds_rtc.regs[HOST_DS1307_REG_MONTH] == 0x02), "29/02/24");
+  ds_set_time(0x23, 3, 0x28, 0x02, 0x25);
+  host_ds1307_tick_ms(&ds_rtc, 1000);
+  ds_check((ds_rtc.regs[HOST_DS1307_REG_DATE] == 0x01) && (ds_rtc.regs[HOST_DS1307_REG_MONTH] == 0x03), "01/03/25");
+
+  /* 12 hour mode, 11 PM -> 12 AM is midnight, 11 AM -> 12 PM is not */
+  ds_set_time((uint8_t)(HOST_DS1307_12H | HOST_DS1307_PM | 0x11), 1, 0x10, 0x06, 0x25);
+  host_ds1307_tick_ms(&ds_rtc, 1000);
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_HOURS] == (HOST_DS1307_12H | 0x12), "12 AM");
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_DATE] == 0x11, "date advanced at midnight");
+  ds_set_time((uint8_t)(HOST_DS1307_12H | 0x11), 1, 0x10, 0x06, 0x25);
+  host_ds1307_tick_ms(&ds_rtc, 1000);
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_HOURS] == (HOST_DS1307_12H | HOST_DS1307_PM | 0x12), "12 PM");
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_DATE] == 0x10, "date kept at noon");
+
+  /* Restore a known time for the following tests */
+  memset(ds_rtc.regs, 0, HOST_DS1307_NUM_CLOCK_REGS);
+}
+
+static void ds_test_pointer(void)
+{
+  /* NVRAM through the driver */
+  ext_rtc_write(HOST_DS1307_NVRAM_START, 0x5A);
+  ext_rtc_write(HOST_DS1307_NUM_REGS - 1, 0xA5);
+  ds_check(ds_rtc.regs[HOST_DS1307_NVRAM_START] == 0x5A, "first NVRAM byte");
+  ds_check(ds_rtc.regs[HOST_DS1307_NUM_REGS - 1] == 0xA5, "last NVRAM byte");
+
+  /* Multi-byte write wraps from the end of NVRAM to the seconds register, unused bits read back as 0 */
+  ds_rtc.slave.start(ds_rtc.slave.ctx, FALSE);
+  ds_rtc.slave.write(ds_rtc.slave.ctx, HOST_DS1307_NUM_REGS - 1);
+  ds_rtc.slave.write(ds_rtc.slave.ctx, 0x11);
+  ds_rtc.slave.write(ds_rtc.slave.ctx, 0x22);
+  ds_rtc.slave.write(ds_rtc.slave.ctx, 0xFF);
+  ds_rtc.slave.stop(ds_rtc.slave.ctx);
+  ds_check(ds_rtc.regs[HOST_DS1307_NUM_REGS - 1] == 0x11, "write at pointer");
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_SECONDS] == 0x22, "pointer wraps to seconds");
+  ds_check(ds_rtc.regs[HOST_DS1307_REG_MINUTES] == 0x7F, "minutes write mask");
+  ds_rtc.regs[HOST_DS1307_REG_SECONDS] = 0;
+  ds_rtc.regs[HOST_DS1307_REG_MINUTES] = 0;
+}
+
+static void ds_test_latch(void)
+{
+  uint8_t buf[RTC_PAY_READ_SIZE];
+
+  ds_rtc.slave.start(ds_rtc.slave.ctx, FALSE);
+  ds_rtc.slave.write(ds_rtc.slave.ctx, HOST_DS1307_REG_SECONDS);
+  ds_rtc.slave.start(ds_rtc.slave.ctx, TRUE);
+  host_ds1307_tick_ms(&ds_rtc, 1000);
+  buf[0] = ds_rtc.slave.read(ds_rtc.slave.ctx);
+  ds_rtc.slave.stop(ds_rtc.slave.ctx);
+  ds_check(buf[0] == 0x00, "read returns time at START");
+
+  ext_rtc_read(buf, RTC_PAY_READ_SIZE);
+  ds_check(buf[0] == 0x01, "next START loads the new time");
+}
+
+static void ds_test_stretch(void)
+{
+  uint8_t buf[RTC_PAY_READ_SIZE] = {0};
+
+  ds_rtc.slave.stretch = DS_STRETCH_POLLS;
+  ext_rtc_write(HOST_DS1307_REG_MINUTES, 0x33);
+  ext_rtc_read(buf, RTC_PAY_READ_SIZE);
+  ds_rtc.slave.stretch = 0;
+
+  ds_check((buf[0] == 0x01) && (buf[1] == 0x33), "transfers complete while stretched");
+}
+
+/* Driver has no NACK handling, it waits for the address event forever */
+static void ds_test_nack(void)
+{
+  ds_rtc.nack_address = 1;
+  ext_rtc_write(HOST_DS1307_REG_MINUTES, 0x00);
+}
+
+/* Driver has no bus recovery, START is never granted */
+static void ds_test_stuck_bus(void)
+{
+  uint8_t buf[RTC_PAY_READ_SIZE];
+
+  ds_rtc.slave.sda_stuck = TRUE;
+  ext_rtc_read(buf, RTC_PAY_READ_SIZE);
+}
@@ -0,0 +1,250 @@
+/**
+ * @file host_frame.c
+ * @brief Frame playback test, a digit sweep rendered once (each digit held, then a repeated blink of the last one)
+ * lands on the cathode pins at the frame times with a blank frame between digits, without touching the other pins
+ * of the tube ports
+ *
+ * Built against both targets: the breakout board streams the frames by DMA (an interrupt per segment pass and
+ * per hold), the watch writes them from the TIM2 update interrupt.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "hardwaredefs.h"
+#include "periph_clk.h"
+#include "frame.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define FRM_NS_PER_US 1000ULL
+#define FRM_NS_PER_MS 1000000ULL
+
+/* Sweep 0-9 with every digit held, every digit after the first needs a break before make frame, then a blank and
+   9 frame repeated and a blank frame */
+#define FRM_PERIOD_TICKS DISPLAY_MS_TO_TICKS(2)
+#define FRM_HOLD_TICKS DISPLAY_MS_TO_TICKS(18)
+#define FRM_BLINKS 4
+#define FRM_TICK_NS ((unsigned long long)DISPLAY_US_PER_TICK * FRM_NS_PER_US)
+#define FRM_PERIOD_NS (FRM_PERIOD_TICKS * FRM_TICK_NS)
+#define FRM_HELD_NS ((FRM_PERIOD_TICKS + FRM_HOLD_TICKS) * FRM_TICK_NS)
+#define FRM_FRAMES ((2 * NUM_NIXIE_DIGITS) - 1 + (2 * FRM_BLINKS) + 1)
+#define FRM_RUNS (NUM_NIXIE_DIGITS + FRM_BLINKS)
+
+/* Segments: one per held digit, the blink and the last frame */
+#define FRM_SEGMENTS (NUM_NIXIE_DIGITS + 1 + 1)
+#define FRM_PASSES (NUM_NIXIE_DIGITS + FRM_BLINKS + 1)
+
+/* Run ends long after the sweep */
+#define FRM_TIMEOUT_NS (2000ULL * FRM_NS_PER_MS)
+
+/* Sleeping share of the CPU while DMA plays the frames, in percent */
+#define FRM_MIN_SLEEP_PCT 99
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static bool frm_rendered = TRUE;
+static bool frm_started;
+static unsigned long long frm_start_ns;
+static unsigned long long frm_end_ns;
+static unsigned long long frm_run_ns;
+
+/* Cathode drive state, recorded at every GPIO event */
+static uint8_t frm_on = NIXIE_DIGIT_NONE;
+static unsigned long long frm_on_ns;
+static unsigned long long frm_off_ns;
+static uint8_t frm_shown[FRM_RUNS];
+static unsigned long long frm_lit_ns[FRM_RUNS];
+static uint8_t frm_num_shown;
+static uint32_t frm_overlaps;
+static uint32_t frm_psu_drops;
+static unsigned long long frm_min_break_ns = ~0ULL;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void frm_entry(void);
+static void frm_timeout(void);
+static void frm_trace(host_trace_t event, uint8_t index, uint8_t value);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+int main(void)
+{
+  unsigned long long sleep_pct;
+  unsigned long long expected_ns;
+  uint8_t i;
+  bool timing = TRUE;
+
+  host_emu_reset();
+  host_test_trace(frm_trace);
+  host_alarm_set(HOST_ALARM_STIMULUS, FRM_TIMEOUT_NS, frm_timeout);
+
+  host_test_run(frm_entry, HOST_RUN_RETURNED, "playback ends on its own");
+
+  sleep_pct = 100 - ((frm_run_ns * 100) / (frm_end_ns - frm_start_ns + 1));
+  printf("frames %u, period %llu us, held %llu us, shortest break %llu us, CPU asleep %llu%%\n", FRM_FRAMES,
+         FRM_PERIOD_NS / FRM_NS_PER_US, FRM_HELD_NS / FRM_NS_PER_US, frm_min_break_ns / FRM_NS_PER_US, sleep_pct);
+  printf("interrupts: DMA1 %u, TIM2 %u\n", host_irq_count(HOST_VECTOR_DMA1_CHANNEL0_1),
+         host_irq_count(HOST_VECTOR_TIM2_UPDATE));
+
+  host_test_check(frm_rendered, "animation fits the frame buffers");
+  host_test_check(frm_started, "frame buffer accepted");
+  host_test_check(frm_num_shown == FRM_RUNS, "every digit shown");
+  for (i=0; (i < frm_num_shown) && (i < FRM_RUNS); i++)
+  {
+    host_test_check(frm_shown[i] == ((i < NUM_NIXIE_DIGITS) ? i : (NUM_NIXIE_DIGITS - 1)), "digits shown in frame order");
+    expected_ns = (i < NUM_NIXIE_DIGITS) ? FRM_HELD_NS : FRM_PERIOD_NS;
+    if ((frm_lit_ns[i] + FRM_TICK_NS + FRM_NS_PER_US < expected_ns) ||
+        (frm_lit_ns[i] > expected_ns + FRM_TICK_NS + FRM_NS_PER_US))
+    {
+      printf("digit %u lit %llu us, expected %llu us\n", frm_shown[i], frm_lit_ns[i] / FRM_NS_PER_US,
+             expected_ns / FRM_NS_PER_US);
+      timing = FALSE;
+    }
+  }
+  host_test_check(frm_overlaps == 0, "one cathode driven at every instant");
+  host_test_check(timing, "held digits lit for the period and hold, blinks for one period");
+  host_test_check(frm_min_break_ns >= ((unsigned long long)DISPLAY_SWITCH_BLANK_US * FRM_NS_PER_US),
+                  "break before make frames");
+  host_test_check(frm_psu_drops == 0, "other pins of the tube ports keep their level");
+  host_test_check(*tube_A.curr_digit == NIXIE_DIGIT_NONE, "tube state follows the last frame");
+  host_test_check(periph_clk_users(CLK_Peripheral_TIM2) == 0, "frame timer clock released");
+
+  #ifdef FRAME_DMA
+  host_test_check(host_irq_count(HOST_VECTOR_TIM2_UPDATE) == NUM_NIXIE_DIGITS, "one timer interrupt per hold");
+  host_test_check(host_irq_count(HOST_VECTOR_DMA1_CHANNEL0_1) == FRM_PASSES, "one DMA interrupt per segment pass");
+  host_test_check((host_dma_transfers(0) == FRM_FRAMES) && (host_dma_transfers(2) == FRM_FRAMES), "one transfer per port per frame");
+  host_test_check(sleep_pct >= FRM_MIN_SLEEP_PCT, "CPU sleeps while the frames play");
+  host_test_check(periph_clk_users(CLK_Peripheral_DMA1) == 0, "DMA clock released");
+  #else
+  host_test_check(host_irq_count(HOST_VECTOR_TIM2_UPDATE) == FRM_FRAMES, "one timer interrupt per frame, none per hold");
+  #endif /* FRAME_DMA */
+
+  return host_test_result();
+}
+
+/**
+ * @brief Firmware side, render the animation once, play it and sleep until it ends
+ */
+static void frm_entry(void)
+{
+  uint8_t digits[DISPLAY_NUM_TUBES];
+  uint8_t d;
+
+  CLK_SYSCLKDivConfig(CLK_SYSCLKDiv_2);
+  nixie_init_pins(&tube_A, &shared_psu);
+  enableInterrupts();
+  nixie_enable_psu(&shared_psu);
+
+  memset(digits, DISPLAY_BLANK, sizeof(digits));
+  frame_clear();
+  for (d=0; d<NUM_NIXIE_DIGITS; d++)
+  {
+    digits[0] = d;
+    frm_rendered &= frame_add(digits);
+    frm_rendered &= frame_hold(FRM_HOLD_TICKS);
+  }
+  digits[0] = DISPLAY_BLANK;
+  frm_rendered &= frame_add(digits);
+  digits[0] = NUM_NIXIE_DIGITS - 1;
+  frm_rendered &= frame_add(digits);
+  frm_rendered &= frame_repeat(FRM_BLINKS);
+  digits[0] = DISPLAY_BLANK;
+  frm_rendered &= frame_add(digits);
+
+  frm_start_ns = host_time_ns();
+  frm_run_ns = host_residency_ns(HOST_CPU_RUN);
+  frm_started = frame_play(FRM_PERIOD_TICKS);
+  while (frame_busy())
+  {
+    wfi();
+  }
+  frm_end_ns = host_time_ns();
+  frm_run_ns = host_residency_ns(HOST_CPU_RUN) - frm_run_ns;
+}
+
+/**
+ * @brief Playback never ended
+ */
+static void frm_timeout(void)
+{
+  host_emu_stop();
+}
+
+/**
+ * @brief Output event hook, checks the cathodes driven after every GPIO write and times each digit and break
+ */
+static void frm_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  uint8_t i;
+  uint8_t driven = 0;
+  uint8_t digit = NIXIE_DIGIT_NONE;
+  uint16_t lit;
+
+  if (event != HOST_TRACE_GPIO)
+  {
+    return;
+  }
+
+  /* HV supply enable is active low, it must stay on once enabled */
+  if ((index == host_test_port_index(NIXIE_SUPPLY_PORT)) && (frm_start_ns != 0) && ((value & NIXIE_SUPPLY_PIN) != 0))
+  {
+    frm_psu_drops++;
+  }
+
+  lit = host_test_lit(0);
+  for (i=0; i<NUM_NIXIE_DIGITS; i++)
+  {
+    if (((lit >> i) & 1U) != 0)
+    {
+      driven++;
+      digit = i;
+    }
+  }
+
+  if (driven > 1)
+  {
+    frm_overlaps++;
+    return;
+  }
+
+  if (digit == frm_on)
+  {
+    return;
+  }
+
+  if (frm_on != NIXIE_DIGIT_NONE)
+  {
+    if ((frm_num_shown != 0) && (frm_num_shown <= FRM_RUNS))
+    {
+      frm_lit_ns[frm_num_shown - 1] = host_time_ns() - frm_on_ns;
+    }
+    frm_off_ns = host_time_ns();
+  }
+
+  if (digit != NIXIE_DIGIT_NONE)
+  {
+    if ((frm_num_shown != 0) && ((host_time_ns() - frm_off_ns) < frm_min_break_ns))
+    {
+      frm_min_break_ns = host_time_ns() - frm_off_ns;
+    }
+    if (frm_num_shown < FRM_RUNS)
+    {
+      frm_shown[frm_num_shown] = digit;
+    }
+    frm_num_shown++;
+    frm_on_ns = host_time_ns();
+  }
+
+  frm_on = digit;
+}
+
@@ -0,0 +1,163 @@
+/**
+ * @file host_gpio_fast.c
+ * @brief gpio_fast_init() test, the port registers it leaves must match one GPIO_Init() per table entry
+ *
+ * Every case starts from the same register contents (bits set and cleared on pins the table does not touch),
+ * is applied once through GPIO_Init() and once through gpio_fast_init(), and the CR1/CR2/DDR/ODR of every port
+ * are compared.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "gpio_fast.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Register contents before every case */
+#define GF_INITIAL_ODR 0xA5
+#define GF_INITIAL_DDR 0x3C
+#define GF_INITIAL_CR1 0x5A
+#define GF_INITIAL_CR2 0xC3
+
+#define GF_NUM_CASES (sizeof(gf_cases) / sizeof(gf_cases[0]))
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Test case, a pin table
+ */
+typedef struct
+{
+  const char* name;
+
+  const gpio_fast_cfg_t* table;
+
+  uint8_t len;
+
+} gf_case_t;
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Output table as nixie_init_pins() builds it, runs of one mode split across ports */
+static const gpio_fast_cfg_t gf_outputs[] = {
+  {GPIOB, GPIO_Pin_0, GPIO_Mode_Out_PP_High_Fast},
+  {GPIOE, GPIO_Pin_0, GPIO_Mode_Out_PP_Low_Fast},
+  {GPIOE, GPIO_Pin_1, GPIO_Mode_Out_PP_Low_Fast},
+  {GPIOE, GPIO_Pin_2, GPIO_Mode_Out_PP_Low_Fast},
+  {GPIOA, GPIO_Pin_6, GPIO_Mode_Out_PP_Low_Fast},
+  {GPIOE, GPIO_Pin_3, GPIO_Mode_Out_PP_Low_Fast},
+  {GPIOA, GPIO_Pin_7, GPIO_Mode_Out_PP_Low_Fast}
+};
+
+/* Every mode on one port */
+static const gpio_fast_cfg_t gf_modes[] = {
+  {GPIOC, GPIO_Pin_0, GPIO_Mode_In_FL_No_IT},
+  {GPIOC, GPIO_Pin_1, GPIO_Mode_In_PU_No_IT},
+  {GPIOC, GPIO_Pin_2, GPIO_Mode_In_FL_IT},
+  {GPIOC, GPIO_Pin_3, GPIO_Mode_In_PU_IT},
+  {GPIOC, GPIO_Pin_4, GPIO_Mode_Out_OD_Low_Fast},
+  {GPIOC, GPIO_Pin_5, GPIO_Mode_Out_PP_High_Slow},
+  {GPIOC, (uint8_t)(GPIO_Pin_6 | GPIO_Pin_7), GPIO_Mode_Out_OD_HiZ_Slow}
+};
+
+/* More ports than gpio_fast_init() merges, the last ones are configured directly */
+static const gpio_fast_cfg_t gf_ports_overflow[] = {
+  {GPIOA, GPIO_Pin_2, GPIO_Mode_Out_PP_Low_Fast},
+  {GPIOB, GPIO_Pin_3, GPIO_Mode_In_PU_IT},
+  {GPIOC, GPIO_Pin_4, GPIO_Mode_Out_PP_High_Fast},
+  {GPIOD, GPIO_Pin_5, GPIO_Mode_In_FL_No_IT},
+  {GPIOE, GPIO_Pin_6, GPIO_Mode_Out_OD_HiZ_Fast},
+  {GPIOF, GPIO_Pin_7, GPIO_Mode_Out_PP_Low_Slow},
+  {GPIOA, GPIO_Pin_3, GPIO_Mode_Out_PP_High_Slow}
+};
+
+static const gf_case_t gf_cases[] = {
+  {"output runs split across ports", gf_outputs, (uint8_t)(sizeof(gf_outputs) / sizeof(gf_outputs[0]))},
+  {"every mode", gf_modes, (uint8_t)(sizeof(gf_modes) / sizeof(gf_modes[0]))},
+  {"more ports than merged", gf_ports_overflow, (uint8_t)(sizeof(gf_ports_overflow) / sizeof(gf_ports_overflow[0]))}
+};
+
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void gf_preset(void);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+int main(void)
+{
+  GPIO_TypeDef expected[HOST_NUM_GPIO_PORTS];
+  const gf_case_t* test;
+  uint8_t c;
+  uint8_t i;
+  uint8_t p;
+  GPIO_TypeDef* port;
+  bool same;
+
+  host_emu_reset();
+
+  for (c=0, test=gf_cases; c<GF_NUM_CASES; c++, test++)
+  {
+    gf_preset();
+    for (i=0; i<test->len; i++)
+    {
+      GPIO_Init(test->table[i].port, test->table[i].pins, test->table[i].mode);
+    }
+    for (p=0; p<HOST_NUM_GPIO_PORTS; p++)
+    {
+      expected[p] = *host_test_port(p);
+    }
+
+    gf_preset();
+    gpio_fast_init(test->table, test->len);
+
+    same = TRUE;
+    for (p=0; p<HOST_NUM_GPIO_PORTS; p++)
+    {
+      port = host_test_port(p);
+      if ((port->ODR != expected[p].ODR) || (port->DDR != expected[p].DDR) ||
+          (port->CR1 != expected[p].CR1) || (port->CR2 != expected[p].CR2))
+      {
+        printf("port %u: ODR %02X/%02X DDR %02X/%02X CR1 %02X/%02X CR2 %02X/%02X (got/expected)\n", p,
+               port->ODR, expected[p].ODR, port->DDR, expected[p].DDR, port->CR1,
+               expected[p].CR1, port->CR2, expected[p].CR2);
+        same = FALSE;
+      }
+    }
+    host_test_check(same, test->name);
+  }
+
+  return host_test_result();
+}
+
+/**
+ * @brief Same register contents on every port before each configuration
+ */
+static void gf_preset(void)
+{
+  GPIO_TypeDef* port;
+  uint8_t p;
+
+  for (p=0; p<HOST_NUM_GPIO_PORTS; p++)
+  {
+    port = host_test_port(p);
+    port->ODR = GF_INITIAL_ODR;
+    port->DDR = GF_INITIAL_DDR;
+    port->CR1 = GF_INITIAL_CR1;
+    port->CR2 = GF_INITIAL_CR2;
+  }
+}
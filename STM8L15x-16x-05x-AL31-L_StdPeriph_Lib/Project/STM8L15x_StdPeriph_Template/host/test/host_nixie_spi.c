@@ -0,0 +1,282 @@
+/**
+ * @file host_nixie_spi.c
+ * @brief Shift register backend test, digits switched through nixie_digit_control() are shifted out on SPI1 by
+ * DMA and latched with one cathode per tube, changes made during a burst are sent by the next one, a burst the SPI
+ * never finishes is left unlatched and digits past 9 are refused
+ *
+ * The test models the HV shift register chain: bytes traced on MOSI shift into NIXIE_SPI_NUM_OUTPUTS stages (the
+ * last bit shifted ends on output 0) and the outputs follow the stages while the latch pin is high. Built against
+ * both targets (one and two tubes on the chain).
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "hardwaredefs.h"
+#include "nixie.h"
+#include "periph_clk.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define NSP_NS_PER_MS 1000000ULL
+
+/* Whole scenario, ends long before */
+#define NSP_TIMEOUT_NS (100ULL * NSP_NS_PER_MS)
+
+/* Digit switched twice while interrupts are masked */
+#define NSP_FIRST_DIGIT 3
+#define NSP_SECOND_DIGIT 4
+
+/* Bursts sent while the SPI shift clock is stopped, never latched */
+#define NSP_STUCK_BURSTS 1
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Tubes on the chain, in chain order */
+static const nixie_tube_t* const nsp_tubes[NIXIE_SPI_NUM_TUBES] = {
+  &tube_A,
+  #ifndef STM8_BASEBAND
+  &tube_B
+  #endif /* !STM8_BASEBAND */
+};
+
+/* Chain model: register stages and latched outputs, output 0 nearest the MCU */
+static uint8_t nsp_stages[NIXIE_SPI_NUM_OUTPUTS];
+static uint8_t nsp_outputs[NIXIE_SPI_NUM_OUTPUTS];
+static bool nsp_latch_high;
+static uint32_t nsp_latches;
+static uint32_t nsp_open_shifts; /* Bytes shifted while the outputs followed the stages */
+static uint32_t nsp_overlaps;
+static uint32_t nsp_spare_driven;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void nsp_entry(void);
+static void nsp_timeout(void);
+static void nsp_trace(host_trace_t event, uint8_t index, uint8_t value);
+static void nsp_latch(void);
+static uint8_t nsp_shown(uint8_t tube);
+static bool nsp_showing(uint8_t tube, uint8_t digit);
+static uint32_t nsp_bursts(void);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+int main(void)
+{
+  host_emu_reset();
+  host_test_trace(nsp_trace);
+  host_alarm_set(HOST_ALARM_STIMULUS, NSP_TIMEOUT_NS, nsp_timeout);
+
+  host_test_run(nsp_entry, HOST_RUN_RETURNED, "scenario ends on its own");
+
+  printf("tubes %u, chain %u outputs (%u bytes), bursts %u, latches %u, DMA interrupts %u\n",
+         (unsigned)NIXIE_SPI_NUM_TUBES, (unsigned)NIXIE_SPI_NUM_OUTPUTS, (unsigned)NIXIE_SPI_BYTES, nsp_bursts(),
+         nsp_latches, host_irq_count(HOST_VECTOR_DMA1_CHANNEL2_3));
+
+  host_test_check((host_spi_tx_bytes() % NIXIE_SPI_BYTES) == 0, "whole chain shifted by every burst");
+  /* The latch pin going idle at init latches too */
+  host_test_check(nsp_latches == (nsp_bursts() + 1 - NSP_STUCK_BURSTS), "every finished burst latched once");
+  host_test_check(host_irq_count(HOST_VECTOR_DMA1_CHANNEL2_3) == nsp_bursts(), "one DMA interrupt per burst");
+  host_test_check(nsp_open_shifts == 0, "outputs held while shifting");
+  host_test_check(nsp_overlaps == 0, "one cathode per tube latched at every instant");
+  host_test_check(nsp_spare_driven == 0, "outputs past the last tube kept off");
+  host_test_check((periph_clk_users(CLK_Peripheral_SPI1) == 0) && (periph_clk_users(CLK_Peripheral_DMA1) == 0),
+                  "SPI1 and DMA1 clocks gated between bursts");
+
+  return host_test_result();
+}
+
+/**
+ * @brief Firmware side, every digit of every tube switched on and off through the nixie API
+ */
+static void nsp_entry(void)
+{
+  uint32_t bursts;
+  uint32_t latches;
+  uint8_t t;
+  uint8_t d;
+  bool shown = TRUE;
+
+  CLK_SYSCLKDivConfig(CLK_SYSCLKDiv_2);
+  enableInterrupts();
+  for (t=0; t<NIXIE_SPI_NUM_TUBES; t++)
+  {
+    nixie_init_pins(nsp_tubes[t], &shared_psu);
+  }
+
+  for (t=0; t<NIXIE_SPI_NUM_TUBES; t++)
+  {
+    shown &= (nsp_shown(t) == NIXIE_DIGIT_NONE) ? TRUE : FALSE;
+  }
+  host_test_check((nsp_latches != 0) && shown, "chain cleared at init");
+
+  bursts = nsp_bursts();
+  host_test_check(nixie_digit_control(&tube_A, 0, DIGIT_ON, &shared_psu) == NIXIE_PSU_DISABLED, "refused with supply off");
+  host_test_check(nsp_bursts() == bursts, "nothing shifted with supply off");
+
+  nixie_enable_psu(&shared_psu);
+
+  /* Straight switches, the old cathode goes off in the same latch */
+  for (t=0; t<NIXIE_SPI_NUM_TUBES; t++)
+  {
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      nixie_digit_control(nsp_tubes[t], d, DIGIT_ON, &shared_psu);
+      shown &= nsp_showing(t, d);
+    }
+  }
+  host_test_check(shown, "every digit latched as switched");
+
+  /* Second change while the first burst waits for its interrupt */
+  bursts = nsp_bursts();
+  disableInterrupts();
+  nixie_digit_control(&tube_A, NSP_FIRST_DIGIT, DIGIT_ON, &shared_psu);
+  nixie_digit_control(&tube_A, NSP_SECOND_DIGIT, DIGIT_ON, &shared_psu);
+  host_test_check(nsp_bursts() == (bursts + 1), "one burst at a time");
+  enableInterrupts();
+  host_test_check(nsp_bursts() == (bursts + 2), "changes made during a burst sent by the next one");
+  host_test_check(nsp_showing(0, NSP_SECOND_DIGIT), "last change latched");
+
+  bursts = nsp_bursts();
+  host_test_check(nixie_digit_control(&tube_A, NUM_NIXIE_DIGITS, DIGIT_ON, &shared_psu) == NIXIE_ERROR,
+                  "digit past 9 refused");
+  host_test_check((nsp_bursts() == bursts) && nsp_showing(0, NSP_SECOND_DIGIT), "nothing shifted for a digit past 9");
+
+  /* Shift clock stopped, the interrupt gives up on the burst and the next change sends the image again */
+  latches = nsp_latches;
+  host_spi_stall(TRUE);
+  nixie_digit_control(&tube_A, NSP_FIRST_DIGIT, DIGIT_ON, &shared_psu);
+  host_test_check((nsp_latches == latches) && (nsp_shown(0) == NSP_SECOND_DIGIT), "stuck burst not latched");
+  host_test_check((periph_clk_users(CLK_Peripheral_SPI1) == 0) && (periph_clk_users(CLK_Peripheral_DMA1) == 0),
+                  "clocks released after a stuck burst");
+  host_spi_stall(FALSE);
+  nixie_digit_control(&tube_A, NSP_SECOND_DIGIT, DIGIT_ON, &shared_psu);
+  host_test_check((nsp_latches == (latches + 1)) && nsp_showing(0, NSP_SECOND_DIGIT), "next change latched");
+
+  for (t=0; t<NIXIE_SPI_NUM_TUBES; t++)
+  {
+    nixie_digit_control(nsp_tubes[t], *nsp_tubes[t]->curr_digit, DIGIT_OFF, &shared_psu);
+    shown &= (nsp_shown(t) == NIXIE_DIGIT_NONE) ? TRUE : FALSE;
+  }
+  host_test_check(shown, "tubes blank after turning the digits off");
+
+  nixie_disable_psu(&shared_psu);
+}
+
+/**
+ * @brief Scenario never ended
+ */
+static void nsp_timeout(void)
+{
+  host_emu_stop();
+}
+
+/**
+ * @brief Output event hook, shifts MOSI bytes into the chain model and latches it on the latch pin
+ */
+static void nsp_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  uint8_t bit;
+  uint8_t k;
+  bool high;
+
+  if (event == HOST_TRACE_SPI_TX)
+  {
+    for (bit=0; bit<8; bit++)
+    {
+      for (k=(NIXIE_SPI_NUM_OUTPUTS - 1); k>0; k--)
+      {
+        nsp_stages[k] = nsp_stages[k - 1];
+      }
+      nsp_stages[0] = (uint8_t)((value >> (7 - bit)) & 0x01);
+    }
+    if (nsp_latch_high)
+    {
+      nsp_open_shifts++;
+      nsp_latch();
+    }
+  }
+  else if ((event == HOST_TRACE_GPIO) && (index == host_test_port_index(NIXIE_SPI_PORT)))
+  {
+    high = ((value & NIXIE_SPI_LATCH_PIN) != 0) ? TRUE : FALSE;
+    if (high && !nsp_latch_high)
+    {
+      nsp_latches++;
+      nsp_latch();
+    }
+    nsp_latch_high = high;
+  }
+}
+
+/**
+ * @brief Outputs take the register stages, checked for overlapping cathodes and driven spare outputs
+ */
+static void nsp_latch(void)
+{
+  uint8_t t;
+  uint8_t d;
+  uint8_t k;
+  uint8_t driven;
+
+  memcpy(nsp_outputs, nsp_stages, sizeof(nsp_outputs));
+
+  for (t=0; t<NIXIE_SPI_NUM_TUBES; t++)
+  {
+    driven = 0;
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      driven = (uint8_t)(driven + nsp_outputs[nsp_tubes[t]->first_output + d]);
+    }
+    nsp_overlaps += (driven > 1) ? 1 : 0;
+  }
+
+  for (k=(NIXIE_SPI_NUM_TUBES * NUM_NIXIE_DIGITS); k<NIXIE_SPI_NUM_OUTPUTS; k++)
+  {
+    nsp_spare_driven += nsp_outputs[k];
+  }
+}
+
+/**
+ * @brief Digit a tube shows on the latched outputs
+ * @retval 0-9, NIXIE_DIGIT_NONE if blank
+ */
+static uint8_t nsp_shown(uint8_t tube)
+{
+  uint8_t d;
+
+  for (d=0; d<NUM_NIXIE_DIGITS; d++)
+  {
+    if (nsp_outputs[nsp_tubes[tube]->first_output + d] != 0)
+    {
+      return d;
+    }
+  }
+
+  return NIXIE_DIGIT_NONE;
+}
+
+/**
+ * @brief Check a tube shows a digit, on the latched outputs and in the driver state
+ */
+static bool nsp_showing(uint8_t tube, uint8_t digit)
+{
+  return ((nsp_shown(tube) == digit) && (*nsp_tubes[tube]->curr_digit == digit)) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Bursts shifted out so far
+ */
+static uint32_t nsp_bursts(void)
+{
+  return host_spi_tx_bytes() / NIXIE_SPI_BYTES;
+}
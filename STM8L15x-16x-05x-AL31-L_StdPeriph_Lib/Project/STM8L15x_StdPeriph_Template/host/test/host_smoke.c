@@ -0,0 +1,131 @@
+/**
+ * @file host_smoke.c
+ * @brief Smoke test, boots the baseband firmware on the emulator and walks it through the power switch states
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "hardwaredefs.h"
+#include "state_machine.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define SMOKE_SWITCH_PINS (POWER_SWITCH_PIN_0 | POWER_SWITCH_PIN_1 | POWER_SWITCH_PIN_2)
+
+/* Boot time report header */
+#define SMOKE_BOOT_TIME "Boot time (us): "
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static uint8_t smoke_step;
+static int smoke_failures;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void smoke_check(bool condition, const char* what);
+static void smoke_switch(uint8_t pin);
+static bool smoke_idle(bool halted);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  host_run_result_t result;
+
+  host_emu_reset();
+
+  /* Switch inputs idle high (pull-ups) */
+  host_gpio_input(POWER_SWITCH_PORT, SMOKE_SWITCH_PINS, TRUE);
+
+  result = host_emu_run(fw_main, smoke_idle);
+  smoke_check(result == HOST_RUN_STOPPED, "firmware runs until the script ends");
+  if (result == HOST_RUN_FAULT)
+  {
+    printf("fault: %s\n", host_emu_fault_msg());
+  }
+  smoke_check(smoke_step == 3, "every script step reached");
+
+  printf("%s\n", (smoke_failures == 0) ? "PASS" : "FAIL");
+  return (smoke_failures == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Record a test expectation
+ * @param condition: Expectation result
+ * @param what: Description printed on failure
+ */
+static void smoke_check(bool condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("FAILED (step %u): %s\n", smoke_step, what);
+    smoke_failures++;
+  }
+}
+
+/**
+ * @brief Flip the power switch to a position, only the selected pin is pulled low
+ * @param pin: Power switch pin
+ */
+static void smoke_switch(uint8_t pin)
+{
+  host_gpio_input(POWER_SWITCH_PORT, (uint8_t)(SMOKE_SWITCH_PINS & ~pin), TRUE);
+  host_gpio_input(POWER_SWITCH_PORT, pin, FALSE);
+}
+
+/**
+ * @brief Test script, runs each time the firmware waits for an interrupt
+ * @param halted: TRUE if the firmware executed HALT
+ * @retval TRUE to keep running
+ */
+static bool smoke_idle(bool halted)
+{
+  const char* boot;
+
+  switch (smoke_step)
+  {
+    case 0:
+      /* Boot complete, UART was brought up on first use to report boot time */
+      smoke_check(halted == FALSE, "waits in WFI after boot");
+      smoke_check(state_machine.current_state == STATE_INIT, "starts in init state");
+      boot = strstr(host_uart_tx(), SMOKE_BOOT_TIME);
+      smoke_check(boot != NULL, "boot time reported over UART");
+      if (boot != NULL)
+      {
+        /* Strings are sent with their terminator, the digits follow the header's */
+        printf("%s%s\n", SMOKE_BOOT_TIME, boot + sizeof(SMOKE_BOOT_TIME));
+      }
+      /* HV supply enable is active low */
+      smoke_check((host_gpio_output(NIXIE_SUPPLY_PORT) & NIXIE_SUPPLY_PIN) != 0, "HV supply off after boot");
+      host_uart_tx_clear();
+      smoke_switch(POWER_SWITCH_PIN_2);
+      break;
+    case 1:
+      smoke_check(halted, "halts while powered off");
+      smoke_check(state_machine.current_state == STATE_POWEROFF, "power down request handled");
+      smoke_check(host_irq_count(HOST_VECTOR_EXTI0 + 2) == 1, "one EXTI2 interrupt");
+      smoke_switch(POWER_SWITCH_PIN_1);
+      break;
+    case 2:
+      smoke_check(halted == FALSE, "back to WFI after wake");
+      smoke_check(state_machine.current_state == STATE_SLEEP, "sleep request handled");
+      smoke_check(host_irq_count(HOST_VECTOR_EXTI0 + 1) == 1, "one EXTI1 interrupt");
+      break;
+    default:
+      break;
+  }
+
+  smoke_step++;
+  return (smoke_step < 3) ? TRUE : FALSE;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file host_test.c
+ * @brief Helpers shared by the host tests: expectation counting, firmware runs, the print press stimulus (press
+ * and release alarms), output level tracking from the trace hook and the cathodes lit on each tube
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+
+#include "host_test.h"
+#include "hardwaredefs.h"
+#include "nixie.h"
+
+/******************************************************************************/
+/*                P U B L I C  G L O B A L  V A R I A B L E S                 */
+/******************************************************************************/
+uint8_t host_test_levels[HOST_NUM_GPIO_PORTS];
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Ports in trace order (index used by HOST_TRACE_GPIO) */
+static GPIO_TypeDef* const host_test_ports[HOST_NUM_GPIO_PORTS] = {
+  GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF
+};
+
+/* Cathodes of every tube, from the board definition */
+static GPIO_TypeDef* const host_test_digit_ports[HOST_TEST_NUM_TUBES][NUM_NIXIE_DIGITS] = {
+  {TUBE_A_PORT_0, TUBE_A_PORT_1, TUBE_A_PORT_2, TUBE_A_PORT_3, TUBE_A_PORT_4,
+   TUBE_A_PORT_5, TUBE_A_PORT_6, TUBE_A_PORT_7, TUBE_A_PORT_8, TUBE_A_PORT_9},
+  #ifndef STM8_BASEBAND
+  {TUBE_B_PORT_0, TUBE_B_PORT_1, TUBE_B_PORT_2, TUBE_B_PORT_3, TUBE_B_PORT_4,
+   TUBE_B_PORT_5, TUBE_B_PORT_6, TUBE_B_PORT_7, TUBE_B_PORT_8, TUBE_B_PORT_9}
+  #endif /* !STM8_BASEBAND */
+};
+static const uint8_t host_test_digit_pins[HOST_TEST_NUM_TUBES][NUM_NIXIE_DIGITS] = {
+  {DIGIT_A_0, DIGIT_A_1, DIGIT_A_2, DIGIT_A_3, DIGIT_A_4, DIGIT_A_5, DIGIT_A_6, DIGIT_A_7, DIGIT_A_8, DIGIT_A_9},
+  #ifndef STM8_BASEBAND
+  {DIGIT_B_0, DIGIT_B_1, DIGIT_B_2, DIGIT_B_3, DIGIT_B_4, DIGIT_B_5, DIGIT_B_6, DIGIT_B_7, DIGIT_B_8, DIGIT_B_9}
+  #endif /* !STM8_BASEBAND */
+};
+
+static int host_test_failures;
+
+/* Print press stimulus, step counts presses and releases */
+static const host_test_presses_t* host_test_stimulus;
+static uint8_t host_test_step;
+
+static host_trace_hook_t host_test_hook;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void host_test_alarm(void);
+static void host_test_record(host_trace_t event, uint8_t index, uint8_t value);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Record a test expectation
+ * @param condition: Expectation result
+ * @param what: Description printed on failure
+ */
+void host_test_check(bool condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("FAILED: %s\n", what);
+    host_test_failures++;
+  }
+}
+
+/**
+ * @brief Print the test verdict
+ * @retval Process exit code, 0 if every expectation held
+ */
+int host_test_result(void)
+{
+  printf("%s\n", (host_test_failures == 0) ? "PASS" : "FAIL");
+  return (host_test_failures == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Run firmware code until it returns or the scenario stops it, the way the run ends is an expectation
+ * @param entry: Firmware entry point
+ * @param expected: Expected end of the run
+ * @param what: Description printed on failure
+ */
+void host_test_run(void (*entry)(void), host_run_result_t expected, const char* what)
+{
+  host_run_result_t result;
+
+  result = host_emu_run(entry, NULL);
+  host_test_check(result == expected, what);
+  if ((result == HOST_RUN_FAULT) && (expected != HOST_RUN_FAULT))
+  {
+    printf("fault: %s\n", host_emu_fault_msg());
+  }
+}
+
+/**
+ * @brief Arm the print press stimulus, the scenario stops at its end
+ * @param presses: Stimulus, must stay valid during the run
+ */
+void host_test_presses(const host_test_presses_t* presses)
+{
+  host_test_stimulus = presses;
+  host_test_step = 0;
+
+  host_gpio_input(POWER_SWITCH_PORT, (uint8_t)(POWER_SWITCH_PIN_0 | POWER_SWITCH_PIN_1 | POWER_SWITCH_PIN_2), TRUE);
+  host_alarm_set(HOST_ALARM_STIMULUS, presses->first_ns, host_test_alarm);
+}
+
+/**
+ * @brief Install the test output hook, GPIO events update host_test_levels before it is called
+ * @param hook: Test hook, NULL to only track the levels
+ */
+void host_test_trace(host_trace_hook_t hook)
+{
+  host_test_hook = hook;
+  host_trace_set_hook(host_test_record);
+}
+
+/**
+ * @brief Port at a trace index
+ * @param index: Index in host_test_levels
+ * @retval GPIO port
+ */
+GPIO_TypeDef* host_test_port(uint8_t index)
+{
+  return host_test_ports[index];
+}
+
+/**
+ * @brief Trace index of a port
+ * @param port: GPIO port
+ * @retval Index in host_test_levels
+ */
+uint8_t host_test_port_index(GPIO_TypeDef* port)
+{
+  uint8_t i;
+
+  for (i=0; (i < (HOST_NUM_GPIO_PORTS - 1)) && (host_test_ports[i] != port); i++)
+  {
+  }
+
+  return i;
+}
+
+/**
+ * @brief Check output pins against the tracked levels
+ * @param port: GPIO port
+ * @param pins: Pins
+ * @retval TRUE if any of the pins is high
+ */
+bool host_test_high(GPIO_TypeDef* port, uint8_t pins)
+{
+  return ((host_test_levels[host_test_port_index(port)] & pins) != 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Cathodes driven on a tube, from the tracked levels
+ * @param tube: Tube index, 0 for tube A
+ * @retval One bit per digit
+ */
+uint16_t host_test_lit(uint8_t tube)
+{
+  uint16_t lit = 0;
+  uint8_t d;
+
+  for (d=0; d<NUM_NIXIE_DIGITS; d++)
+  {
+    if (host_test_high(host_test_digit_ports[tube][d], host_test_digit_pins[tube][d]))
+    {
+      lit |= (uint16_t)(1U << d);
+    }
+  }
+
+  return lit;
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Stimulus alarm, print presses then wait for the scenario end
+ */
+static void host_test_alarm(void)
+{
+  const host_test_presses_t* presses = host_test_stimulus;
+  unsigned long long next_ns;
+
+  if (host_test_step == (2 * presses->presses))
+  {
+    host_emu_stop();
+    return;
+  }
+
+  /* Even steps press, odd steps release */
+  if (((host_test_step & 1) == 0) && (presses->on_press != NULL))
+  {
+    presses->on_press((uint8_t)(host_test_step / 2));
+  }
+  host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_0, ((host_test_step & 1) != 0) ? TRUE : FALSE);
+  host_test_step++;
+
+  if ((host_test_step == (2 * presses->presses)) && (presses->end_ns != 0))
+  {
+    next_ns = presses->end_ns;
+  }
+  else
+  {
+    next_ns = host_time_ns() + (((host_test_step & 1) != 0) ? presses->release_ns : presses->gap_ns);
+  }
+  host_alarm_set(HOST_ALARM_STIMULUS, next_ns, host_test_alarm);
+}
+
+/**
+ * @brief Output event hook, tracks the GPIO levels and forwards every event to the test hook
+ */
+static void host_test_record(host_trace_t event, uint8_t index, uint8_t value)
+{
+  if (event == HOST_TRACE_GPIO)
+  {
+    host_test_levels[index] = value;
+  }
+
+  if (host_test_hook != NULL)
+  {
+    host_test_hook(event, index, value);
+  }
+}
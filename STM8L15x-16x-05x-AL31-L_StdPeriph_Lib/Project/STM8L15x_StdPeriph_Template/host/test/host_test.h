@@ -0,0 +1,73 @@
+/**
+ * @file host_test.h
+ * @brief Function prototypes, defines and types for the helpers shared by the host tests (expectations, firmware
+ * runs, print press stimulus, output level tracking and the cathodes lit on each tube)
+ *
+ * Built into every test executable, so the board and driver definitions follow the firmware variant it links.
+ */
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "host_emu.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+/* Tubes whose cathodes are on GPIO pins (host_test_lit()) */
+#ifdef STM8_BASEBAND
+#define HOST_TEST_NUM_TUBES 1
+#else
+#define HOST_TEST_NUM_TUBES 2
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Called before every print press
+ * @param press: Press index, from 0
+ */
+typedef void (*host_test_press_hook_t)(uint8_t press);
+
+/**
+ * @brief Print press stimulus on POWER_SWITCH_PIN_0, the switch inputs idle high (pull-ups)
+ */
+typedef struct
+{
+  uint8_t presses;
+
+  unsigned long long first_ns; /* First press */
+
+  unsigned long long release_ns; /* Press length */
+
+  unsigned long long gap_ns; /* Release to the next press, and to the end after the last one if end_ns is 0 */
+
+  unsigned long long end_ns; /* Scenario end, 0 for gap_ns after the last release */
+
+  host_test_press_hook_t on_press; /* Optional */
+
+} host_test_presses_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+
+/* Output levels of every port (trace order), updated before the test hook sees a GPIO event */
+extern uint8_t host_test_levels[HOST_NUM_GPIO_PORTS];
+
+void host_test_check(bool condition, const char* what);
+int host_test_result(void);
+void host_test_run(void (*entry)(void), host_run_result_t expected, const char* what);
+void host_test_presses(const host_test_presses_t* presses);
+void host_test_trace(host_trace_hook_t hook);
+GPIO_TypeDef* host_test_port(uint8_t index);
+uint8_t host_test_port_index(GPIO_TypeDef* port);
+bool host_test_high(GPIO_TypeDef* port, uint8_t pins);
+uint16_t host_test_lit(uint8_t tube);
+
+#endif /* HOST_TEST_H_ */
@@ -0,0 +1,296 @@
+/**
+ * @file host_transition.c
+ * @brief Digit transition test, prints (19:50) played as frames show the selected effect between the steps with
+ * one cathode driven at a time, every switch blanked for the break before make interval and the supply off after,
+ * a switch moved while the frames play leaves the LED on the frame port alone
+ *
+ * Built against a firmware variant per effect (TRANSITION_EFFECT): the slot machine roll is checked digit by
+ * digit, the crossfade by the old and new digits alternating many times between the steps.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "display.h"
+#include "transition.h"
+#include "frame.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define TRN_NS_PER_US 1000ULL
+#define TRN_NS_PER_MS 1000000ULL
+
+/* Print presses, then let the last print end */
+#define TRN_PRESSES 2
+#define TRN_PRESS_NS (100ULL * TRN_NS_PER_MS)
+#define TRN_RELEASE_NS (50ULL * TRN_NS_PER_MS)
+#define TRN_PRESS_GAP_NS (2000ULL * TRN_NS_PER_MS)
+
+/* Shown time, every step changes the digit */
+#define TRN_HOURS_BCD 0x19
+#define TRN_MINUTES_BCD 0x50
+
+/* Power switch moved during the first print, ignored while the frames play */
+#define TRN_ALARM_BUSY 1
+#define TRN_BUSY_PRESS_NS (700ULL * TRN_NS_PER_MS)
+#define TRN_BUSY_RELEASE_NS (750ULL * TRN_NS_PER_MS)
+
+/* Blank time of a switch, a longer one ends the print */
+#define TRN_BREAK_NS ((unsigned long long)DISPLAY_SWITCH_BLANK_US * TRN_NS_PER_US)
+#define TRN_PRINT_GAP_NS (10ULL * TRN_NS_PER_MS)
+
+/* Digits shown per print, a crossfade switches at least twice per PWM cycle between two steps */
+#define TRN_MAX_RUNS 2048
+#define TRN_FADE_MIN_RUNS (2 * TRANSITION_FADE_CYCLES)
+
+/* Timer interrupts of a print: warm-up and holds, not one per frame */
+#define TRN_MAX_TIM2_IRQS 24
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Slot machine print, each step rolls through the two digits before it */
+static const uint8_t trn_slot_runs[] = {1, 7, 8, 9, 3, 4, 5, 8, 9, 0};
+
+static host_ds1307_t trn_rtc;
+
+/* Print presses, then let the last print end */
+static const host_test_presses_t trn_presses = {
+  TRN_PRESSES, TRN_PRESS_NS, TRN_RELEASE_NS, TRN_PRESS_GAP_NS, 0, NULL
+};
+
+/* Cathode drive state, recorded at every GPIO event */
+static uint8_t trn_on = NIXIE_DIGIT_NONE;
+static unsigned long long trn_off_ns;
+static uint32_t trn_overlaps;
+static bool trn_supply_high;
+static uint32_t trn_supply_ons;
+static unsigned long long trn_min_break_ns = ~0ULL;
+
+/* LED level changes, one per accepted request */
+static bool trn_led_high;
+static uint32_t trn_led_changes;
+static bool trn_busy_pressed;
+
+/* Digits shown by each print, in order */
+static uint8_t trn_runs[TRN_PRESSES][TRN_MAX_RUNS];
+static uint32_t trn_num_runs[TRN_PRESSES];
+static uint8_t trn_print;
+static uint8_t trn_prints;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void trn_trace(host_trace_t event, uint8_t index, uint8_t value);
+static bool trn_slot_print(uint8_t print);
+static bool trn_fade_print(uint8_t print);
+static void trn_busy_press(void);
+static void trn_busy_release(void);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  uint8_t p;
+  bool shown = TRUE;
+
+  host_emu_reset();
+  host_ds1307_init(&trn_rtc);
+  trn_rtc.regs[HOST_DS1307_REG_MINUTES] = TRN_MINUTES_BCD;
+  trn_rtc.regs[HOST_DS1307_REG_HOURS] = TRN_HOURS_BCD;
+  host_i2c_attach(&trn_rtc.slave);
+  host_test_trace(trn_trace);
+
+  host_test_presses(&trn_presses);
+  host_alarm_set(TRN_ALARM_BUSY, TRN_BUSY_PRESS_NS, trn_busy_press);
+
+  host_test_run(fw_main, HOST_RUN_STOPPED, "firmware runs until the scenario ends");
+
+  printf("effect %u, prints %u, digits shown %u/%u, shortest break %.3f us (configured %.3f us), "
+         "TIM2 interrupts %u, DMA interrupts %u\n", (unsigned)TRANSITION_EFFECT, trn_prints, trn_num_runs[0],
+         trn_num_runs[TRN_PRESSES - 1], (double)trn_min_break_ns / TRN_NS_PER_US,
+         (double)TRN_BREAK_NS / TRN_NS_PER_US, host_irq_count(HOST_VECTOR_TIM2_UPDATE),
+         host_irq_count(HOST_VECTOR_DMA1_CHANNEL0_1));
+
+  host_test_check(trn_prints == TRN_PRESSES, "one print per press");
+  for (p=0; p<TRN_PRESSES; p++)
+  {
+    shown &= (TRANSITION_EFFECT == TRANSITION_SLOT) ? trn_slot_print(p) : trn_fade_print(p);
+  }
+  host_test_check(shown, "effect played between the steps of every print");
+  host_test_check(trn_overlaps == 0, "one cathode driven at every instant");
+  host_test_check(trn_min_break_ns >= TRN_BREAK_NS, "switches blanked for the break before make interval");
+  host_test_check(trn_supply_ons == TRN_PRESSES, "supply enabled once per print");
+  host_test_check(host_test_high(NIXIE_SUPPLY_PORT, NIXIE_SUPPLY_PIN), "supply off after the prints");
+  host_test_check(trn_on == NIXIE_DIGIT_NONE, "tubes blank after the prints");
+  host_test_check(host_irq_count(HOST_VECTOR_TIM2_UPDATE) <= (TRN_PRESSES * TRN_MAX_TIM2_IRQS),
+                  "timer interrupts for holds only");
+  host_test_check(host_irq_count(HOST_VECTOR_DMA1_CHANNEL0_1) != 0, "frames streamed by DMA");
+  host_test_check(trn_busy_pressed, "power switch moved while the frames played");
+  host_test_check(trn_led_changes == TRN_PRESSES, "LED only toggled by the accepted presses");
+
+  return host_test_result();
+}
+
+/**
+ * @brief Output event hook, checks the cathodes driven after every GPIO write, times each switch and records the
+ * digits shown by each print
+ */
+static void trn_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  uint8_t i;
+  uint8_t driven = 0;
+  uint8_t digit = NIXIE_DIGIT_NONE;
+  uint16_t lit;
+  bool high;
+  unsigned long long gap_ns;
+
+  if (event != HOST_TRACE_GPIO)
+  {
+    return;
+  }
+
+  if (index == host_test_port_index(LED_GPIO_PORT))
+  {
+    high = ((value & LED_GPIO_PINS) != 0) ? TRUE : FALSE;
+    trn_led_changes += (high != trn_led_high) ? 1 : 0;
+    trn_led_high = high;
+  }
+
+  /* Supply enable is active low, the pin starts high */
+  if (index == host_test_port_index(NIXIE_SUPPLY_PORT))
+  {
+    high = ((value & NIXIE_SUPPLY_PIN) != 0) ? TRUE : FALSE;
+    if (trn_supply_high && !high)
+    {
+      trn_supply_ons++;
+    }
+    trn_supply_high = high;
+  }
+
+  lit = host_test_lit(0);
+  for (i=0; i<NUM_NIXIE_DIGITS; i++)
+  {
+    if ((lit & (1U << i)) != 0)
+    {
+      driven++;
+      digit = i;
+    }
+  }
+
+  if (driven > 1)
+  {
+    trn_overlaps++;
+    return;
+  }
+
+  if ((digit == NIXIE_DIGIT_NONE) && (trn_on != NIXIE_DIGIT_NONE))
+  {
+    trn_off_ns = host_time_ns();
+  }
+  else if ((digit != NIXIE_DIGIT_NONE) && (trn_on == NIXIE_DIGIT_NONE))
+  {
+    /* A long blank separates two prints */
+    gap_ns = host_time_ns() - trn_off_ns;
+    if ((trn_prints == 0) || (gap_ns >= TRN_PRINT_GAP_NS))
+    {
+      trn_print = trn_prints;
+      trn_prints++;
+    }
+    else
+    {
+      trn_min_break_ns = (gap_ns < trn_min_break_ns) ? gap_ns : trn_min_break_ns;
+    }
+
+    if ((trn_print < TRN_PRESSES) && (trn_num_runs[trn_print] < TRN_MAX_RUNS))
+    {
+      trn_runs[trn_print][trn_num_runs[trn_print]] = digit;
+      trn_num_runs[trn_print]++;
+    }
+  }
+
+  trn_on = digit;
+}
+
+/**
+ * @brief Power switch to sleep while the first print's frames play, the request is refused
+ */
+static void trn_busy_press(void)
+{
+  trn_busy_pressed = frame_busy();
+  host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_1, FALSE);
+  host_alarm_set(TRN_ALARM_BUSY, TRN_BUSY_RELEASE_NS, trn_busy_release);
+}
+
+/**
+ * @brief Power switch back
+ */
+static void trn_busy_release(void)
+{
+  host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_1, TRUE);
+}
+
+/**
+ * @brief Check a slot machine print, the steps and the rolled digits in order
+ * @param print: Print index
+ * @retval TRUE if shown as expected
+ */
+static bool trn_slot_print(uint8_t print)
+{
+  if (trn_num_runs[print] != sizeof(trn_slot_runs))
+  {
+    return FALSE;
+  }
+
+  return (memcmp(trn_runs[print], trn_slot_runs, sizeof(trn_slot_runs)) == 0) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Check a crossfade print, starts and ends on the first and last steps, only the digits of the steps shown,
+ * each step fading into the next
+ * @param print: Print index
+ * @retval TRUE if shown as expected
+ */
+static bool trn_fade_print(uint8_t print)
+{
+  uint32_t i;
+  uint32_t fades = 0;
+  uint8_t digit;
+
+  if (trn_num_runs[print] < (3 * TRN_FADE_MIN_RUNS))
+  {
+    return FALSE;
+  }
+  if ((trn_runs[print][0] != 1) || (trn_runs[print][trn_num_runs[print] - 1] != 0))
+  {
+    return FALSE;
+  }
+
+  for (i=1; i<trn_num_runs[print]; i++)
+  {
+    digit = trn_runs[print][i];
+    if ((digit != 1) && (digit != 9) && (digit != 5) && (digit != 0))
+    {
+      return FALSE;
+    }
+    /* Back to the previous step, the fade interleaving */
+    if ((i >= 2) && (digit == trn_runs[print][i - 2]))
+    {
+      fades++;
+    }
+  }
+
+  return (fades >= (3 * TRN_FADE_MIN_RUNS / 2)) ? TRUE : FALSE;
+}
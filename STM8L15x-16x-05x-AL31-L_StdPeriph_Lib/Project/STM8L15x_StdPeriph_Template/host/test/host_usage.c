@@ -0,0 +1,226 @@
+/**
+ * @file host_usage.c
+ * @brief Lifetime usage log test, a log left by a previous boot is picked up (skipping a torn record), every
+ * scheduled wake writes the next slot and the newest record matches the lit time seen on the cathode pins
+ *
+ * Built against a firmware variant with a short wake period and a write on every wake.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "cathode.h"
+#include "usage.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define USE_NS_PER_MS 1000000ULL
+#define USE_NS_PER_S 1000000000ULL
+
+/* Print presses before the first scheduled wake, the DS1307 model is not ticked so every print shows 00:00 */
+#define USE_PRESSES 3
+#define USE_PRESS_NS (100ULL * USE_NS_PER_MS)
+#define USE_RELEASE_NS (50ULL * USE_NS_PER_MS)
+#define USE_PRESS_GAP_NS (2000ULL * USE_NS_PER_MS)
+
+/* Enough wakes to go round the log twice */
+#define USE_WAKES 12
+#define USE_END_NS (((USE_WAKES * CATHODE_PERIOD_S) + 10) * USE_NS_PER_S)
+
+/* Log left by the previous boot: a valid record with an hour on cathode 0, then a newer torn record */
+#define USE_PRESET_S 3600
+#define USE_TORN_S 99999
+#define USE_BOOT_REPORT "Usage tube A (h): 0=00001.00 1=00000.00"
+
+/* Host UART output kept, without the string terminators */
+#define USE_UART_SIZE 16384
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+static host_ds1307_t use_rtc;
+
+/* Print presses, then wait out the scheduled wakes */
+static const host_test_presses_t use_presses = {
+  USE_PRESSES, USE_PRESS_NS, USE_RELEASE_NS, USE_PRESS_GAP_NS, USE_END_NS, NULL
+};
+
+/* Cathode glow time measured on the pins (cathode driven and HV supply on) */
+static bool use_psu_on;
+static bool use_glowing[NUM_NIXIE_DIGITS];
+static unsigned long long use_since_ns[NUM_NIXIE_DIGITS];
+static unsigned long long use_glow_ns[NUM_NIXIE_DIGITS];
+
+static char use_uart[USE_UART_SIZE + 1];
+static uint16_t use_uart_len;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void use_preset(uint8_t slot, uint16_t seq, uint32_t digit0_s, bool torn);
+static uint8_t use_crc(uint8_t crc, const uint8_t* data, uint8_t len);
+static void use_trace(host_trace_t event, uint8_t index, uint8_t value);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  uint32_t writes;
+  uint32_t min_writes = 0xFFFFFFFF;
+  uint32_t max_writes = 0;
+  unsigned long long stored_ns;
+  unsigned long long seen_ns;
+  const char* report;
+  uint16_t offset;
+  uint8_t d;
+
+  host_emu_reset();
+  host_ds1307_init(&use_rtc);
+  host_i2c_attach(&use_rtc.slave);
+  host_test_trace(use_trace);
+
+  use_preset(0, 1, USE_PRESET_S, FALSE);
+  use_preset(1, 2, USE_TORN_S, TRUE);
+
+  host_test_presses(&use_presses);
+
+  host_test_run(fw_main, HOST_RUN_STOPPED, "firmware runs until the scenario ends");
+
+  report = strstr(use_uart, "Usage");
+  host_test_check((report != NULL) && (strncmp(report, USE_BOOT_REPORT, strlen(USE_BOOT_REPORT)) == 0),
+                  "boot report shows the previous boot's hour");
+  host_test_check(strstr(use_uart, "0=00027.77") == NULL, "torn record ignored");
+  host_test_check(host_irq_count(HOST_VECTOR_RTC) == USE_WAKES, "one RTC interrupt per period");
+  printf("data EEPROM write time: %llu ms\n", host_eeprom_ns() / USE_NS_PER_MS);
+
+  /* Records used round robin, every used byte wears at the same rate */
+  for (offset=0; offset<(USAGE_NUM_SLOTS * USAGE_RECORD_SIZE); offset++)
+  {
+    writes = host_eeprom_writes(offset);
+    min_writes = (writes < min_writes) ? writes : min_writes;
+    max_writes = (writes > max_writes) ? writes : max_writes;
+  }
+  printf("slot writes: min %u max %u\n", min_writes, max_writes);
+  host_test_check((max_writes - min_writes) <= 1, "writes spread over every slot");
+  host_test_check(max_writes == ((USE_WAKES + USAGE_NUM_SLOTS - 1) / USAGE_NUM_SLOTS), "one record per wake");
+
+  /* Boot again over the same data EEPROM, the newest record holds the lit time up to the last write. The cathodes
+     exercised after it are still pending, as is less than a second per cathode. */
+  usage_init();
+  for (d=0; d<NUM_NIXIE_DIGITS; d++)
+  {
+    stored_ns = (unsigned long long)(usage_total_s(0, d) - ((d == 0) ? USE_PRESET_S : 0)) * USE_NS_PER_S;
+    seen_ns = use_glow_ns[d];
+    printf("cathode %u: stored %llu ms, seen %llu ms\n", d, stored_ns / USE_NS_PER_MS, seen_ns / USE_NS_PER_MS);
+    host_test_check((stored_ns <= seen_ns) &&
+                    ((seen_ns - stored_ns) <= (((CATHODE_EXERCISE_MS + 1000ULL) * USE_NS_PER_MS) + (seen_ns / 100))),
+                    "stored lit time matches the pins");
+  }
+
+  return host_test_result();
+}
+
+/**
+ * @brief Write a record as a previous boot would have left it
+ * @param slot: Log slot
+ * @param seq: Record sequence number
+ * @param digit0_s: Lit time of cathode 0, every other cathode is 0
+ * @param torn: Corrupt the CRC, as a write interrupted by a reset leaves it
+ */
+static void use_preset(uint8_t slot, uint16_t seq, uint32_t digit0_s, bool torn)
+{
+  uint8_t record[USAGE_RECORD_SIZE];
+  uint8_t crc = USAGE_CRC_INIT;
+  uint16_t i;
+
+  /* Words MSB first */
+  memset(record, 0, sizeof(record));
+  record[0] = (uint8_t)(seq >> 8);
+  record[1] = (uint8_t)seq;
+  for (i=0; i<USAGE_WORD_SIZE; i++)
+  {
+    record[USAGE_WORD_SIZE + i] = (uint8_t)(digit0_s >> (8 * (USAGE_WORD_SIZE - 1 - i)));
+  }
+
+  crc = use_crc(crc, record, 2);
+  crc = use_crc(crc, &record[USAGE_WORD_SIZE], (uint8_t)(USAGE_RECORD_SIZE - USAGE_WORD_SIZE));
+  record[2] = torn ? (uint8_t)(crc ^ 0x5A) : crc;
+
+  host_eeprom_load((uint16_t)(slot * USAGE_RECORD_SIZE), record, sizeof(record));
+}
+
+/**
+ * @brief CRC-8 of the usage log, computed independently of the firmware
+ */
+static uint8_t use_crc(uint8_t crc, const uint8_t* data, uint8_t len)
+{
+  uint8_t bit;
+
+  while (len-- != 0)
+  {
+    crc ^= *data++;
+    for (bit=0; bit<8; bit++)
+    {
+      crc = (uint8_t)(((crc & 0x80) != 0) ? ((crc << 1) ^ USAGE_CRC_POLY) : (crc << 1));
+    }
+  }
+
+  return crc;
+}
+
+/**
+ * @brief Output event hook, keeps the UART output and integrates the glow time per cathode
+ */
+static void use_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  bool glowing;
+  uint16_t lit;
+  uint8_t i;
+
+  if (event == HOST_TRACE_UART_TX)
+  {
+    if ((value != '\0') && (use_uart_len < USE_UART_SIZE))
+    {
+      use_uart[use_uart_len++] = (char)value;
+    }
+    return;
+  }
+
+  if (event != HOST_TRACE_GPIO)
+  {
+    return;
+  }
+
+  /* HV supply enable is active low */
+  if (index == host_test_port_index(NIXIE_SUPPLY_PORT))
+  {
+    use_psu_on = ((value & NIXIE_SUPPLY_PIN) == 0) ? TRUE : FALSE;
+  }
+
+  lit = host_test_lit(0);
+  for (i=0; i<NUM_NIXIE_DIGITS; i++)
+  {
+    glowing = (use_psu_on && ((lit & (1U << i)) != 0)) ? TRUE : FALSE;
+    if (glowing && (use_glowing[i] == FALSE))
+    {
+      use_since_ns[i] = host_time_ns();
+    }
+    else if ((glowing == FALSE) && use_glowing[i])
+    {
+      use_glow_ns[i] += host_time_ns() - use_since_ns[i];
+    }
+    use_glowing[i] = glowing;
+  }
+}
+
@@ -0,0 +1,152 @@
+/**
+ * @file host_watch.c
+ * @brief Watch target print test, the time (12:34) is set from the host after a wake button press, a print press then
+ * lights the tens of each field on tube A and the units on tube B, one cathode per tube at a time, with the supply
+ * off again after the print
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_test.h"
+#include "hardwaredefs.h"
+#include "display.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define WCH_NS_PER_MS 1000000ULL
+
+/* Time set, the host answers the prompt with HHMM */
+#define WCH_ALARM_SET 1
+#define WCH_SET_NS (50ULL * WCH_NS_PER_MS)
+#define WCH_SET_RELEASE_NS (100ULL * WCH_NS_PER_MS)
+#define WCH_SET_PROMPT "Set time (HHMM): "
+#define WCH_SET_TIME "1234"
+
+/* One print, a full brightness print lasts about 1.3 s */
+#define WCH_PRESSES 1
+#define WCH_PRESS_NS (200ULL * WCH_NS_PER_MS)
+#define WCH_RELEASE_NS (50ULL * WCH_NS_PER_MS)
+#define WCH_PRINT_NS (2000ULL * WCH_NS_PER_MS)
+
+/* Shown time, digits lit per tube (step digit order: tube A tens, tube B units) */
+#define WCH_TUBE_A_DIGITS ((1U << 1) | (1U << 3))
+#define WCH_TUBE_B_DIGITS ((1U << 2) | (1U << 4))
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Cathode and supply state, recorded at every GPIO event */
+static uint16_t wch_lit[HOST_TEST_NUM_TUBES]; /* Digits seen lit, one bit per digit */
+static uint32_t wch_overlaps;
+static uint32_t wch_unpowered;
+static bool wch_supply_on;
+
+/* Set when the time was sent in answer to the prompt */
+static bool wch_time_sent;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void wch_trace(host_trace_t event, uint8_t index, uint8_t value);
+static void wch_set_press(void);
+static void wch_set_release(void);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(void)
+{
+  /* One print */
+  const host_test_presses_t presses = {
+    WCH_PRESSES, WCH_PRESS_NS, WCH_RELEASE_NS, WCH_PRINT_NS, 0, NULL
+  };
+
+  /* The watch keeps time in the on-chip RTC calendar, set from the host */
+  host_emu_reset();
+  host_gpio_input(WAKE_BUTTON_PORT, WAKE_BUTTON_PIN, TRUE);
+  host_alarm_set(WCH_ALARM_SET, WCH_SET_NS, wch_set_press);
+  host_test_trace(wch_trace);
+  host_test_presses(&presses);
+
+  host_test_run(fw_main, HOST_RUN_STOPPED, "firmware runs until the scenario ends");
+
+  printf("tube A digits lit 0x%03X (expected 0x%03X), tube B digits lit 0x%03X (expected 0x%03X)\n", wch_lit[0],
+         WCH_TUBE_A_DIGITS, wch_lit[1], WCH_TUBE_B_DIGITS);
+
+  host_test_check(wch_time_sent, "set time prompt sent after the wake button press");
+  host_test_check(wch_lit[0] == WCH_TUBE_A_DIGITS, "tube A shows the tens");
+  host_test_check(wch_lit[1] == WCH_TUBE_B_DIGITS, "tube B shows the units");
+  host_test_check(wch_overlaps == 0, "one cathode per tube driven at a time");
+  host_test_check(wch_unpowered == 0, "cathodes only driven with the supply on");
+  host_test_check(wch_supply_on == FALSE, "supply off after the print");
+
+  return host_test_result();
+}
+
+/**
+ * @brief Wake button press, requests the set time prompt
+ */
+static void wch_set_press(void)
+{
+  host_gpio_input(WAKE_BUTTON_PORT, WAKE_BUTTON_PIN, FALSE);
+  host_alarm_set(WCH_ALARM_SET, WCH_SET_RELEASE_NS, wch_set_release);
+}
+
+/**
+ * @brief Wake button release
+ */
+static void wch_set_release(void)
+{
+  host_gpio_input(WAKE_BUTTON_PORT, WAKE_BUTTON_PIN, TRUE);
+}
+
+/**
+ * @brief Output event hook, answers the set time prompt and records the digits lit on each tube and checks them
+ * against the supply
+ */
+static void wch_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  uint8_t t;
+  uint8_t d;
+  uint8_t driven;
+  uint16_t lit;
+
+  /* The receiver is running once the prompt goes out, answered after its last byte, the terminator tiny_print()
+     sends (USART1 DR is shared with the transmitter in the model) */
+  if ((event == HOST_TRACE_UART_TX) && (value == '\0') && !wch_time_sent &&
+      (strcmp(host_uart_tx(), WCH_SET_PROMPT) == 0))
+  {
+    host_uart_rx_push(WCH_SET_TIME, (uint16_t)strlen(WCH_SET_TIME));
+    wch_time_sent = TRUE;
+  }
+
+  if (event != HOST_TRACE_GPIO)
+  {
+    return;
+  }
+
+  /* Supply enable is active low */
+  wch_supply_on = host_test_high(NIXIE_SUPPLY_PORT, NIXIE_SUPPLY_PIN) ? FALSE : TRUE;
+
+  for (t=0; t<HOST_TEST_NUM_TUBES; t++)
+  {
+    lit = host_test_lit(t);
+    wch_lit[t] |= lit;
+    driven = 0;
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      driven += (uint8_t)((lit >> d) & 1U);
+    }
+    wch_overlaps += (driven > 1) ? 1 : 0;
+    wch_unpowered += ((driven != 0) && !wch_supply_on) ? 1 : 0;
+  }
+}
@@ -0,0 +1,563 @@
+/**
+ * @file host_replay.c
+ * @brief Event trace replay, feeds timestamped input events to the firmware and reports input-to-display latency
+ *
+ * Usage: host_replay <input.trace> [-o output.trace] [--expect-dropped N] [--max-latency-ms N]
+ *
+ * Input trace, one event per line (times in milliseconds from reset, '#' starts a comment):
+ *
+ *   <ms> press <print|sleep|off>    Power switch/button pin pulled low (EXTI0/1/2 on the breakout board)
+ *   <ms> release <print|sleep|off>  Pin released (pull-up)
+ *   <ms> rtc_tick [seconds]         External RTC advances (default 1 s)
+ *   <ms> uart <text>                Text received from the host PC
+ *   <ms> vdd <mv>                   Supply voltage change
+ *   <ms> end                        End of replay
+ *
+ * Output trace, one event per line (times in microseconds): input events as read, "psu on|off",
+ * "digit A <n> on|off", "uart 0xNN" and "irq <vector>". A "print" press is served by the first digit
+ * lit after the next HV supply turn on, it glows once the supply has been on for NIXIE_PSU_STARTUP_US. Presses
+ * with no display before the following press (or the end of the trace) are counted as dropped.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "nixie.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define REPLAY_MAX_EVENTS 1024
+#define REPLAY_MAX_TEXT 64
+#define REPLAY_LINE_SIZE 128
+
+#define REPLAY_NS_PER_MS 1000000ULL
+#define REPLAY_NS_PER_US 1000ULL
+
+/* Supply voltage at reset */
+#define REPLAY_VDD_MV 3000
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Input event types
+ */
+typedef enum
+{
+  REPLAY_PRESS,
+
+  REPLAY_RELEASE,
+
+  REPLAY_RTC_TICK,
+
+  REPLAY_UART,
+
+  REPLAY_VDD,
+
+  REPLAY_END
+
+} replay_type_t;
+
+/**
+ * @brief Input event
+ */
+typedef struct
+{
+  unsigned long long time_ns;
+
+  replay_type_t type;
+
+  uint16_t arg; /* Switch pin, seconds or millivolts */
+
+  char text[REPLAY_MAX_TEXT];
+
+} replay_event_t;
+
+/**
+ * @brief Display output pin
+ */
+typedef struct
+{
+  GPIO_TypeDef* port;
+
+  uint8_t pin;
+
+} replay_pin_t;
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Ports in trace order (index used by HOST_TRACE_GPIO) */
+static GPIO_TypeDef* const replay_ports[HOST_NUM_GPIO_PORTS] = {
+  GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF
+};
+
+/* Tube A cathodes, from the board definition */
+static const replay_pin_t replay_digits[NUM_NIXIE_DIGITS] = {
+  {TUBE_A_PORT_0, DIGIT_A_0}, {TUBE_A_PORT_1, DIGIT_A_1}, {TUBE_A_PORT_2, DIGIT_A_2}, {TUBE_A_PORT_3, DIGIT_A_3},
+  {TUBE_A_PORT_4, DIGIT_A_4}, {TUBE_A_PORT_5, DIGIT_A_5}, {TUBE_A_PORT_6, DIGIT_A_6}, {TUBE_A_PORT_7, DIGIT_A_7},
+  {TUBE_A_PORT_8, DIGIT_A_8}, {TUBE_A_PORT_9, DIGIT_A_9}
+};
+
+static replay_event_t replay_events[REPLAY_MAX_EVENTS];
+static uint16_t replay_num_events;
+static uint16_t replay_next;
+
+static host_ds1307_t replay_rtc;
+static FILE* replay_out;
+static uint8_t replay_levels[HOST_NUM_GPIO_PORTS];
+
+/* Latency tracking */
+static bool replay_pending; /* Print press waiting for a display */
+static unsigned long long replay_press_ns;
+static bool replay_psu_on;
+static unsigned long long replay_psu_on_ns;
+static bool replay_display_started; /* First digit of the current HV supply cycle seen */
+static unsigned long long replay_latency_ns[REPLAY_MAX_EVENTS];
+static uint16_t replay_served;
+static uint16_t replay_presses;
+static uint16_t replay_dropped;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static bool replay_load(const char* path);
+static bool replay_parse_switch(const char* name, uint16_t* pin);
+static void replay_alarm(void);
+static void replay_apply(const replay_event_t* ev);
+static void replay_trace(host_trace_t event, uint8_t index, uint8_t value);
+static void replay_gpio(uint8_t port, uint8_t changed, uint8_t levels);
+static void replay_log(const char* fmt, ...);
+static void replay_sort(unsigned long long* values, uint16_t count);
+static void replay_summary(void);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(int argc, char** argv)
+{
+  int i;
+  long expect_dropped = -1;
+  unsigned long long max_latency_ns = 0;
+  host_run_result_t result;
+  int status = 0;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s <input.trace> [-o output.trace] [--expect-dropped N] [--max-latency-ms N]\n", argv[0]);
+    return 2;
+  }
+
+  for (i=2; i<argc; i++)
+  {
+    if ((strcmp(argv[i], "-o") == 0) && ((i + 1) < argc))
+    {
+      replay_out = fopen(argv[++i], "w");
+      if (replay_out == NULL)
+      {
+        perror(argv[i]);
+        return 2;
+      }
+    }
+    else if ((strcmp(argv[i], "--expect-dropped") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%ld", &expect_dropped);
+    }
+    else if ((strcmp(argv[i], "--max-latency-ms") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%llu", &max_latency_ns);
+      max_latency_ns *= REPLAY_NS_PER_MS;
+    }
+    else
+    {
+      fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  if (replay_load(argv[1]) == FALSE)
+  {
+    return 2;
+  }
+
+  host_emu_reset();
+  host_vdd_set_mv(REPLAY_VDD_MV);
+  host_ds1307_init(&replay_rtc);
+  host_i2c_attach(&replay_rtc.slave);
+
+  /* Switch inputs idle high (pull-ups) */
+  host_gpio_input(POWER_SWITCH_PORT, (uint8_t)(POWER_SWITCH_PIN_0 | POWER_SWITCH_PIN_1 | POWER_SWITCH_PIN_2), TRUE);
+
+  host_trace_set_hook(replay_trace);
+  if (replay_num_events != 0)
+  {
+    host_alarm_set(HOST_ALARM_STIMULUS, replay_events[0].time_ns, replay_alarm);
+  }
+
+  result = host_emu_run(fw_main, NULL);
+  if (result == HOST_RUN_FAULT)
+  {
+    fprintf(stderr, "firmware fault at %llu us: %s\n", host_time_ns() / REPLAY_NS_PER_US, host_emu_fault_msg());
+    status = 1;
+  }
+  else if (replay_next < replay_num_events)
+  {
+    fprintf(stderr, "firmware stopped with %u events left\n", (unsigned)(replay_num_events - replay_next));
+    status = 1;
+  }
+
+  if (replay_pending)
+  {
+    replay_dropped++;
+  }
+  replay_summary();
+
+  if ((expect_dropped >= 0) && (replay_dropped != expect_dropped))
+  {
+    fprintf(stderr, "expected %ld dropped presses, got %u\n", expect_dropped, replay_dropped);
+    status = 1;
+  }
+  if ((max_latency_ns != 0) && (replay_served != 0) && (replay_latency_ns[replay_served - 1] > max_latency_ns))
+  {
+    fprintf(stderr, "latency over %llu ms\n", max_latency_ns / REPLAY_NS_PER_MS);
+    status = 1;
+  }
+
+  if (replay_out != NULL)
+  {
+    fclose(replay_out);
+  }
+
+  return status;
+}
+
+/**
+ * @brief Read an input trace
+ * @param path: Trace file
+ * @retval TRUE on success
+ */
+static bool replay_load(const char* path)
+{
+  FILE* f = fopen(path, "r");
+  char line[REPLAY_LINE_SIZE];
+  char name[REPLAY_LINE_SIZE];
+  double ms;
+  int offset;
+  unsigned line_no = 0;
+  replay_event_t* ev;
+  unsigned long long last_ns = 0;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return FALSE;
+  }
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    line_no++;
+    line[strcspn(line, "\r\n#")] = '\0';
+    if (sscanf(line, "%lf %127s %n", &ms, name, &offset) < 2)
+    {
+      continue;
+    }
+
+    if (replay_num_events >= REPLAY_MAX_EVENTS)
+    {
+      fprintf(stderr, "%s:%u: too many events\n", path, line_no);
+      fclose(f);
+      return FALSE;
+    }
+
+    ev = &replay_events[replay_num_events];
+    memset(ev, 0, sizeof(*ev));
+    ev->time_ns = (unsigned long long)(ms * (double)REPLAY_NS_PER_MS);
+
+    if ((strcmp(name, "press") == 0) || (strcmp(name, "release") == 0))
+    {
+      ev->type = (name[0] == 'p') ? REPLAY_PRESS : REPLAY_RELEASE;
+      if ((sscanf(line + offset, "%127s", name) != 1) || (replay_parse_switch(name, &ev->arg) == FALSE))
+      {
+        fprintf(stderr, "%s:%u: expected print, sleep or off\n", path, line_no);
+        fclose(f);
+        return FALSE;
+      }
+      strncpy(ev->text, name, REPLAY_MAX_TEXT - 1);
+    }
+    else if (strcmp(name, "rtc_tick") == 0)
+    {
+      ev->type = REPLAY_RTC_TICK;
+      if (sscanf(line + offset, "%hu", &ev->arg) != 1)
+      {
+        ev->arg = 1;
+      }
+    }
+    else if (strcmp(name, "uart") == 0)
+    {
+      ev->type = REPLAY_UART;
+      strncpy(ev->text, line + offset, REPLAY_MAX_TEXT - 1);
+    }
+    else if (strcmp(name, "vdd") == 0)
+    {
+      ev->type = REPLAY_VDD;
+      sscanf(line + offset, "%hu", &ev->arg);
+    }
+    else if (strcmp(name, "end") == 0)
+    {
+      ev->type = REPLAY_END;
+    }
+    else
+    {
+      fprintf(stderr, "%s:%u: unknown event %s\n", path, line_no, name);
+      fclose(f);
+      return FALSE;
+    }
+
+    if (ev->time_ns < last_ns)
+    {
+      fprintf(stderr, "%s:%u: events out of order\n", path, line_no);
+      fclose(f);
+      return FALSE;
+    }
+    last_ns = ev->time_ns;
+    replay_num_events++;
+  }
+
+  fclose(f);
+  return TRUE;
+}
+
+/**
+ * @brief Map a switch name to its pin
+ */
+static bool replay_parse_switch(const char* name, uint16_t* pin)
+{
+  if (strcmp(name, "print") == 0)
+  {
+    *pin = POWER_SWITCH_PIN_0;
+  }
+  else if (strcmp(name, "sleep") == 0)
+  {
+    *pin = POWER_SWITCH_PIN_1;
+  }
+  else if (strcmp(name, "off") == 0)
+  {
+    *pin = POWER_SWITCH_PIN_2;
+  }
+  else
+  {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * @brief Stimulus alarm, applies every event that is due and schedules the next one
+ */
+static void replay_alarm(void)
+{
+  while ((replay_next < replay_num_events) && (replay_events[replay_next].time_ns <= host_time_ns()))
+  {
+    replay_apply(&replay_events[replay_next++]);
+  }
+
+  if (replay_next < replay_num_events)
+  {
+    host_alarm_set(HOST_ALARM_STIMULUS, replay_events[replay_next].time_ns, replay_alarm);
+  }
+}
+
+/**
+ * @brief Apply one input event
+ */
+static void replay_apply(const replay_event_t* ev)
+{
+  switch (ev->type)
+  {
+    case REPLAY_PRESS:
+      replay_log("in press %s", ev->text);
+      if (ev->arg == POWER_SWITCH_PIN_0)
+      {
+        replay_presses++;
+        if (replay_pending)
+        {
+          replay_dropped++;
+        }
+        replay_pending = TRUE;
+        replay_press_ns = host_time_ns();
+      }
+      host_gpio_input(POWER_SWITCH_PORT, (uint8_t)ev->arg, FALSE);
+      break;
+    case REPLAY_RELEASE:
+      replay_log("in release %s", ev->text);
+      host_gpio_input(POWER_SWITCH_PORT, (uint8_t)ev->arg, TRUE);
+      break;
+    case REPLAY_RTC_TICK:
+      replay_log("in rtc_tick %u", ev->arg);
+      host_ds1307_tick_ms(&replay_rtc, (uint32_t)ev->arg * 1000UL);
+      break;
+    case REPLAY_UART:
+      replay_log("in uart %s", ev->text);
+      host_uart_rx_push(ev->text, (uint16_t)strlen(ev->text));
+      break;
+    case REPLAY_VDD:
+      replay_log("in vdd %u", ev->arg);
+      host_vdd_set_mv(ev->arg);
+      break;
+    case REPLAY_END:
+    default:
+      replay_log("end");
+      host_emu_stop();
+      break;
+  }
+}
+
+/**
+ * @brief Output event hook
+ */
+static void replay_trace(host_trace_t event, uint8_t index, uint8_t value)
+{
+  switch (event)
+  {
+    case HOST_TRACE_GPIO:
+      replay_gpio(index, (uint8_t)(replay_levels[index] ^ value), value);
+      replay_levels[index] = value;
+      break;
+    case HOST_TRACE_UART_TX:
+      replay_log("uart 0x%02X", value);
+      break;
+    case HOST_TRACE_SPI_TX:
+      replay_log("spi 0x%02X", value);
+      break;
+    case HOST_TRACE_IRQ:
+      replay_log("irq %u", index);
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Decode a port change into supply and digit events
+ */
+static void replay_gpio(uint8_t port, uint8_t changed, uint8_t levels)
+{
+  uint8_t i;
+  bool on;
+  unsigned long long glow_ns;
+
+  /* HV supply enable is active low */
+  if ((replay_ports[port] == NIXIE_SUPPLY_PORT) && ((changed & NIXIE_SUPPLY_PIN) != 0))
+  {
+    replay_psu_on = ((levels & NIXIE_SUPPLY_PIN) == 0) ? TRUE : FALSE;
+    replay_psu_on_ns = host_time_ns();
+    replay_display_started = FALSE;
+    replay_log(replay_psu_on ? "psu on" : "psu off");
+  }
+
+  for (i=0; i<NUM_NIXIE_DIGITS; i++)
+  {
+    if ((replay_ports[port] != replay_digits[i].port) || ((changed & replay_digits[i].pin) == 0))
+    {
+      continue;
+    }
+
+    on = ((levels & replay_digits[i].pin) != 0) ? TRUE : FALSE;
+    replay_log("digit A %u %s", i, on ? "on" : "off");
+
+    if (on && replay_psu_on && (replay_display_started == FALSE))
+    {
+      replay_display_started = TRUE;
+      if (replay_pending)
+      {
+        /* No glow before the supply is up */
+        glow_ns = replay_psu_on_ns + (NIXIE_PSU_STARTUP_US * REPLAY_NS_PER_US);
+        glow_ns = (host_time_ns() > glow_ns) ? host_time_ns() : glow_ns;
+        replay_latency_ns[replay_served++] = glow_ns - replay_press_ns;
+        replay_pending = FALSE;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Write a line to the output trace, prefixed with the current time
+ */
+static void replay_log(const char* fmt, ...)
+{
+  va_list args;
+
+  if (replay_out == NULL)
+  {
+    return;
+  }
+
+  fprintf(replay_out, "%llu ", host_time_ns() / REPLAY_NS_PER_US);
+  va_start(args, fmt);
+  vfprintf(replay_out, fmt, args);
+  va_end(args);
+  fputc('\n', replay_out);
+}
+
+/**
+ * @brief Sort ascending (insertion sort, one entry per press)
+ */
+static void replay_sort(unsigned long long* values, uint16_t count)
+{
+  uint16_t i;
+  uint16_t j;
+  unsigned long long v;
+
+  for (i=1; i<count; i++)
+  {
+    v = values[i];
+    for (j=i; (j > 0) && (values[j - 1] > v); j--)
+    {
+      values[j] = values[j - 1];
+    }
+    values[j] = v;
+  }
+}
+
+/**
+ * @brief Print the latency distribution, latencies are sorted afterwards (last entry is the maximum)
+ */
+static void replay_summary(void)
+{
+  unsigned long long total = 0;
+  uint16_t i;
+
+  replay_sort(replay_latency_ns, replay_served);
+
+  printf("presses\tserved\tdropped\tmin_us\tp50_us\tp95_us\tmax_us\tmean_us\n");
+  if (replay_served == 0)
+  {
+    printf("%u\t0\t%u\t-\t-\t-\t-\t-\n", replay_presses, replay_dropped);
+    return;
+  }
+
+  for (i=0; i<replay_served; i++)
+  {
+    total += replay_latency_ns[i];
+  }
+
+  printf("%u\t%u\t%u\t%llu\t%llu\t%llu\t%llu\t%llu\n", replay_presses, replay_served, replay_dropped,
+         replay_latency_ns[0] / REPLAY_NS_PER_US,
+         replay_latency_ns[(replay_served - 1) / 2] / REPLAY_NS_PER_US,
+         replay_latency_ns[((replay_served * 95) - 1) / 100] / REPLAY_NS_PER_US,
+         replay_latency_ns[replay_served - 1] / REPLAY_NS_PER_US,
+         (total / replay_served) / REPLAY_NS_PER_US);
+}
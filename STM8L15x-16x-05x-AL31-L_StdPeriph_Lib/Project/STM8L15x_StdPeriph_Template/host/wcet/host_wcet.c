@@ -0,0 +1,283 @@
+/**
+ * @file host_wcet.c
+ * @brief Interrupt handler execution time report, drives every interrupt source of the breakout board firmware
+ * and prints per handler service time from the emulator next to the firmware's own TIM1 measurement
+ *
+ * Usage: host_wcet [rounds] [--max-us N]
+ *
+ * Each round presses and releases the three switches (print, off, sleep), drops the supply through the PVD
+ * threshold and back, then raises every remaining vector once. Emulator times run from handler entry to
+ * return (coarse cost model, see host_emu.c), TIM1 times are what isr_wcet records on the target between
+ * ISR_WCET_ENTER() and ISR_WCET_EXIT(). Fails if a vector was never serviced, a handler exceeds the budget
+ * or TIM1 reports more than the emulator measured.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "host_emu.h"
+#include "host_ds1307.h"
+#include "hardwaredefs.h"
+#include "isr_wcet.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#define WCET_ROUNDS 4
+
+#define WCET_NS_PER_US 1000ULL
+#define WCET_NS_PER_MS 1000000ULL
+
+/* Time between steps, a print request plays HH:MM for about 1.3 s */
+#define WCET_STEP_NS (100ULL * WCET_NS_PER_MS)
+#define WCET_DISPLAY_NS (2000ULL * WCET_NS_PER_MS)
+
+/* Supply levels either side of the PVD threshold */
+#define WCET_VDD_MV 3000
+#define WCET_VDD_LOW_MV 2000
+
+/* Default budget per handler */
+#define WCET_MAX_US 100
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Stimulus steps of one round
+ */
+typedef enum
+{
+  WCET_PRESS_PRINT,
+
+  WCET_RELEASE_PRINT,
+
+  WCET_PRESS_OFF,
+
+  WCET_RELEASE_OFF,
+
+  WCET_PRESS_SLEEP,
+
+  WCET_RELEASE_SLEEP,
+
+  WCET_VDD_LOW,
+
+  WCET_VDD_HIGH,
+
+  WCET_RAISE_ALL,
+
+  WCET_NUM_STEPS
+
+} wcet_step_t;
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Handler names, index is the vector number */
+static const char* const wcet_names[HOST_NUM_VECTORS] = {
+  "-", "FLASH", "DMA1_CHANNEL0_1", "DMA1_CHANNEL2_3", "RTC_CSSLSE", "EXTIE_F_PVD", "EXTIB_G", "EXTID_H",
+  "EXTI0", "EXTI1", "EXTI2", "EXTI3", "EXTI4", "EXTI5", "EXTI6", "EXTI7", "LCD_AES", "SWITCH_CSS_BREAK_DAC",
+  "ADC1_COMP", "TIM2_UPD_OVF_TRG_BRK_USART2_TX", "TIM2_CC_USART2_RX", "TIM3_UPD_OVF_TRG_BRK_USART3_TX",
+  "TIM3_CC_USART3_RX", "TIM1_UPD_OVF_TRG_COM", "TIM1_CC", "TIM4_UPD_OVF_TRG", "SPI1",
+  "USART1_TX_TIM5_UPD_OVF_TRG_BRK", "USART1_RX_TIM5_CC", "I2C1_SPI2"
+};
+
+/* Vectors measured by the firmware itself */
+static const uint8_t wcet_tim1_vectors[ISR_WCET_NUM_HANDLERS] = {
+  HOST_VECTOR_RTC, HOST_VECTOR_PVD, HOST_VECTOR_EXTI0, HOST_VECTOR_EXTI0 + 1, HOST_VECTOR_EXTI0 + 2, HOST_VECTOR_TIM2_UPDATE,
+  HOST_VECTOR_TIM1_UPDATE, HOST_VECTOR_DMA1_CHANNEL0_1, HOST_VECTOR_DMA1_CHANNEL2_3
+};
+
+static uint16_t wcet_rounds = WCET_ROUNDS;
+static uint16_t wcet_round;
+static uint8_t wcet_step;
+static host_ds1307_t wcet_rtc;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void wcet_alarm(void);
+static int wcet_report(unsigned long long max_ns);
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void fw_main(void);
+
+int main(int argc, char** argv)
+{
+  int i;
+  unsigned long long max_us = WCET_MAX_US;
+  host_run_result_t result;
+
+  for (i=1; i<argc; i++)
+  {
+    if ((strcmp(argv[i], "--max-us") == 0) && ((i + 1) < argc))
+    {
+      sscanf(argv[++i], "%llu", &max_us);
+    }
+    else if ((sscanf(argv[i], "%hu", &wcet_rounds) != 1) || (wcet_rounds == 0))
+    {
+      fprintf(stderr, "usage: %s [rounds] [--max-us N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  host_emu_reset();
+  host_vdd_set_mv(WCET_VDD_MV);
+  host_ds1307_init(&wcet_rtc);
+  host_i2c_attach(&wcet_rtc.slave);
+
+  /* Switch inputs idle high (pull-ups) */
+  host_gpio_input(POWER_SWITCH_PORT, (uint8_t)(POWER_SWITCH_PIN_0 | POWER_SWITCH_PIN_1 | POWER_SWITCH_PIN_2), TRUE);
+
+  host_alarm_set(HOST_ALARM_STIMULUS, WCET_STEP_NS, wcet_alarm);
+
+  result = host_emu_run(fw_main, NULL);
+  if (result == HOST_RUN_FAULT)
+  {
+    fprintf(stderr, "firmware fault at %llu us: %s\n", host_time_ns() / WCET_NS_PER_US, host_emu_fault_msg());
+    return 1;
+  }
+  if (wcet_round < wcet_rounds)
+  {
+    fprintf(stderr, "firmware stopped in round %u\n", wcet_round);
+    return 1;
+  }
+
+  return wcet_report(max_us * WCET_NS_PER_US);
+}
+
+/**
+ * @brief Stimulus alarm, applies one step and schedules the next
+ */
+static void wcet_alarm(void)
+{
+  uint8_t vector;
+
+  switch (wcet_step)
+  {
+    case WCET_PRESS_PRINT:
+    case WCET_RELEASE_PRINT:
+      host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_0, (wcet_step == WCET_RELEASE_PRINT) ? TRUE : FALSE);
+      break;
+    case WCET_PRESS_OFF:
+    case WCET_RELEASE_OFF:
+      host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_2, (wcet_step == WCET_RELEASE_OFF) ? TRUE : FALSE);
+      break;
+    case WCET_PRESS_SLEEP:
+    case WCET_RELEASE_SLEEP:
+      host_gpio_input(POWER_SWITCH_PORT, POWER_SWITCH_PIN_1, (wcet_step == WCET_RELEASE_SLEEP) ? TRUE : FALSE);
+      break;
+    case WCET_VDD_LOW:
+    case WCET_VDD_HIGH:
+      host_vdd_set_mv((wcet_step == WCET_VDD_LOW) ? WCET_VDD_LOW_MV : WCET_VDD_MV);
+      break;
+    case WCET_RAISE_ALL:
+    default:
+      /* Sources the firmware never enables, their handlers still have to be safe to enter */
+      for (vector=1; vector<HOST_NUM_VECTORS; vector++)
+      {
+        host_irq_raise(vector);
+      }
+      break;
+  }
+
+  wcet_step++;
+  if (wcet_step == WCET_NUM_STEPS)
+  {
+    wcet_step = 0;
+    wcet_round++;
+  }
+
+  if (wcet_round == wcet_rounds)
+  {
+    host_emu_stop();
+    return;
+  }
+
+  /* Let the print request finish before the next switch */
+  host_alarm_set(HOST_ALARM_STIMULUS, host_time_ns() + ((wcet_step == WCET_RELEASE_PRINT) ? WCET_DISPLAY_NS : WCET_STEP_NS),
+                 wcet_alarm);
+}
+
+/**
+ * @brief Print the per handler table and check the results
+ * @param max_ns: Budget per handler
+ * @retval Process exit status
+ */
+static int wcet_report(unsigned long long max_ns)
+{
+  uint8_t vector;
+  uint8_t bin;
+  uint8_t id;
+  const host_irq_stats_t* stats;
+  const profile_stats_t* tim1;
+  unsigned long long tim1_max_ns;
+  int status = 0;
+
+  printf("vector\thandler\tcount\tmax_us\tmean_us\tmax_cycles\ttim1_max_us\ttim1_count");
+  for (bin=0; bin<HOST_IRQ_HIST_BINS; bin++)
+  {
+    printf("\tlt_%uus", 1U << bin);
+  }
+  printf("\n");
+
+  for (vector=1; vector<HOST_NUM_VECTORS; vector++)
+  {
+    stats = host_irq_stats(vector);
+    printf("%u\t%s\t%lu", vector, wcet_names[vector], (unsigned long)stats->count);
+
+    if (stats->count == 0)
+    {
+      for (bin=0; bin<(5 + HOST_IRQ_HIST_BINS); bin++)
+      {
+        printf("\t-");
+      }
+      printf("\n");
+      fprintf(stderr, "%s never serviced\n", wcet_names[vector]);
+      status = 1;
+      continue;
+    }
+
+    printf("\t%.3f\t%.3f\t%llu", (double)stats->max_ns / WCET_NS_PER_US,
+           ((double)stats->total_ns / stats->count) / WCET_NS_PER_US, stats->max_cycles);
+
+    for (id=0; (id < ISR_WCET_NUM_HANDLERS) && (wcet_tim1_vectors[id] != vector); id++)
+    {
+    }
+    tim1 = (id < ISR_WCET_NUM_HANDLERS) ? isr_wcet_get((isr_wcet_id_t)id) : NULL;
+    if ((tim1 != NULL) && (tim1->count != 0))
+    {
+      tim1_max_ns = (tim1->max * WCET_NS_PER_US) / ISR_WCET_TICKS_PER_US;
+      printf("\t%.3f\t%u", (double)tim1_max_ns / WCET_NS_PER_US, tim1->count);
+      if (tim1_max_ns > stats->max_ns)
+      {
+        fprintf(stderr, "%s TIM1 max over emulator max\n", wcet_names[vector]);
+        status = 1;
+      }
+    }
+    else
+    {
+      printf("\t-\t-");
+    }
+
+    for (bin=0; bin<HOST_IRQ_HIST_BINS; bin++)
+    {
+      printf("\t%lu", (unsigned long)stats->hist[bin]);
+    }
+    printf("\n");
+
+    if (stats->max_ns > max_ns)
+    {
+      fprintf(stderr, "%s over budget (%llu us)\n", wcet_names[vector], max_ns / WCET_NS_PER_US);
+      status = 1;
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file isr_wcet.c
+ * @brief Interrupt handler execution time measurement, TIM1 free-running counter captured at handler entry and exit
+ *
+ * Only the time between the two captures is measured, interrupt entry latency and the context save/restore
+ * around the handler body are not. Longest and count are kept per handler (in the profile statistics table, after
+ * the regions) and printed to the host when a new worst case is seen.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <string.h>
+
+#include "isr_wcet.h"
+#include "uart.h"
+
+#ifdef STM8_BASEBAND
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+static const char* const isr_wcet_names[ISR_WCET_NUM_HANDLERS] = {
+  "RTC", "PVD", "EXTI0", "EXTI1", "EXTI2", "TIM2", "TIM1", "DMA1", "DMA1_2_3"
+};
+
+/* Handlers whose worst case grew since the last report, bit per handler */
+static uint16_t isr_wcet_grown = 0;
+
+/* Ticks taken by the captures themselves, subtracted from every measurement */
+static uint16_t isr_wcet_overhead = 0;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void isr_wcet_print_val(uint16_t val);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/* Handler statistics, slots after the profiled regions */
+#define ISR_WCET_STATS(id) (&profile_stats[PROFILE_NUM_REGIONS + (id)])
+
+/* The shared table holds a slot per handler */
+typedef char isr_wcet_slots_check[(ISR_WCET_NUM_HANDLERS == PROFILE_NUM_HANDLERS) ? 1 : -1];
+
+/**
+ * @brief Calibrate the capture overhead, call after profile_init() (TIM1 running) and before interrupts are enabled
+*/
+void isr_wcet_init(void)
+{
+  uint16_t start;
+  uint16_t end;
+
+  /* Back to back captures */
+  ISR_WCET_READ(start);
+  ISR_WCET_READ(end);
+  isr_wcet_overhead = (uint16_t)(end - start);
+}
+
+/* Called from the handlers executed from RAM, copied to RAM with them */
+#if defined(_COSMIC_) && defined(RAM_EXECUTION)
+#pragma section (FLASH_CODE)
+#endif /* _COSMIC_ && RAM_EXECUTION */
+
+/**
+ * @brief Add one handler execution to its statistics, called by ISR_WCET_EXIT()
+ * @param id: Handler
+ * @param bit: Handler bit (1 << id)
+ * @param ticks: TIM1 ticks between entry and exit capture
+ * @note Runs from RAM (RAM_EXECUTION), must not call into flash
+*/
+void isr_wcet_record(isr_wcet_id_t id, uint16_t bit, uint16_t ticks)
+{
+  profile_stats_t* stats = ISR_WCET_STATS(id);
+
+  ticks = (ticks > isr_wcet_overhead) ? (uint16_t)(ticks - isr_wcet_overhead) : 0;
+
+  if (ticks > stats->max)
+  {
+    stats->max = ticks;
+    isr_wcet_grown |= bit;
+  }
+  if (stats->count != 0xFFFF)
+  {
+    stats->count++;
+  }
+}
+
+#if defined(_COSMIC_) && defined(RAM_EXECUTION)
+#pragma section ()
+#endif /* _COSMIC_ && RAM_EXECUTION */
+
+/**
+ * @brief Get handler statistics
+ * @param id: Handler
+ * @retval Statistics since boot, in TIM1 ticks
+*/
+const profile_stats_t* isr_wcet_get(isr_wcet_id_t id)
+{
+  return ISR_WCET_STATS(id);
+}
+
+/**
+ * @brief Print every handler whose worst case grew since the last report to host PC
+ * @note Format: "ISR <name> max (us): MMMM count CCCC"
+*/
+void isr_wcet_report(void)
+{
+  uint8_t i;
+  uint16_t grown;
+  const char header[] = "ISR ";
+  const char times[] = " max (us): ";
+  const char count[] = " count ";
+  const char newline[] = "\r\n";
+  const profile_stats_t* stats;
+
+  /* Taken with interrupts masked, a handler may grow its worst case while the report prints */
+  disableInterrupts();
+  grown = isr_wcet_grown;
+  isr_wcet_grown = 0;
+  enableInterrupts();
+
+  for (i=0; i<ISR_WCET_NUM_HANDLERS; i++)
+  {
+    if ((grown & (uint16_t)(1U << i)) == 0)
+    {
+      continue;
+    }
+    stats = ISR_WCET_STATS(i);
+
+    tiny_print(header, ARR_SIZE(header));
+    tiny_print(isr_wcet_names[i], (int)(strlen(isr_wcet_names[i]) + 1));
+    tiny_print(times, ARR_SIZE(times));
+    isr_wcet_print_val((uint16_t)(stats->max / ISR_WCET_TICKS_PER_US));
+    tiny_print(count, ARR_SIZE(count));
+    isr_wcet_print_val(stats->count);
+    tiny_print(newline, ARR_SIZE(newline));
+  }
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Print a value as 4 decimal digits
+ * @param val: Value (saturates at 9999)
+*/
+static void isr_wcet_print_val(uint16_t val)
+{
+  char out[ISR_WCET_PRINT_SIZE];
+
+  if (val > 9999)
+  {
+    val = 9999;
+  }
+
+  out[0] = (char)(((val / 1000) % 10) + 48);
+  out[1] = (char)(((val / 100) % 10) + 48);
+  out[2] = (char)(((val / 10) % 10) + 48);
+  out[3] = (char)((val % 10) + 48);
+  out[4] = '\0';
+
+  tiny_print(out, ISR_WCET_PRINT_SIZE);
+}
+#endif /* STM8_BASEBAND */
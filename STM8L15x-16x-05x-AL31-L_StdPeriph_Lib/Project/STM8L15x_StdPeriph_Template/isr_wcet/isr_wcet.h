@@ -0,0 +1,82 @@
+/**
+ * @file isr_wcet.h
+ * @brief Function prototypes, defines and types for interrupt handler execution time measurement (baseband board only)
+ */
+
+#ifndef ISR_WCET_H_
+#define ISR_WCET_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "profile.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Low 16 bits of the profile timestamp (TIM1), range is 65535 ticks (~32ms) */
+#define ISR_WCET_TICKS_PER_US PROFILE_TICKS_PER_US
+
+/* Output data string buffer size (4 digits + NULL) */
+#define ISR_WCET_PRINT_SIZE 5
+
+/**
+ * @brief Handler entry/exit timestamps, first statement of the handler and last statement before it returns
+ * @note Direct register reads (high byte first latches the low byte) and isr_wcet_record() runs from RAM
+ * (RAM_EXECUTION), handlers running from RAM stay there. The handler bit is a constant, a variable shift could be
+ * a runtime library call.
+ */
+#ifdef STM8_BASEBAND
+#define ISR_WCET_READ(t) do { (t) = (uint16_t)((uint16_t)TIM1->CNTRH << 8); (t) |= TIM1->CNTRL; } while (0)
+#define ISR_WCET_ENTER() uint16_t isr_wcet_start; ISR_WCET_READ(isr_wcet_start)
+#define ISR_WCET_EXIT(id) do { uint16_t isr_wcet_end; ISR_WCET_READ(isr_wcet_end); \
+                               isr_wcet_record((id), (uint16_t)(1U << (id)), \
+                                               (uint16_t)(isr_wcet_end - isr_wcet_start)); } while (0)
+#else
+#define ISR_WCET_ENTER()
+#define ISR_WCET_EXIT(id)
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Measured handlers, handlers that only return are not instrumented (see README)
+ */
+typedef enum
+{
+  ISR_WCET_RTC,
+
+  ISR_WCET_PVD,
+
+  ISR_WCET_EXTI0,
+
+  ISR_WCET_EXTI1,
+
+  ISR_WCET_EXTI2,
+
+  ISR_WCET_TIM2,
+
+  ISR_WCET_TIM1,
+
+  ISR_WCET_DMA1,
+
+  ISR_WCET_DMA1_2_3,
+
+  ISR_WCET_NUM_HANDLERS
+
+} isr_wcet_id_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+#ifdef STM8_BASEBAND
+void isr_wcet_init(void);
+void isr_wcet_record(isr_wcet_id_t id, uint16_t bit, uint16_t ticks);
+const profile_stats_t* isr_wcet_get(isr_wcet_id_t id);
+void isr_wcet_report(void);
+#endif /* STM8_BASEBAND */
+
+#endif /* ISR_WCET_H_ */
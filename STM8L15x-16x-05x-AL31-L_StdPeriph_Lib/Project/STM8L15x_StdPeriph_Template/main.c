@@ -11,27 +11,78 @@
 #include "uart.h"
 #include "ext_rtc.h"
 #include "state_machine.h"
+#include "periph_clk.h"
+#include "battery.h"
+#include "boot_time.h"
+#include "stack_mon.h"
+#include "isr_wcet.h"
+#include "profile.h"
+#include "gpio_fast.h"
+#include "cathode.h"
+#include "usage.h"
+
+#if defined(_COSMIC_) && defined(RAM_EXECUTION)
+/* Cosmic runtime, copies the FLASH_CODE segment (wake path and display timer interrupt handlers) to RAM */
+int _fctcpy(char name);
+#endif /* _COSMIC_ && RAM_EXECUTION */
+
+/* Pins owned by main, drivers configure their own pins */
+static const gpio_fast_cfg_t main_pins[] = {
+  /* Blinky LED */
+  {LED_GPIO_PORT, LED_GPIO_PINS, GPIO_Mode_Out_PP_Low_Fast}
+};
+
+#define MAIN_PINS_SIZE (sizeof(main_pins) / sizeof(main_pins[0]))
 
 void main(void)
 {
+  /* Fill unused stack before anything else runs, interrupts are still disabled */
+  stack_mon_paint();
+
+  #if defined(_COSMIC_) && defined(RAM_EXECUTION)
+  /* Must run before interrupts are enabled */
+  _fctcpy('F');
+  #endif /* _COSMIC_ && RAM_EXECUTION */
+
   /* High speed internal clock prescaler: 1 */
   CLK_SYSCLKDivConfig(CLK_SYSCLKDiv_2);
-  /* Initialize mounted on board */
-  GPIO_Init(LED_GPIO_PORT, LED_GPIO_PINS, GPIO_Mode_Out_PP_Low_Fast);
-  GPIO_ExternalPullUpConfig(LED_GPIO_PORT, LED_GPIO_PINS, ENABLE);
+
+  #ifdef STM8_BASEBAND
+  /* Profiling timestamp (boot time counts from here) and handler execution time counter, must run before
+     interrupts are enabled */
+  profile_init();
+  isr_wcet_init();
+  #endif /* STM8_BASEBAND */
+
+  /* Initialize mounted on board (push-pull output, CR1 set) */
+  gpio_fast_init(main_pins, MAIN_PINS_SIZE);
 
   sm_configure_interrupts(&state_machine);
 
-  enableInterrupts();
+  /* Start battery threshold monitoring */
+  battery_init();
 
-  /* Configure UART module */
-  #ifdef STM8_BASEBAND
-  init_uart();
-  ext_rtc_init();
-  #endif /* STM8_BASEBAND */
+  /* Lifetime lit time log, then scheduled wakes for cathode exercise and log writes */
+  usage_init();
+  cathode_init();
+
+  enableInterrupts();
 
   nixie_init_pins(&tube_A, &shared_psu);
+  #ifndef STM8_BASEBAND
+  nixie_init_pins(&tube_B, &shared_psu);
+  #endif /* !STM8_BASEBAND */
 
+  /* Power down flash while waiting, it is woken automatically on interrupt */
+  FLASH_PowerWaitModeConfig(FLASH_Power_IDDQ);
+
+  /* UART and external RTC are initialized on first use, nothing else blocks before the main loop */
+  #ifdef STM8_BASEBAND
+  boot_time_print(boot_time_get());
+  /* All peripheral clocks should be gated once initialization is complete */
+  periph_clk_dump();
+  usage_dump();
+  #endif /* STM8_BASEBAND */
 
   /* Main loop */
   while (1)
@@ -40,8 +91,25 @@ void main(void)
     /* Check new state machine request */
     sm_execute_requests(&state_machine, &state_machine_request);
 
-    /* Enter wait for interrupt mode (turns off CPU to save power) (Page 73 of TRM doc # RM0031) */
-    wfi();
+    #ifdef STM8_BASEBAND
+    /* Report deeper stack use (request handling and the interrupts that queued it), new handler worst cases and
+       profiled regions that ran */
+    stack_mon_report();
+    isr_wcet_report();
+    profile_report();
+    #endif /* STM8_BASEBAND */
+
+    if ((state_machine.current_state == STATE_POWEROFF) ||
+        ((SM_SLEEP_HALT != 0) && (state_machine.current_state == STATE_SLEEP)))
+    {
+      /* Enter HALT mode while powered off (all clocks stopped, only EXTI can wake the device) */
+      halt();
+    }
+    else
+    {
+      /* Enter wait for interrupt mode (turns off CPU to save power) (Page 73 of TRM doc # RM0031) */
+      wfi();
+    }
   }
 }
 
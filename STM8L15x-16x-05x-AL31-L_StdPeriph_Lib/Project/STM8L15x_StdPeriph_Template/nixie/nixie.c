@@ -1,6 +1,11 @@
 /**
  * @file nixie.c
  * @brief Contains implementation for nixie tube driver
+ *
+ * With NIXIE_SPI the cathodes are shift register outputs: a change updates a RAM image of the chain and the whole
+ * image is shifted out by SPI1 fed from DMA1, the transfer complete interrupt latches it. Changes made while a
+ * burst is shifting are sent by one more burst from that interrupt, so the interrupt runs once per burst and a
+ * burst only follows a change.
  */
 
 /******************************************************************************/
@@ -8,37 +13,94 @@
 /******************************************************************************/
 #include "nixie.h"
 #include "hardwaredefs.h"
+#include "gpio_fast.h"
+#ifdef NIXIE_SPI
+#include "periph_clk.h"
+#endif /* NIXIE_SPI */
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+#ifdef NIXIE_SPI
+#define NIXIE_CATHODE_ON(tube, digit) nixie_spi_output((uint8_t)((tube)->first_output + (digit)), TRUE)
+#define NIXIE_CATHODE_OFF(tube, digit) nixie_spi_output((uint8_t)((tube)->first_output + (digit)), FALSE)
+#else
+#define NIXIE_CATHODE_ON(tube, digit) GPIO_FAST_SET((tube)->digits[digit].gpio_port, (tube)->digits[digit].gpio_pin)
+#define NIXIE_CATHODE_OFF(tube, digit) GPIO_FAST_RESET((tube)->digits[digit].gpio_port, (tube)->digits[digit].gpio_pin)
+#endif /* NIXIE_SPI */
 
 /******************************************************************************/
 /*               P R I V A T E  G L O B A L  V A R I A B L E S                */
 /******************************************************************************/
 
-nixie_psu_t shared_psu = {
-    FALSE,
+/* Runtime state, addressing is in the constant objects below */
+static bool shared_psu_enabled = FALSE;
+static uint8_t tube_A_digit = NIXIE_DIGIT_NONE;
+#ifndef STM8_BASEBAND
+static uint8_t tube_B_digit = NIXIE_DIGIT_NONE;
+#endif /* STM8_BASEBAND */
 
-    NIXIE_SUPPLY_PORT,
+#ifdef NIXIE_SPI
+/* Chain image (first byte shifted first, output 0 is the last bit) and the copy being shifted out */
+static uint8_t nixie_spi_image[NIXIE_SPI_BYTES];
+static uint8_t nixie_spi_tx[NIXIE_SPI_BYTES];
+static volatile bool nixie_spi_shifting = FALSE;
+static volatile bool nixie_spi_dirty = FALSE; /* Image changed since the burst shifting started */
+#endif /* NIXIE_SPI */
 
-    NIXIE_SUPPLY_PIN
-};
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+#ifdef NIXIE_SPI
+static void nixie_spi_output(uint8_t output, bool on);
+static void nixie_spi_push(void);
+static void nixie_spi_start(void);
+#endif /* NIXIE_SPI */
 
 /******************************************************************************/
 /*                P U B L I C  G L O B A L  V A R I A B L E S                 */
 /******************************************************************************/
-nixie_tube_t tube_A = {
-    {{DIGIT_OFF, TUBE_A_PORT_0, DIGIT_A_0}, {DIGIT_OFF, TUBE_A_PORT_1, DIGIT_A_1}, {DIGIT_OFF, TUBE_A_PORT_2, DIGIT_A_2},
-     {DIGIT_OFF, TUBE_A_PORT_3, DIGIT_A_3}, {DIGIT_OFF, TUBE_A_PORT_4, DIGIT_A_4}, {DIGIT_OFF, TUBE_A_PORT_5, DIGIT_A_5},
-     {DIGIT_OFF, TUBE_A_PORT_6, DIGIT_A_6}, {DIGIT_OFF, TUBE_A_PORT_7, DIGIT_A_7}, {DIGIT_OFF, TUBE_A_PORT_8, DIGIT_A_8},
-     {DIGIT_OFF, TUBE_A_PORT_9, DIGIT_A_9}}
+const nixie_psu_t shared_psu = {
+    NIXIE_SUPPLY_PORT,
+
+    NIXIE_SUPPLY_PIN,
+
+    &shared_psu_enabled
+};
+
+#ifdef NIXIE_SPI
+const nixie_tube_t tube_A = {
+    0,
+
+    &tube_A_digit
 };
 
 #ifndef STM8_BASEBAND
-nixie_tube_t tube_B = {
-    {{DIGIT_OFF, TUBE_B_PORT_0, DIGIT_B_0}, {DIGIT_OFF, TUBE_B_PORT_1, DIGIT_B_1}, {DIGIT_OFF, TUBE_B_PORT_2, DIGIT_B_2},
-     {DIGIT_OFF, TUBE_B_PORT_3, DIGIT_B_3}, {DIGIT_OFF, TUBE_B_PORT_4, DIGIT_B_4}, {DIGIT_OFF, TUBE_B_PORT_5, DIGIT_B_5},
-     {DIGIT_OFF, TUBE_B_PORT_6, DIGIT_A_6}, {DIGIT_OFF, TUBE_B_PORT_7, DIGIT_A_7}, {DIGIT_OFF, TUBE_B_PORT_8, DIGIT_B_8},
-     {DIGIT_OFF, TUBE_B_PORT_9, DIGIT_B_9}}
+const nixie_tube_t tube_B = {
+    NUM_NIXIE_DIGITS,
+
+    &tube_B_digit
 };
 #endif /* STM8_BASEBAND */
+#else
+const nixie_tube_t tube_A = {
+    {{TUBE_A_PORT_0, DIGIT_A_0}, {TUBE_A_PORT_1, DIGIT_A_1}, {TUBE_A_PORT_2, DIGIT_A_2}, {TUBE_A_PORT_3, DIGIT_A_3},
+     {TUBE_A_PORT_4, DIGIT_A_4}, {TUBE_A_PORT_5, DIGIT_A_5}, {TUBE_A_PORT_6, DIGIT_A_6}, {TUBE_A_PORT_7, DIGIT_A_7},
+     {TUBE_A_PORT_8, DIGIT_A_8}, {TUBE_A_PORT_9, DIGIT_A_9}},
+
+    &tube_A_digit
+};
+
+#ifndef STM8_BASEBAND
+const nixie_tube_t tube_B = {
+    {{TUBE_B_PORT_0, DIGIT_B_0}, {TUBE_B_PORT_1, DIGIT_B_1}, {TUBE_B_PORT_2, DIGIT_B_2}, {TUBE_B_PORT_3, DIGIT_B_3},
+     {TUBE_B_PORT_4, DIGIT_B_4}, {TUBE_B_PORT_5, DIGIT_B_5}, {TUBE_B_PORT_6, DIGIT_B_6}, {TUBE_B_PORT_7, DIGIT_B_7},
+     {TUBE_B_PORT_8, DIGIT_B_8}, {TUBE_B_PORT_9, DIGIT_B_9}},
+
+    &tube_B_digit
+};
+#endif /* STM8_BASEBAND */
+#endif /* NIXIE_SPI */
 
 /******************************************************************************/
 /*                       P U B L I C  F U N C T I O N S                       */
@@ -50,24 +112,59 @@ nixie_tube_t tube_B = {
  * @param tube: Nixie tube to initialize
  * @param psu: Power supply addressing and state information
  */
-void nixie_init_pins(nixie_tube_t* tube, nixie_psu_t* psu)
+void nixie_init_pins(const nixie_tube_t* tube, const nixie_psu_t* psu)
 {
     uint8_t i;
+    #ifdef NIXIE_SPI
+    gpio_fast_cfg_t pins[3];
+    #else
+    gpio_fast_cfg_t pins[NUM_NIXIE_DIGITS + 1];
+    #endif /* NIXIE_SPI */
+
+    /* PSU pin starts high, PSU disabled (if multiple nixies share the same PSU, this should not cause any issues) */
+    pins[0].port = psu->psu_port;
+    pins[0].pins = psu->psu_pin;
+    pins[0].mode = GPIO_Mode_Out_PP_High_Fast;
+    *psu->psu_enabled = FALSE;
+
+    #ifdef NIXIE_SPI
+    /* Clock and data idle low, the latch idles high (outputs follow the registers, which only change while it is
+       low) */
+    pins[1].port = NIXIE_SPI_PORT;
+    pins[1].pins = (uint8_t)(NIXIE_SPI_SCK_PIN | NIXIE_SPI_MOSI_PIN);
+    pins[1].mode = GPIO_Mode_Out_PP_Low_Fast;
+    pins[2].port = NIXIE_SPI_PORT;
+    pins[2].pins = NIXIE_SPI_LATCH_PIN;
+    pins[2].mode = GPIO_Mode_Out_PP_High_Fast;
+    gpio_fast_init(pins, 3);
 
-    /* Initialize PSU pin first (if multiple nixies share the same PSU, this should not cause any issues) */
-    GPIO_Init(psu->psu_port, psu->psu_pin, GPIO_Mode_Out_PP_Low_Fast);
-    /* Disable PSU by default */
-    GPIO_SetBits(psu->psu_port, psu->psu_pin);
-    psu->psu_enabled = FALSE;
+    /* Transmit only master, MSB first, data sampled on the rising clock edge, fSCK = fMASTER / 2 (the configuration
+       is kept while the clock is gated) */
+    periph_clk_acquire(CLK_Peripheral_SPI1);
+    SPI_Init(SPI1, SPI_FirstBit_MSB, SPI_BaudRatePrescaler_2, SPI_Mode_Master, SPI_CPOL_Low, SPI_CPHA_1Edge,
+             SPI_Direction_1Line_Tx, SPI_NSS_Soft, 0x07);
+    periph_clk_release(CLK_Peripheral_SPI1);
 
-    /* Initialize all nixie digit pins */
+    /* Register contents are undefined at power up, every output of the tube is shifted out off */
     for (i=0; i<NUM_NIXIE_DIGITS; i++)
     {
-        GPIO_Init(tube->digits[i].gpio_port, tube->digits[i].gpio_pin, GPIO_Mode_Out_PP_Low_Fast);
-        /* OFF state is voltage high at MOSFET driver gate */
-        GPIO_ResetBits(tube->digits[i].gpio_port, tube->digits[i].gpio_pin);
-        tube->digits[i].curr_state = DIGIT_OFF;
+        NIXIE_CATHODE_OFF(tube, i);
     }
+    *tube->curr_digit = NIXIE_DIGIT_NONE;
+    nixie_spi_push();
+    #else
+    /* All nixie digit pins start low, OFF state is voltage high at MOSFET driver gate */
+    for (i=0; i<NUM_NIXIE_DIGITS; i++)
+    {
+        pins[i + 1].port = tube->digits[i].gpio_port;
+        pins[i + 1].pins = tube->digits[i].gpio_pin;
+        pins[i + 1].mode = GPIO_Mode_Out_PP_Low_Fast;
+    }
+    *tube->curr_digit = NIXIE_DIGIT_NONE;
+
+    /* Pins sharing a port are written together */
+    gpio_fast_init(pins, NUM_NIXIE_DIGITS + 1);
+    #endif /* NIXIE_SPI */
 }
 
 /**
@@ -75,10 +172,10 @@ void nixie_init_pins(nixie_tube_t* tube, nixie_psu_t* psu)
  *
  * @param psu: Power supply addressing and state information
  */
-void nixie_enable_psu(nixie_psu_t* psu)
+void nixie_enable_psu(const nixie_psu_t* psu)
 {
-    GPIO_ResetBits(psu->psu_port, psu->psu_pin);
-    psu->psu_enabled = TRUE;
+    GPIO_FAST_RESET(psu->psu_port, psu->psu_pin);
+    *psu->psu_enabled = TRUE;
 }
 
 /**
@@ -86,10 +183,10 @@ void nixie_enable_psu(nixie_psu_t* psu)
  *
  * @param psu: Power supply addressing and state information
  */
-void nixie_disable_psu(nixie_psu_t* psu)
+void nixie_disable_psu(const nixie_psu_t* psu)
 {
-    GPIO_SetBits(psu->psu_port, psu->psu_pin);
-    psu->psu_enabled = FALSE;
+    GPIO_FAST_SET(psu->psu_port, psu->psu_pin);
+    *psu->psu_enabled = FALSE;
 }
 
 /**
@@ -99,14 +196,21 @@ void nixie_disable_psu(nixie_psu_t* psu)
  * @param digit: Digit number to control (0-9)
  * @param state: State to change to (DIGIT_ON or DIGIT_OFF)
  * @param psu: Power supply addressing and state information
- * @return nixie_error_t
+ * @return nixie_error_t, NIXIE_ERROR for a digit past 9 or an unknown state
  */
-nixie_error_t nixie_digit_control(nixie_tube_t* tube, uint8_t digit, nixie_digit_state_t state, nixie_psu_t* psu)
+nixie_error_t nixie_digit_control(const nixie_tube_t* tube, uint8_t digit, nixie_digit_state_t state,
+                                  const nixie_psu_t* psu)
 {
-    uint8_t i;
+    uint8_t curr = *tube->curr_digit;
+
+    /* Digits index the cathode table and the chain outputs of the tube */
+    if (digit >= NUM_NIXIE_DIGITS)
+    {
+        return NIXIE_ERROR;
+    }
 
     /* No modifying nixie states if power supply is turned off */
-    if (psu->psu_enabled == FALSE)
+    if (*psu->psu_enabled == FALSE)
     {
         return NIXIE_PSU_DISABLED;
     }
@@ -114,27 +218,179 @@ nixie_error_t nixie_digit_control(nixie_tube_t* tube, uint8_t digit, nixie_digit
     switch (state)
     {
         case DIGIT_ON:
-            for (i=0; i<NUM_NIXIE_DIGITS; i++)
+            /* Turn off the previously on digit, only one should be on at once */
+            if ((curr != NIXIE_DIGIT_NONE) && (curr != digit))
             {
-                /* Turn off any previously on nixie digits, only one should be on at once */
-                if (tube->digits[i].curr_state == DIGIT_ON)
-                {
-                    GPIO_ResetBits(tube->digits[i].gpio_port, tube->digits[i].gpio_pin);
-                    tube->digits[i].curr_state = DIGIT_OFF;
-                }
+                NIXIE_CATHODE_OFF(tube, curr);
             }
             /* Turn on new digit */
-            GPIO_SetBits(tube->digits[digit].gpio_port, tube->digits[digit].gpio_pin);
-            tube->digits[digit].curr_state = DIGIT_ON;
+            NIXIE_CATHODE_ON(tube, digit);
+            *tube->curr_digit = digit;
             break;
 
         case DIGIT_OFF:
-            GPIO_ResetBits(tube->digits[digit].gpio_port, tube->digits[digit].gpio_pin);
-            tube->digits[digit].curr_state = DIGIT_OFF;
+            NIXIE_CATHODE_OFF(tube, digit);
+            if (curr == digit)
+            {
+                *tube->curr_digit = NIXIE_DIGIT_NONE;
+            }
             break;
 
         default:
             return NIXIE_ERROR;
     }
+
+    #ifdef NIXIE_SPI
+    /* Both changes of a switch are latched together */
+    nixie_spi_push();
+    #endif /* NIXIE_SPI */
+
     return NIXIE_SUCCESS;
 }
+
+/**
+ * @brief Voltage compensated drive, lit time per NIXIE_DRIVE_PERIOD_US cycle for a cell voltage
+ *
+ * The HV supply draws about constant power from the cell while a digit is lit and its efficiency falls with the
+ * input voltage, so the cell current at full duty grows roughly with 1/VDD^2. Below NIXIE_DRIVE_FULL_MV the duty
+ * is cut by (VDD / NIXIE_DRIVE_FULL_MV)^2, holding the average cell current at its full duty value at
+ * NIXIE_DRIVE_FULL_MV. Perceived brightness follows the duty much less than linearly, 80% duty at 2.6V looks close
+ * to full brightness.
+ *
+ * @param vdd_mv: Cell voltage measured with the HV supply off, in millivolts
+ * @return Lit time in us, NIXIE_DRIVE_MIN_ON_US to NIXIE_DRIVE_PERIOD_US (full duty)
+ */
+uint16_t nixie_drive_on_us(uint16_t vdd_mv)
+{
+    uint32_t on_us;
+
+    if (vdd_mv >= NIXIE_DRIVE_FULL_MV)
+    {
+        return NIXIE_DRIVE_PERIOD_US;
+    }
+
+    on_us = ((uint32_t)NIXIE_DRIVE_PERIOD_US * vdd_mv) / NIXIE_DRIVE_FULL_MV;
+    on_us = (on_us * vdd_mv) / NIXIE_DRIVE_FULL_MV;
+
+    return (on_us < NIXIE_DRIVE_MIN_ON_US) ? NIXIE_DRIVE_MIN_ON_US : (uint16_t)on_us;
+}
+
+#ifdef NIXIE_SPI
+/**
+ * @brief Called from the DMA1 channel 2/3 interrupt, latches the chain once a burst has been shifted out and sends
+ * the changes made meanwhile
+ * @note The wait for the last byte is bounded by NIXIE_SPI_DRAIN_POLLS. A burst still shifting after it is not
+ * latched, the outputs keep the previous state and the image is sent again by the next change (never from here, a
+ * stuck SPI cannot hold the CPU in the interrupt).
+ */
+void nixie_spi_tick(void)
+{
+    uint8_t polls = NIXIE_SPI_DRAIN_POLLS;
+
+    if (DMA_GetITStatus(NIXIE_SPI_DMA_IT_TC) == RESET)
+    {
+        return;
+    }
+
+    DMA_ClearITPendingBit(NIXIE_SPI_DMA_IT_TC);
+    DMA_Cmd(NIXIE_SPI_DMA_CHANNEL, DISABLE);
+
+    /* The last byte is still in the shift register for up to 8 SPI clocks */
+    while (((SPI_GetFlagStatus(SPI1, SPI_FLAG_TXE) == RESET) || (SPI_GetFlagStatus(SPI1, SPI_FLAG_BSY) != RESET)) &&
+           (polls != 0))
+    {
+        polls--;
+    }
+    SPI_DMACmd(SPI1, SPI_DMAReq_TX, DISABLE);
+    SPI_Cmd(SPI1, DISABLE);
+
+    if (polls == 0)
+    {
+        nixie_spi_dirty = TRUE;
+    }
+    else
+    {
+        GPIO_FAST_SET(NIXIE_SPI_PORT, NIXIE_SPI_LATCH_PIN);
+
+        if (nixie_spi_dirty != FALSE)
+        {
+            nixie_spi_start();
+            return;
+        }
+    }
+
+    periph_clk_release(CLK_Peripheral_DMA1);
+    periph_clk_release(CLK_Peripheral_SPI1);
+    nixie_spi_shifting = FALSE;
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Set a chain output in the image
+ * @param output: Output number, 0 is the first output of the register nearest the MCU
+ * @param on: TRUE to drive the cathode
+ */
+static void nixie_spi_output(uint8_t output, bool on)
+{
+    uint8_t* byte = &nixie_spi_image[NIXIE_SPI_BYTES - 1 - (output >> 3)];
+    uint8_t mask = (uint8_t)(1 << (output & 0x07));
+
+    if (on != FALSE)
+    {
+        *byte |= mask;
+    }
+    else
+    {
+        *byte &= (uint8_t)~mask;
+    }
+}
+
+/**
+ * @brief Send the image, or leave it to the interrupt ending the burst in progress
+ * @note The flag is raised before the burst is checked, the interrupt either sees it or has already ended the burst
+ */
+static void nixie_spi_push(void)
+{
+    nixie_spi_dirty = TRUE;
+    if (nixie_spi_shifting != FALSE)
+    {
+        return;
+    }
+
+    nixie_spi_shifting = TRUE;
+    periph_clk_acquire(CLK_Peripheral_SPI1);
+    periph_clk_acquire(CLK_Peripheral_DMA1);
+    nixie_spi_start();
+}
+
+/**
+ * @brief Shift out a copy of the image, the outputs keep the latched state until the transfer complete interrupt
+ */
+static void nixie_spi_start(void)
+{
+    uint8_t i;
+
+    nixie_spi_dirty = FALSE;
+    for (i=0; i<NIXIE_SPI_BYTES; i++)
+    {
+        nixie_spi_tx[i] = nixie_spi_image[i];
+    }
+
+    GPIO_FAST_RESET(NIXIE_SPI_PORT, NIXIE_SPI_LATCH_PIN);
+
+    DMA_Init(NIXIE_SPI_DMA_CHANNEL, (uint32_t)nixie_spi_tx, NIXIE_SPI_DR_ADDRESS, NIXIE_SPI_BYTES,
+             DMA_DIR_MemoryToPeripheral, DMA_Mode_Normal, DMA_MemoryIncMode_Inc, DMA_Priority_Low,
+             DMA_MemoryDataSize_Byte);
+    DMA_ClearITPendingBit(NIXIE_SPI_DMA_IT_TC);
+    DMA_ITConfig(NIXIE_SPI_DMA_CHANNEL, DMA_ITx_TC, ENABLE);
+    DMA_Cmd(NIXIE_SPI_DMA_CHANNEL, ENABLE);
+    DMA_GlobalCmd(ENABLE);
+
+    /* TXE requests the first byte as soon as the requests are enabled */
+    SPI_Cmd(SPI1, ENABLE);
+    SPI_DMACmd(SPI1, SPI_DMAReq_TX, ENABLE);
+}
+#endif /* NIXIE_SPI */
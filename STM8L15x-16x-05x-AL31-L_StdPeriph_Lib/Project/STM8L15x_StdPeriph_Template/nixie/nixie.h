@@ -1,6 +1,10 @@
 /**
  * @file nixie.h
  * @brief Contains structs and API prototypes for nixie tube drivers
+ *
+ * Two backends behind the same API: by default every cathode has its own GPIO, with NIXIE_SPI defined the
+ * cathodes are outputs of a chain of SPI high voltage shift registers (HV5812, 74HC595 and drivers...) and any
+ * number of tubes share the SPI1 pins and a latch pin.
  */
 
 #ifndef NIXIE_H_
@@ -11,12 +15,68 @@
 /*                              I N C L U D E S                               */
 /******************************************************************************/
 #include "stm8l15x_gpio.h"
+#include "battery.h"
+#ifdef NIXIE_SPI
+#include "stm8l15x_spi.h"
+#include "stm8l15x_dma.h"
+#endif /* NIXIE_SPI */
 
 /******************************************************************************/
 /*                               D E F I N E S                                */
 /******************************************************************************/
 #define NUM_NIXIE_DIGITS 10
 
+/* HV supply rise time from enable until cathodes can strike (soft start), in us */
+#ifndef NIXIE_PSU_STARTUP_US
+#define NIXIE_PSU_STARTUP_US 2000
+#endif /* NIXIE_PSU_STARTUP_US */
+
+/* Voltage compensated drive: prints on a low cell (battery_update()) are dimmed with nixie_drive_on_us(),
+   capping the cell current. Set to 0 for fixed dimming on a low cell. */
+#ifndef NIXIE_DRIVE_COMPENSATED
+#define NIXIE_DRIVE_COMPENSATED 1
+#endif /* NIXIE_DRIVE_COMPENSATED */
+
+/* Lowest cell voltage lit at full duty, in mV. The low battery threshold, so a cell classified as healthy is never
+   dimmed and a low one always is. */
+#define NIXIE_DRIVE_FULL_MV BATTERY_LOW_MV
+
+/* Dimmed digit PWM cycle and shortest lit time per cycle, in us */
+#define NIXIE_DRIVE_PERIOD_US 1280
+#define NIXIE_DRIVE_MIN_ON_US 320
+
+/* Current digit of a tube with every digit off */
+#define NIXIE_DIGIT_NONE 0xFF
+
+#ifdef NIXIE_SPI
+/* Tubes on the shift register chain, NUM_NIXIE_DIGITS outputs each (tube_A first) */
+#ifndef NIXIE_SPI_NUM_TUBES
+#ifdef STM8_BASEBAND
+#define NIXIE_SPI_NUM_TUBES 1
+#else
+#define NIXIE_SPI_NUM_TUBES 2
+#endif /* STM8_BASEBAND */
+#endif /* NIXIE_SPI_NUM_TUBES */
+
+/* Register outputs in the chain, outputs past the last tube are kept off */
+#ifndef NIXIE_SPI_NUM_OUTPUTS
+#define NIXIE_SPI_NUM_OUTPUTS (NIXIE_SPI_NUM_TUBES * NUM_NIXIE_DIGITS)
+#endif /* NIXIE_SPI_NUM_OUTPUTS */
+
+/* Bytes shifted per update, the first bits of a partly used byte fall off the end of the chain */
+#define NIXIE_SPI_BYTES ((NIXIE_SPI_NUM_OUTPUTS + 7) / 8)
+
+/* SPI1 transmit requests are served by DMA1 channel 2 */
+#define NIXIE_SPI_DMA_CHANNEL DMA1_Channel2
+#define NIXIE_SPI_DMA_IT_TC DMA1_IT_TC2
+#define NIXIE_SPI_DR_ADDRESS ((uint16_t)(SPI1_BASE + 0x04))
+
+/* Status polls allowed for the burst to drain after the transfer complete interrupt, the last byte can wait in the
+   data register behind the one shifting: 16 SPI clocks, 32 CPU cycles at fSCK = fMASTER / 2, a poll takes at least
+   4 cycles */
+#define NIXIE_SPI_DRAIN_POLLS 16
+#endif /* NIXIE_SPI */
+
 /******************************************************************************/
 /*                              T Y P E D E F S                               */
 /******************************************************************************/
@@ -45,62 +105,77 @@ typedef enum
 
 } nixie_digit_state_t;
 
+#ifndef NIXIE_SPI
 /**
- * @brief Nixie tube digit struct, contains digit addressing information as well as current state
+ * @brief Nixie tube digit struct, contains digit addressing information
  */
 typedef struct
 {
-    nixie_digit_state_t curr_state;
-
     GPIO_TypeDef* gpio_port;
 
     uint8_t gpio_pin;
 
 } nixie_char_t;
+#endif /* !NIXIE_SPI */
 
 /**
- * @brief Nixie tube power supply object
+ * @brief Nixie tube power supply object, addressing is constant (flash), only the state lives in RAM
  */
 typedef struct
 {
-    bool psu_enabled;
-
     GPIO_TypeDef* psu_port;
 
     uint8_t psu_pin;
 
+    bool* psu_enabled;
+
 } nixie_psu_t;
 
 
 /**
- * @brief Nixie tube struct, contains addressing and status information for all digits along with power supply
+ * @brief Nixie tube struct, addressing for all digits is constant (flash), the state is the one digit that is on
  */
 typedef struct
 {
+    #ifdef NIXIE_SPI
+    uint8_t first_output; /* Chain output of digit 0, digit n is on first_output + n (output 0 is shifted last) */
+    #else
     nixie_char_t digits[NUM_NIXIE_DIGITS];
+    #endif /* NIXIE_SPI */
+
+    uint8_t* curr_digit; /* 0-9 or NIXIE_DIGIT_NONE */
 
 } nixie_tube_t;
 
 /******************************************************************************/
 /*                       G L O B A L  V A R I A B L E S                       */
 /******************************************************************************/
-extern nixie_tube_t tube_A;
-extern nixie_psu_t shared_psu;
+extern const nixie_tube_t tube_A;
+extern const nixie_psu_t shared_psu;
 #ifndef STM8_BASEBAND
-extern nixie_tube_t tube_B;
+extern const nixie_tube_t tube_B;
 #endif
 
 /******************************************************************************/
 /*                             F U N C T I O N S                              */
 /******************************************************************************/
 /* Initialization */
-void nixie_init_pins(nixie_tube_t* tube, nixie_psu_t* psu);
+void nixie_init_pins(const nixie_tube_t* tube, const nixie_psu_t* psu);
 
 /* Power supply control */
-void nixie_enable_psu(nixie_psu_t* psu);
-void nixie_disable_psu(nixie_psu_t* psu);
+void nixie_enable_psu(const nixie_psu_t* psu);
+void nixie_disable_psu(const nixie_psu_t* psu);
 
 /* Digit control */
-nixie_error_t nixie_digit_control(nixie_tube_t* tube, uint8_t digit, nixie_digit_state_t state, nixie_psu_t* psu);
+nixie_error_t nixie_digit_control(const nixie_tube_t* tube, uint8_t digit, nixie_digit_state_t state,
+                                  const nixie_psu_t* psu);
+
+/* Drive duty */
+uint16_t nixie_drive_on_us(uint16_t vdd_mv);
+
+#ifdef NIXIE_SPI
+/* Shift register chain, called from the DMA1 channel 2/3 interrupt */
+void nixie_spi_tick(void);
+#endif /* NIXIE_SPI */
 
 #endif /* NIXIE_H_ */
\ No newline at end of file
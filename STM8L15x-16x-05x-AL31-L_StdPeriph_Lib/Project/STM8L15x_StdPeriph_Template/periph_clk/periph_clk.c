@@ -0,0 +1,150 @@
+/**
+ * @file periph_clk.c
+ * @brief Reference counted peripheral clock gating, peripherals are only clocked while a driver holds them
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "periph_clk.h"
+
+#ifdef STM8_BASEBAND
+#include <string.h>
+#include "uart.h"
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Mask interrupts around a count update and its PCKENRx read-modify-write, both are also called from interrupt
+   handlers. The caller's interrupt mask (CC.I1/I0) is restored, so a handler stays at its own level. */
+#ifdef _COSMIC_
+#define PERIPH_CLK_LOCK(cc) ((cc) = (uint8_t)_asm("push cc\npop a\nsim"))
+#define PERIPH_CLK_UNLOCK(cc) _asm("push a\npop cc", (cc))
+#else /* _IAR_ */
+#define PERIPH_CLK_LOCK(cc) do { (cc) = __get_interrupt_state(); __disable_interrupt(); } while (0)
+#define PERIPH_CLK_UNLOCK(cc) __set_interrupt_state(cc)
+#endif /* _COSMIC_ */
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Number of active users per clock gate, gate is open while count is non-zero */
+static uint8_t periph_clk_refs[PERIPH_CLK_NUM_GATES] = {0};
+
+#ifdef STM8_BASEBAND
+/* Peripheral names indexed by PERIPH_CLK_INDEX, NULL for reserved gate bits */
+static const char* const periph_clk_names[PERIPH_CLK_NUM_GATES] = {
+  "TIM2", "TIM3", "TIM4", "I2C1", "SPI1", "USART1", "BEEP", "DAC",
+  "ADC1", "TIM1", "RTC", "LCD", "DMA1", "COMP", NULL, "BOOTROM",
+  "AES", "TIM5", "SPI2", "USART2", "USART3", "CSSLSE", NULL, NULL
+};
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Acquire peripheral clock, gate is opened on first user
+ * @param periph: Peripheral to clock
+ * @note Must be balanced by a call to periph_clk_release() once the transaction is complete
+*/
+void periph_clk_acquire(CLK_Peripheral_TypeDef periph)
+{
+  uint8_t idx = PERIPH_CLK_INDEX(periph);
+  uint8_t cc;
+
+  PERIPH_CLK_LOCK(cc);
+  if (periph_clk_refs[idx] == 0)
+  {
+    CLK_PeripheralClockConfig(periph, ENABLE);
+  }
+  periph_clk_refs[idx]++;
+  PERIPH_CLK_UNLOCK(cc);
+}
+
+/**
+ * @brief Release peripheral clock, gate is closed once the last user releases it
+ * @param periph: Peripheral to release
+*/
+void periph_clk_release(CLK_Peripheral_TypeDef periph)
+{
+  uint8_t idx = PERIPH_CLK_INDEX(periph);
+  uint8_t cc;
+
+  PERIPH_CLK_LOCK(cc);
+  /* Unbalanced release leaves the gate alone */
+  if (periph_clk_refs[idx] != 0)
+  {
+    periph_clk_refs[idx]--;
+    if (periph_clk_refs[idx] == 0)
+    {
+      CLK_PeripheralClockConfig(periph, DISABLE);
+    }
+  }
+  PERIPH_CLK_UNLOCK(cc);
+}
+
+/**
+ * @brief Get number of users currently holding a peripheral clock
+ * @param periph: Peripheral to check
+ * @retval Number of users, peripheral is clocked if non-zero
+*/
+uint8_t periph_clk_users(CLK_Peripheral_TypeDef periph)
+{
+  return periph_clk_refs[PERIPH_CLK_INDEX(periph)];
+}
+
+#ifdef STM8_BASEBAND
+/**
+ * @brief Print every clocked peripheral and its user count to host PC
+ *
+ * Reads the PCKENRx registers directly so gates opened outside of the manager (leaks) are also reported,
+ * these are printed with a user count of "--".
+*/
+void periph_clk_dump(void)
+{
+  uint8_t i;
+  uint8_t pcken;
+  char count[3];
+  const char header[] = "Clocked peripherals:\r\n";
+  const char sep[] = ": ";
+  const char newline[] = "\r\n";
+
+  tiny_print(header, ARR_SIZE(header));
+
+  for (i=0; i<PERIPH_CLK_NUM_GATES; i++)
+  {
+    /* Fetch gate register for this block of 8 peripherals */
+    if ((i % PERIPH_CLK_BITS_PER_REG) == 0)
+    {
+      pcken = (i < PERIPH_CLK_BITS_PER_REG) ? CLK->PCKENR1 : ((i < (2 * PERIPH_CLK_BITS_PER_REG)) ? CLK->PCKENR2 : CLK->PCKENR3);
+    }
+
+    if ((periph_clk_names[i] == NULL) || ((pcken & (uint8_t)(1 << (i % PERIPH_CLK_BITS_PER_REG))) == 0))
+    {
+      continue;
+    }
+
+    if (periph_clk_refs[i] == 0)
+    {
+      count[0] = '-';
+      count[1] = '-';
+    }
+    else
+    {
+      count[0] = (char)((periph_clk_refs[i] / 10) + 48);
+      count[1] = (char)((periph_clk_refs[i] % 10) + 48);
+    }
+    count[2] = '\0';
+
+    tiny_print(periph_clk_names[i], (int)(strlen(periph_clk_names[i]) + 1));
+    tiny_print(sep, ARR_SIZE(sep));
+    tiny_print(count, ARR_SIZE(count));
+    tiny_print(newline, ARR_SIZE(newline));
+  }
+}
+#endif /* STM8_BASEBAND */
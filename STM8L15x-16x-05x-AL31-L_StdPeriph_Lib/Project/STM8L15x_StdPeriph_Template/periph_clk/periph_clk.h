@@ -0,0 +1,39 @@
+/**
+ * @file periph_clk.h
+ * @brief Function prototypes and defines for reference counted peripheral clock gating
+ */
+
+#ifndef PERIPH_CLK_H_
+#define PERIPH_CLK_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_clk.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Number of PCKENRx registers and gate bits per register */
+#define PERIPH_CLK_NUM_REGS 3
+#define PERIPH_CLK_BITS_PER_REG 8
+
+/* Total number of clock gates tracked by the manager */
+#define PERIPH_CLK_NUM_GATES (PERIPH_CLK_NUM_REGS * PERIPH_CLK_BITS_PER_REG)
+
+/* Convert CLK_Peripheral_TypeDef (0xRB, R = register, B = bit) to reference count table index */
+#define PERIPH_CLK_INDEX(p) ((uint8_t)((((uint8_t)(p) >> 4) * PERIPH_CLK_BITS_PER_REG) + ((uint8_t)(p) & 0x0F)))
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void periph_clk_acquire(CLK_Peripheral_TypeDef periph);
+void periph_clk_release(CLK_Peripheral_TypeDef periph);
+uint8_t periph_clk_users(CLK_Peripheral_TypeDef periph);
+
+#ifdef STM8_BASEBAND
+void periph_clk_dump(void);
+#endif /* STM8_BASEBAND */
+
+#endif /* PERIPH_CLK_H_ */
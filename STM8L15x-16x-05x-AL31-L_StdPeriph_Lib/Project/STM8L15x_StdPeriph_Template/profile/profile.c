@@ -0,0 +1,207 @@
+/**
+ * @file profile.c
+ * @brief TIM1 profiling timestamp (16 bit counter extended to 32 bits by the update interrupt) and per region
+ * max/count statistics, printed to the host over UART
+ *
+ * The statistics table is shared with isr_wcet (handler slots after the regions), both keep a 16 bit worst case
+ * and count only to hold the table to 4 bytes per slot.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include <string.h>
+
+#include "profile.h"
+#include "periph_clk.h"
+#include "uart.h"
+
+#ifdef STM8_BASEBAND
+/******************************************************************************/
+/*                P U B L I C  G L O B A L  V A R I A B L E S                 */
+/******************************************************************************/
+
+/* Start timestamp of each region (low 16 bits, in 2^PROFILE_REGION_SHIFT ticks), written by PROFILE_BEGIN() */
+uint16_t profile_start[PROFILE_NUM_REGIONS];
+
+/* Regions, then the handlers measured by isr_wcet */
+profile_stats_t profile_stats[PROFILE_NUM_STATS];
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Names printed by profile_dump(), in region order */
+static const char* const profile_names[PROFILE_NUM_REGIONS] = {
+  "print_start", "battery_update", "rtc_read", "rtc_print", "display"
+};
+
+/* Upper 16 bits of the timestamp, incremented by the TIM1 update interrupt */
+static volatile uint16_t profile_overflows = 0;
+
+/* A region was recorded since the last report */
+static uint8_t profile_pending = 0;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void profile_print_val(uint32_t val);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Start TIM1 free-running with the update interrupt enabled, call before interrupts are enabled
+ * @note TIM1 stays clocked while the firmware runs (breakout board only)
+*/
+void profile_init(void)
+{
+  periph_clk_acquire(CLK_Peripheral_TIM1);
+
+  TIM1_TimeBaseInit(PROFILE_PRESCALER, TIM1_CounterMode_Up, 0xFFFF, 0);
+  TIM1_ClearITPendingBit(TIM1_IT_Update);
+  TIM1_ITConfig(TIM1_IT_Update, ENABLE);
+  TIM1_Cmd(ENABLE);
+}
+
+/**
+ * @brief Get the current timestamp
+ * @retval TIM1 ticks since profile_init(), wraps after 2^32 ticks
+*/
+uint32_t profile_now(void)
+{
+  uint16_t high;
+  uint16_t low;
+
+  /* Retry if the update interrupt ran between the two reads */
+  do
+  {
+    high = profile_overflows;
+    low = (uint16_t)((uint16_t)TIM1->CNTRH << 8);
+    low |= TIM1->CNTRL;
+  } while (high != profile_overflows);
+
+  /* Wrapped but the update interrupt has not run yet (interrupts masked or called from a handler) */
+  if (((TIM1->SR1 & TIM1_SR1_UIF) != 0) && (low < 0x8000))
+  {
+    high++;
+  }
+
+  return ((uint32_t)high << 16) | low;
+}
+
+/**
+ * @brief Count a counter wrap, called from the TIM1 update interrupt
+*/
+void profile_overflow(void)
+{
+  profile_overflows++;
+  TIM1_ClearITPendingBit(TIM1_IT_Update);
+}
+
+/**
+ * @brief Add one region execution to its statistics, called by PROFILE_END()
+ * @param id: Region
+ * @param units: Duration in 2^PROFILE_REGION_SHIFT ticks
+*/
+void profile_record(profile_id_t id, uint16_t units)
+{
+  profile_stats_t* stats = &profile_stats[id];
+
+  if (units > stats->max)
+  {
+    stats->max = units;
+  }
+  if (stats->count != 0xFFFF)
+  {
+    stats->count++;
+  }
+
+  profile_pending = 1;
+}
+
+/**
+ * @brief Get region statistics
+ * @param id: Region
+ * @retval Statistics since boot, in 2^PROFILE_REGION_SHIFT ticks
+*/
+const profile_stats_t* profile_get(profile_id_t id)
+{
+  return &profile_stats[id];
+}
+
+/**
+ * @brief Print the statistics of every region that ran to host PC
+ * @note Format: "<name>: max (us) MMMMMMM count CCCCCCC", the worst case is rounded down to PROFILE_REGION_US
+*/
+void profile_dump(void)
+{
+  uint8_t i;
+  const char header[] = "Profile:\r\n";
+  const char times[] = ": max (us) ";
+  const char count[] = " count ";
+  const char newline[] = "\r\n";
+  const profile_stats_t* stats;
+
+  tiny_print(header, ARR_SIZE(header));
+
+  for (i=0; i<PROFILE_NUM_REGIONS; i++)
+  {
+    stats = &profile_stats[i];
+    if (stats->count == 0)
+    {
+      continue;
+    }
+
+    tiny_print(profile_names[i], (int)(strlen(profile_names[i]) + 1));
+    tiny_print(times, ARR_SIZE(times));
+    profile_print_val((uint32_t)stats->max * PROFILE_REGION_US);
+    tiny_print(count, ARR_SIZE(count));
+    profile_print_val(stats->count);
+    tiny_print(newline, ARR_SIZE(newline));
+  }
+}
+
+/**
+ * @brief Dump the statistics if any region ran since the last report
+*/
+void profile_report(void)
+{
+  if (profile_pending == 0)
+  {
+    return;
+  }
+  profile_pending = 0;
+
+  profile_dump();
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Print a value as 7 decimal digits
+ * @param val: Value (saturates at 9999999)
+*/
+static void profile_print_val(uint32_t val)
+{
+  char out[PROFILE_PRINT_SIZE];
+  uint8_t i;
+
+  if (val > 9999999UL)
+  {
+    val = 9999999UL;
+  }
+
+  for (i=PROFILE_PRINT_SIZE - 1; i>0; i--)
+  {
+    out[i - 1] = (char)((val % 10) + 48);
+    val /= 10;
+  }
+  out[PROFILE_PRINT_SIZE - 1] = '\0';
+
+  tiny_print(out, PROFILE_PRINT_SIZE);
+}
+#endif /* STM8_BASEBAND */
@@ -0,0 +1,100 @@
+/**
+ * @file profile.h
+ * @brief Function prototypes, defines and types for the TIM1 profiling timestamp and scoped region timing
+ * (baseband board only, compiled out on the watch)
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_tim1.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* TIM1 free-running at SYSCLK / 4 = 2MHz, extended to 32 bits (~35min) by the update interrupt. The update
+   interrupt wakes the CPU every 32ms, a lower prescaler costs wake ups for resolution */
+#define PROFILE_PRESCALER 3
+#define PROFILE_TICKS_PER_US 2
+
+/* Region durations are kept in 16 bits of 2^PROFILE_REGION_SHIFT ticks (64us, up to ~4.2s) */
+#define PROFILE_REGION_SHIFT 7
+#define PROFILE_REGION_US ((1UL << PROFILE_REGION_SHIFT) / PROFILE_TICKS_PER_US)
+
+/* Statistics slots after the regions, one per interrupt handler measured by isr_wcet (ISR_WCET_NUM_HANDLERS) */
+#define PROFILE_NUM_HANDLERS 9
+
+/* Output data string buffer size (7 digits + NULL) */
+#define PROFILE_PRINT_SIZE 8
+
+/**
+ * @brief Region markers, every PROFILE_END(id) must follow a PROFILE_BEGIN(id) on the same path (a region left
+ * without its end is not recorded)
+ */
+#ifdef STM8_BASEBAND
+#define PROFILE_BEGIN(id) (profile_start[(id)] = (uint16_t)(profile_now() >> PROFILE_REGION_SHIFT))
+#define PROFILE_END(id) profile_record((id), (uint16_t)((uint16_t)(profile_now() >> PROFILE_REGION_SHIFT) - \
+                                                        profile_start[(id)]))
+#else
+#define PROFILE_BEGIN(id)
+#define PROFILE_END(id)
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Profiled regions
+ */
+typedef enum
+{
+  PROFILE_PRINT_START, /* Print request handled to display started, digits light at the later of this and the end
+                          of the HV supply warm-up (wake from halt not included) */
+
+  PROFILE_BATTERY_UPDATE, /* Battery level check before display */
+
+  PROFILE_RTC_READ, /* External RTC time read over I2C */
+
+  PROFILE_RTC_PRINT, /* Time printed to the host over UART */
+
+  PROFILE_DISPLAY, /* Digit display hold */
+
+  PROFILE_NUM_REGIONS
+
+} profile_id_t;
+
+#define PROFILE_NUM_STATS (PROFILE_NUM_REGIONS + PROFILE_NUM_HANDLERS)
+
+/**
+ * @brief Statistics of a region (in 2^PROFILE_REGION_SHIFT ticks) or a handler (in TIM1 ticks)
+ */
+typedef struct
+{
+  uint16_t max; /* Saturates */
+
+  uint16_t count; /* Saturates */
+
+} profile_stats_t;
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+#ifdef STM8_BASEBAND
+extern uint16_t profile_start[PROFILE_NUM_REGIONS];
+extern profile_stats_t profile_stats[PROFILE_NUM_STATS];
+
+void profile_init(void);
+uint32_t profile_now(void);
+void profile_overflow(void);
+void profile_record(profile_id_t id, uint16_t units);
+const profile_stats_t* profile_get(profile_id_t id);
+void profile_dump(void);
+void profile_report(void);
+#endif /* STM8_BASEBAND */
+
+#endif /* PROFILE_H_ */
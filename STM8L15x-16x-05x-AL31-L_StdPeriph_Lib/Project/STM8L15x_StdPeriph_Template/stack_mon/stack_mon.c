@@ -0,0 +1,136 @@
+/**
+ * @file stack_mon.c
+ * @brief Stack painting, the unused stack is filled with a known pattern at boot and the deepest overwritten
+ * byte gives the high water mark (main loop plus any interrupt handler stacked on top of it)
+ *
+ * Only the Cosmic build owns the stack region, other builds (host) report 0 bytes used.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stack_mon.h"
+#include "uart.h"
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+#ifdef STM8_BASEBAND
+/* Last high water mark sent to the host */
+static uint16_t stack_mon_reported = 0;
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+#ifdef STM8_BASEBAND
+static void stack_mon_format(uint16_t val, char* out);
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Fill the unused stack with STACK_MON_PATTERN, must be called first thing in main() with interrupts disabled
+ */
+void stack_mon_paint(void)
+{
+  #ifdef _COSMIC_
+  uint8_t marker;
+  uint8_t* p = (uint8_t*)STACK_MON_BOTTOM;
+  uint8_t* end = &marker - STACK_MON_GUARD;
+
+  while (p < end)
+  {
+    *p++ = STACK_MON_PATTERN;
+  }
+  #endif /* _COSMIC_ */
+}
+
+/**
+ * @brief Get the deepest stack use since boot
+ * @retval Bytes used from the top of the stack
+ */
+uint16_t stack_mon_high_water(void)
+{
+  #ifdef _COSMIC_
+  const uint8_t* p = (const uint8_t*)STACK_MON_BOTTOM;
+
+  /* Painted bytes are only overwritten from the top down, the first changed byte is the deepest use */
+  while ((p <= (const uint8_t*)STACK_MON_TOP) && (*p == STACK_MON_PATTERN))
+  {
+    p++;
+  }
+
+  return (uint16_t)((STACK_MON_TOP + 1) - (uint16_t)p);
+  #else
+  return 0;
+  #endif /* _COSMIC_ */
+}
+
+/**
+ * @brief Check whether the stack reached the bottom of its region (RAM below it may have been overwritten)
+ * @retval TRUE if the last stack byte was used
+ */
+bool stack_mon_overflowed(void)
+{
+  return (stack_mon_high_water() >= STACK_MON_SIZE) ? TRUE : FALSE;
+}
+
+#ifdef STM8_BASEBAND
+/**
+ * @brief Print the high water mark to host PC whenever it has grown since the last report
+ */
+void stack_mon_report(void)
+{
+  char used[STACK_MON_PRINT_SIZE];
+  char size[STACK_MON_PRINT_SIZE];
+  const char header[] = "Stack high water (bytes): ";
+  const char sep[] = "/";
+  const char newline[] = "\r\n";
+  const char overflow[] = "Stack overflow\r\n";
+  uint16_t high_water = stack_mon_high_water();
+
+  if (high_water <= stack_mon_reported)
+  {
+    return;
+  }
+  stack_mon_reported = high_water;
+
+  stack_mon_format(high_water, used);
+  stack_mon_format(STACK_MON_SIZE, size);
+
+  tiny_print(header, ARR_SIZE(header));
+  tiny_print(used, STACK_MON_PRINT_SIZE);
+  tiny_print(sep, ARR_SIZE(sep));
+  tiny_print(size, STACK_MON_PRINT_SIZE);
+  tiny_print(newline, ARR_SIZE(newline));
+
+  if (stack_mon_overflowed())
+  {
+    tiny_print(overflow, ARR_SIZE(overflow));
+  }
+}
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+#ifdef STM8_BASEBAND
+/**
+ * @brief Format a byte count as 4 decimal digits
+ * @param val: Value (0-9999)
+ * @param out: STACK_MON_PRINT_SIZE byte buffer
+ */
+static void stack_mon_format(uint16_t val, char* out)
+{
+  out[0] = (char)(((val / 1000) % 10) + 48);
+  out[1] = (char)(((val / 100) % 10) + 48);
+  out[2] = (char)(((val / 10) % 10) + 48);
+  out[3] = (char)((val % 10) + 48);
+  out[4] = '\0';
+}
+#endif /* STM8_BASEBAND */
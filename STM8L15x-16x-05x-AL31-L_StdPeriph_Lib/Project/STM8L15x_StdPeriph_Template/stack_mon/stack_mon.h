@@ -0,0 +1,43 @@
+/**
+ * @file stack_mon.h
+ * @brief Function prototypes and defines for stack painting and high water mark reporting
+ */
+
+#ifndef STACK_MON_H_
+#define STACK_MON_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Stack region, must match the linker memory map: RAM segment ends at 0x1FF, stack top (SP at reset) is 0x3FF */
+#define STACK_MON_BOTTOM 0x0200
+#define STACK_MON_TOP 0x03FF
+#define STACK_MON_SIZE ((STACK_MON_TOP - STACK_MON_BOTTOM) + 1)
+
+/* Fill byte for unused stack */
+#define STACK_MON_PATTERN 0xCD
+
+/* Bytes left unpainted below the painting function's frame */
+#define STACK_MON_GUARD 16
+
+/* Output data string buffer size (4 digits + NULL) */
+#define STACK_MON_PRINT_SIZE 5
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void stack_mon_paint(void);
+uint16_t stack_mon_high_water(void);
+bool stack_mon_overflowed(void);
+
+#ifdef STM8_BASEBAND
+void stack_mon_report(void);
+#endif /* STM8_BASEBAND */
+
+#endif /* STACK_MON_H_ */
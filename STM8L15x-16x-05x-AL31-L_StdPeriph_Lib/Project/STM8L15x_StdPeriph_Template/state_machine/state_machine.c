@@ -8,6 +8,14 @@
 /******************************************************************************/
 #include "state_machine.h"
 #include "hardwaredefs.h"
+#include "board_power.h"
+#include "profile.h"
+#include "gpio_fast.h"
+#include "display.h"
+#include "transition.h"
+#include "cathode.h"
+#include "usage.h"
+#include "uart.h"
 
 /******************************************************************************/
 /*                P U B L I C  G L O B A L  V A R I A B L E S                 */
@@ -17,6 +25,8 @@ state_machine_t state_machine = {
 
   FALSE,
 
+  BATTERY_OK,
+
   {POWER_SWITCH_PORT, POWER_SWITCH_PIN_0, POWER_SWITCH_PIN_1, POWER_SWITCH_PIN_2, POWER_SWITCH_INT_0,
    POWER_SWITCH_INT_1, POWER_SWITCH_INT_2, WAKE_BUTTON_PORT, WAKE_BUTTON_PIN, WAKE_BUTTON_INT}
 };
@@ -25,10 +35,20 @@ state_machine_req_t state_machine_request = {
   STATE_MESSAGE_NONE
 };
 
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Set time prompt, the host answers with HHMM */
+static const char sm_set_time_prompt[] = "Set time (HHMM): ";
+
 /******************************************************************************/
 /*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
 /******************************************************************************/
-static void Delay(__IO uint16_t nCount);
+static void sm_psu_enable(void);
+static void sm_read_time(uint8_t* time_buf);
+static void sm_set_time(void);
+static void sm_display_time(uint8_t hours, uint8_t minutes, battery_level_t level, uint16_t on_us);
 
 /******************************************************************************/
 /*                       P U B L I C  F U N C T I O N S                       */
@@ -36,22 +56,28 @@ static void Delay(__IO uint16_t nCount);
 
 void sm_configure_interrupts(state_machine_t* sm)
 {
-  /* Initialize GPIO pins */
-  GPIO_Init(sm->sm_interrupt.power_port, sm->sm_interrupt.power_pin_1, GPIO_Mode_In_PU_IT);
-  GPIO_Init(sm->sm_interrupt.power_port, sm->sm_interrupt.power_pin_2, GPIO_Mode_In_PU_IT);
-  GPIO_Init(sm->sm_interrupt.power_port, sm->sm_interrupt.power_pin_3, GPIO_Mode_In_PU_IT);
-  //GPIO_Init(sm->sm_interrupt.wake_port, sm->sm_interrupt.wake_pin, GPIO_Mode_In_FL_IT);
+  gpio_fast_cfg_t pins[2];
+
+  /* Initialize GPIO pins, switches share one port, the wake button (set time) is a switch to ground too */
+  pins[0].port = sm->sm_interrupt.power_port;
+  pins[0].pins = (uint8_t)(sm->sm_interrupt.power_pin_1 | sm->sm_interrupt.power_pin_2 | sm->sm_interrupt.power_pin_3);
+  pins[0].mode = GPIO_Mode_In_PU_IT;
+  pins[1].port = sm->sm_interrupt.wake_port;
+  pins[1].pins = sm->sm_interrupt.wake_pin;
+  pins[1].mode = GPIO_Mode_In_PU_IT;
+  gpio_fast_init(pins, 2);
 
   /* Set interrupts to trigger on falling edge */
   EXTI_SetPinSensitivity(sm->sm_interrupt.power_int_1, EXTI_Trigger_Falling);
   EXTI_SetPinSensitivity(sm->sm_interrupt.power_int_2, EXTI_Trigger_Falling);
   EXTI_SetPinSensitivity(sm->sm_interrupt.power_int_3, EXTI_Trigger_Falling);
-  //EXTI_SetPinSensitivity(decode_interrupt_mask(sm->sm_interrupt.wake_pin), EXTI_Trigger_Falling);
+  EXTI_SetPinSensitivity(sm->sm_interrupt.wake_int, EXTI_Trigger_Falling);
 }
 
 void sm_execute_requests(state_machine_t* sm, state_machine_req_t* req)
 {
-  uint8_t time_buf[2] = {0};
+  uint8_t time_buf[RTC_PAY_READ_SIZE] = {0};
+  uint16_t on_us;
   /* If there is no new state transition message, we can return/poll/enter lpm */
   if (req->message == STATE_MESSAGE_NONE)
   {
@@ -64,10 +90,20 @@ void sm_execute_requests(state_machine_t* sm, state_machine_req_t* req)
   switch (req->message)
   {
     case STATE_MESSAGE_SET_SLEEP:
+      /* Waking from power off, restore active pin configuration */
+      if (sm->current_state == STATE_POWEROFF)
+      {
+        board_power_up();
+      }
       sm->current_state = STATE_SLEEP;
       req->message = STATE_MESSAGE_NONE;
       break;
     case STATE_MESSAGE_POWER_DOWN:
+      /* Put all pins into lowest leakage state, device will HALT until switched back on */
+      if (sm->current_state != STATE_POWEROFF)
+      {
+        board_power_down();
+      }
       sm->current_state = STATE_POWEROFF;
       req->message = STATE_MESSAGE_NONE;
       break;
@@ -75,24 +111,80 @@ void sm_execute_requests(state_machine_t* sm, state_machine_req_t* req)
       /* Only read time if device powered on */
       if (sm->current_state != STATE_POWEROFF)
       {
-        #ifdef STM8_BASEBAND
-        /* Read rtc data */
-        ext_rtc_read(time_buf, RTC_PAY_READ_SIZE);
-        /* Print RTC time */
-        ext_rtc_print_val(time_buf[0], RTC_PRINT_SECONDS);
-        ext_rtc_print_val(time_buf[1], RTC_PRINT_MINUTES);
-        nixie_enable_psu(&shared_psu);
-        nixie_digit_control(&tube_A, (uint8_t)(ext_rtc_decode(time_buf[0]) % 10), DIGIT_ON, &shared_psu);
-        Delay(0xFFFF);
-        Delay(0xFFFF);
-        Delay(0xFFFF);
-        nixie_disable_psu(&shared_psu);
-        #endif /* STM8_BASEBAND */
-        sm->current_state = STATE_SLEEP;
+        /* Cell level taken with the HV supply still off, a low cell is dimmed */
+        PROFILE_BEGIN(PROFILE_PRINT_START);
+        PROFILE_BEGIN(PROFILE_BATTERY_UPDATE);
+        sm->battery_level = battery_update();
+        #if NIXIE_DRIVE_COMPENSATED
+        on_us = (sm->battery_level == BATTERY_OK) ? NIXIE_DRIVE_PERIOD_US : nixie_drive_on_us(battery_last_mv());
+        #else
+        on_us = (sm->battery_level == BATTERY_OK) ? NIXIE_DRIVE_PERIOD_US : SM_DIM_ON_US;
+        #endif /* NIXIE_DRIVE_COMPENSATED */
+        PROFILE_END(PROFILE_BATTERY_UPDATE);
+
+        /* Refuse to enable the HV supply on a cell that cannot sustain it */
+        if (sm->battery_level != BATTERY_CRITICAL)
+        {
+          /* HV supply rises while the time is read */
+          PROFILE_BEGIN(PROFILE_DISPLAY);
+          sm_psu_enable();
+          /* Read rtc data */
+          PROFILE_BEGIN(PROFILE_RTC_READ);
+          sm_read_time(time_buf);
+          PROFILE_END(PROFILE_RTC_READ);
+          /* Play HH:MM from the end of the warm-up (or now if it is over), the display sequencer or the frame
+             scheduler ends with STATE_MESSAGE_DISPLAY_DONE */
+          sm_display_time(ext_rtc_decode_hours(time_buf[2]), ext_rtc_decode(time_buf[1]), sm->battery_level,
+                          on_us);
+          PROFILE_END(PROFILE_PRINT_START);
+          sm->current_state = STATE_PRINT;
+          #ifdef STM8_BASEBAND
+          /* Print RTC time to the host while the sequence plays */
+          PROFILE_BEGIN(PROFILE_RTC_PRINT);
+          ext_rtc_print_val(time_buf[0], RTC_PRINT_SECONDS);
+          ext_rtc_print_val(time_buf[1], RTC_PRINT_MINUTES);
+          PROFILE_END(PROFILE_RTC_PRINT);
+          #endif /* STM8_BASEBAND */
+        }
+        if (sm->current_state != STATE_PRINT)
+        {
+          sm->current_state = STATE_SLEEP;
+        }
       }
       req->message = STATE_MESSAGE_NONE;
       break;
+    case STATE_MESSAGE_MAINTENANCE:
+      /* Periodic work shares the wake, the HV supply comes up once for every cathode exercised */
+      usage_update(TRUE);
+      if (sm->current_state == STATE_SLEEP)
+      {
+        sm->battery_level = battery_update();
+
+        /* Exercise is optional, skipped on a weak cell */
+        if ((sm->battery_level == BATTERY_OK) && (cathode_render() != FALSE))
+        {
+          PROFILE_BEGIN(PROFILE_DISPLAY);
+          sm_psu_enable();
+          display_start(0, 0);
+          sm->current_state = STATE_PRINT;
+        }
+      }
+      req->message = STATE_MESSAGE_NONE;
+      break;
+    case STATE_MESSAGE_DISPLAY_DONE:
+      /* Sequence finished, tubes are already blanked */
+      nixie_disable_psu(&shared_psu);
+      PROFILE_END(PROFILE_DISPLAY);
+      usage_update(FALSE);
+      sm->current_state = STATE_SLEEP;
+      req->message = STATE_MESSAGE_NONE;
+      break;
     case STATE_MESSAGE_SET_TIME:
+      /* Only set the time if device powered on */
+      if (sm->current_state != STATE_POWEROFF)
+      {
+        sm_set_time();
+      }
       req->message = STATE_MESSAGE_NONE;
       break;
     default:
@@ -100,21 +192,138 @@ void sm_execute_requests(state_machine_t* sm, state_machine_req_t* req)
       break;
   }
 
-  sm->executing_state = FALSE;
+  /* A playing display sequence or animation keeps other requests out until it queues STATE_MESSAGE_DISPLAY_DONE */
+  sm->executing_state = (display_busy() != FALSE) ? TRUE : frame_busy();
 }
 /******************************************************************************/
 /*                      P R I V A T E  F U N C T I O N S                      */
 /******************************************************************************/
 /**
- * @brief  Inserts a delay time.
- * @param  nCount: specifies the delay time length.
+ * @brief  Enable the HV supply and time its rise, the next display sequence starts once it is up
+ * @param  None
+ * @retval None
+ * @note   Disabled again on STATE_MESSAGE_DISPLAY_DONE
+ */
+static void sm_psu_enable(void)
+{
+  nixie_enable_psu(&shared_psu);
+  display_warmup(DISPLAY_US_TO_TICKS(NIXIE_PSU_STARTUP_US));
+}
+
+/**
+ * @brief  Read the time of day, from the external RTC on the breakout board and from the on-chip RTC calendar on
+ *         the watch (its I2C1 pins drive tube A cathodes)
+ * @param  time_buf: Seconds, minutes and hours, BCD in the DS1307 register layout (RTC_PAY_READ_SIZE bytes)
+ * @retval None
+ * @note   The on-chip RTC is kept clocked by cathode_init()
+ */
+static void sm_read_time(uint8_t* time_buf)
+{
+  #ifdef STM8_BASEBAND
+  ext_rtc_read(time_buf, RTC_PAY_READ_SIZE);
+  #else
+  RTC_TimeTypeDef time;
+
+  /* Shadow registers are only updated again some RTCCLK cycles after a wake from HALT */
+  RTC_WaitForSynchro();
+  RTC_GetTime(RTC_Format_BCD, &time);
+  time_buf[0] = time.RTC_Seconds;
+  time_buf[1] = time.RTC_Minutes;
+  time_buf[2] = time.RTC_Hours;
+  #endif /* STM8_BASEBAND */
+}
+
+/**
+ * @brief  Set the time of day from the host, HHMM (24 hour) is read over the UART after a prompt and written with
+ *         the seconds cleared to the external RTC on the breakout board and to the on-chip RTC calendar on the watch
+ * @param  None
  * @retval None
+ * @note   A digit missing for SM_SET_TIME_POLLS polls or an invalid time leaves the time unchanged
  */
-static void Delay(__IO uint16_t nCount)
+static void sm_set_time(void)
 {
-  /* Decrement nCount value */
-	while (nCount != 0)
+  char digits[SM_SET_TIME_DIGITS];
+  uint8_t i;
+  uint8_t hours;
+  uint8_t minutes;
+  #ifndef STM8_BASEBAND
+  RTC_TimeTypeDef time;
+  #endif /* !STM8_BASEBAND */
+
+  /* Receiver runs from before the prompt, the host answers as soon as it is sent */
+  uart_rx_begin();
+  tiny_print(sm_set_time_prompt, ARR_SIZE(sm_set_time_prompt));
+  for (i=0; i<SM_SET_TIME_DIGITS; i++)
+  {
+    if ((uart_getchar_timeout(&digits[i], SM_SET_TIME_POLLS) == FALSE) || (digits[i] < '0') || (digits[i] > '9'))
+    {
+      break;
+    }
+  }
+  uart_rx_end();
+
+  if (i != SM_SET_TIME_DIGITS)
+  {
+    return;
+  }
+
+  /* BCD, as both RTCs keep it */
+  hours = (uint8_t)(((digits[0] - '0') << 4) | (digits[1] - '0'));
+  minutes = (uint8_t)(((digits[2] - '0') << 4) | (digits[3] - '0'));
+  if ((hours > 0x23) || (minutes > 0x59))
+  {
+    return;
+  }
+
+  #ifdef STM8_BASEBAND
+  /* 24 hour mode, seconds cleared with the clock halt bit (clock running) */
+  ext_rtc_write(RTC_SECS_ADDR, RTC_CLEAR_NV);
+  ext_rtc_write(RTC_MINS_ADDR, minutes);
+  ext_rtc_write(RTC_HOURS_ADDR, hours);
+  #else
+  RTC_TimeStructInit(&time);
+  time.RTC_Hours = hours;
+  time.RTC_Minutes = minutes;
+  RTC_SetTime(RTC_Format_BCD, &time);
+  #endif /* STM8_BASEBAND */
+}
+
+/**
+ * @brief  Render the time and start the display sequence, with the selected transition effect played as frames at
+ *         full duty, dimmed (PWM, no effect) otherwise and shorter in low battery mode
+ * @param  hours: Hours (0-23)
+ * @param  minutes: Minutes (0-59)
+ * @param  level: Current battery level
+ * @param  on_us: Lit time per NIXIE_DRIVE_PERIOD_US cycle, NIXIE_DRIVE_PERIOD_US for full duty
+ * @retval None
+ * @note   Power supply must be enabled (sm_psu_enable())
+ */
+static void sm_display_time(uint8_t hours, uint8_t minutes, battery_level_t level, uint16_t on_us)
+{
+  uint16_t periods = (level == BATTERY_OK) ? SM_DISPLAY_PERIODS : SM_DISPLAY_PERIODS_LOW_BATT;
+
+  if (on_us >= NIXIE_DRIVE_PERIOD_US)
+  {
+    /* Transition effect frames take TIM2 once the HV supply warm-up is over, display steps otherwise */
+    if ((level == BATTERY_OK) && (transition_render_time(hours, minutes, periods * SM_DISPLAY_PERIOD_MS) != FALSE))
+    {
+      while (display_idle() == FALSE)
+      {
+        wfi();
+      }
+      if (transition_start() != FALSE)
+      {
+        return;
+      }
+    }
+    display_render_time(hours, minutes, periods * SM_DISPLAY_PERIOD_MS);
+    display_start(0, 0);
+  }
+  else
   {
-    nCount--;
+    display_render_time(hours, minutes, periods * SM_DISPLAY_PERIOD_MS);
+    /* Off time taken from the whole cycle so tick rounding cannot raise the duty */
+    display_start(DISPLAY_US_TO_TICKS(on_us),
+                  (uint16_t)(DISPLAY_US_TO_TICKS(NIXIE_DRIVE_PERIOD_US) - DISPLAY_US_TO_TICKS(on_us)));
   }
 }
@@ -12,11 +12,32 @@
 #include "stm8l15x_gpio.h"
 #include "ext_rtc.h"
 #include "nixie.h"
+#include "battery.h"
 
 /******************************************************************************/
 /*                               D E F I N E S                                */
 /******************************************************************************/
 
+/* Time each digit is lit in display periods, shortened in low battery mode */
+#define SM_DISPLAY_PERIOD_MS 80
+#ifndef SM_DISPLAY_PERIODS
+#define SM_DISPLAY_PERIODS 3
+#endif /* SM_DISPLAY_PERIODS */
+#define SM_DISPLAY_PERIODS_LOW_BATT 1
+
+/* Set to 1 to HALT instead of WFI while waiting for a print request (STATE_SLEEP), the switches wake through EXTI */
+#ifndef SM_SLEEP_HALT
+#define SM_SLEEP_HALT 0
+#endif /* SM_SLEEP_HALT */
+
+/* Dimmed (low battery) lit time per NIXIE_DRIVE_PERIOD_US PWM cycle in us, without NIXIE_DRIVE_COMPENSATED */
+#define SM_DIM_ON_US 320
+
+/* Time set from the host on a wake button press, HHMM (24 hour) after the prompt, each digit within
+   SM_SET_TIME_POLLS UART status polls */
+#define SM_SET_TIME_DIGITS 4
+#define SM_SET_TIME_POLLS 50000
+
 /******************************************************************************/
 /*                              T Y P E D E F S                               */
 /******************************************************************************/
@@ -32,7 +53,7 @@ typedef enum
 
   STATE_SLEEP, /* Put processor into HALT mode and wait for further interrupts */
 
-  STATE_PRINT /* Print time via nixie tubes */
+  STATE_PRINT /* Display sequence playing (time or cathode exercise) */
 
 } state_t;
 
@@ -49,7 +70,11 @@ typedef enum
 
   STATE_MESSAGE_PRINT_TIME, /* Print RTC time */
 
-  STATE_MESSAGE_SET_TIME /* Set RTC time */
+  STATE_MESSAGE_SET_TIME, /* Set RTC time from the host, queued by the wake button */
+
+  STATE_MESSAGE_DISPLAY_DONE, /* Display sequence or animation finished, queued by the TIM2 or DMA1 interrupt */
+
+  STATE_MESSAGE_MAINTENANCE /* Scheduled wake for periodic work, queued by the RTC wakeup interrupt */
 
 } state_message_t;
 
@@ -89,6 +114,8 @@ typedef struct
 
   bool executing_state;
 
+  battery_level_t battery_level;
+
   state_machine_driver_t sm_interrupt;
 
 } state_machine_t;
@@ -88,9 +88,15 @@ INTERRUPT_HANDLER(FLASH_IRQHandler,1)
   */
 INTERRUPT_HANDLER(DMA1_CHANNEL0_1_IRQHandler,2)
 {
-    /* In order to detect unexpected events during development,
-       it is recommended to set a breakpoint on the following instruction.
-    */
+  ISR_WCET_ENTER();
+
+  /* Animation segment streamed, hand the end of the display to the state machine */
+  if (frame_dma_tick() != FALSE)
+  {
+    state_machine_request.message = STATE_MESSAGE_DISPLAY_DONE;
+  }
+
+  ISR_WCET_EXIT(ISR_WCET_DMA1);
 }
 /**
   * @brief DMA1 channel2 and channel3 Interrupt routine.
@@ -99,9 +105,18 @@ INTERRUPT_HANDLER(DMA1_CHANNEL0_1_IRQHandler,2)
   */
 INTERRUPT_HANDLER(DMA1_CHANNEL2_3_IRQHandler,3)
 {
+  #ifdef NIXIE_SPI
+  ISR_WCET_ENTER();
+
+  /* Tube state shifted out to the HV shift registers, latch it */
+  nixie_spi_tick();
+
+  ISR_WCET_EXIT(ISR_WCET_DMA1_2_3);
+  #else
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+  #endif /* NIXIE_SPI */
 }
 /**
   * @brief RTC / CSS_LSE Interrupt routine.
@@ -110,9 +125,15 @@ INTERRUPT_HANDLER(DMA1_CHANNEL2_3_IRQHandler,3)
   */
 INTERRUPT_HANDLER(RTC_CSSLSE_IRQHandler,4)
 {
-    /* In order to detect unexpected events during development,
-       it is recommended to set a breakpoint on the following instruction.
-    */
+  ISR_WCET_ENTER();
+
+  /* Scheduled wake, skipped if a request is executing (the next wake catches up) */
+  if ((cathode_wakeup() != FALSE) && !state_machine.executing_state)
+  {
+    state_machine_request.message = STATE_MESSAGE_MAINTENANCE;
+  }
+
+  ISR_WCET_EXIT(ISR_WCET_RTC);
 }
 /**
   * @brief External IT PORTE/F and PVD Interrupt routine.
@@ -121,9 +142,16 @@ INTERRUPT_HANDLER(RTC_CSSLSE_IRQHandler,4)
   */
 INTERRUPT_HANDLER(EXTIE_F_PVD_IRQHandler,5)
 {
-    /* In order to detect unexpected events during development,
-       it is recommended to set a breakpoint on the following instruction.
-    */
+  ISR_WCET_ENTER();
+
+  /* VDD crossed the PVD threshold, battery level is re-measured on next display request */
+  if (PWR_PVDGetITStatus() != RESET)
+  {
+    battery_pvd_event();
+    PWR_PVDClearITPendingBit();
+  }
+
+  ISR_WCET_EXIT(ISR_WCET_PVD);
 }
 
 /**
@@ -150,6 +178,14 @@ INTERRUPT_HANDLER(EXTID_H_IRQHandler,7)
     */
 }
 
+/* Switch interrupts are the wake path, executed from RAM so flash can stay powered down (IDDQ). The LED toggle is
+   an inline BCPL (GPIO_FAST_TOGGLE), a GPIO library call would fetch from flash. The LED only acknowledges accepted
+   requests: frames play while requests are blocked and write whole port output registers (the LED port included)
+   back from the levels taken when they started, a toggle meanwhile would be undone. */
+#if defined(_COSMIC_) && defined(RAM_EXECUTION)
+#pragma section (FLASH_CODE)
+#endif /* _COSMIC_ && RAM_EXECUTION */
+
 /**
   * @brief External IT PIN0 Interrupt routine.
   * @param  None
@@ -157,13 +193,21 @@ INTERRUPT_HANDLER(EXTID_H_IRQHandler,7)
   */
 INTERRUPT_HANDLER(EXTI0_IRQHandler,8)
 {
-  /* Queue new print time message if not other request is being processed */
+  ISR_WCET_ENTER();
+
+  /* Queue new print time message if not other request is being processed (watch wake button: set time) */
   if (!state_machine.executing_state)
   {
+    #ifdef STM8_BASEBAND
     state_machine_request.message = STATE_MESSAGE_PRINT_TIME;
+    #else
+    state_machine_request.message = STATE_MESSAGE_SET_TIME;
+    #endif /* STM8_BASEBAND */
+    GPIO_FAST_TOGGLE(LED_GPIO_PORT, LED_GPIO_PINS);
   }
-  GPIO_ToggleBits(LED_GPIO_PORT, LED_GPIO_PINS);
-  EXTI_ClearITPendingBit(EXTI_IT_Pin0);
+  EXTI->SR1 = (uint8_t)EXTI_IT_Pin0;
+
+  ISR_WCET_EXIT(ISR_WCET_EXTI0);
 }
 
 /**
@@ -173,13 +217,17 @@ INTERRUPT_HANDLER(EXTI0_IRQHandler,8)
   */
 INTERRUPT_HANDLER(EXTI1_IRQHandler,9)
 {
+  ISR_WCET_ENTER();
+
   /* Power device down (no longer accept any other requests) */
   if (!state_machine.executing_state)
   {
     state_machine_request.message = STATE_MESSAGE_SET_SLEEP;
+    GPIO_FAST_TOGGLE(LED_GPIO_PORT, LED_GPIO_PINS);
   }
-  GPIO_ToggleBits(LED_GPIO_PORT, LED_GPIO_PINS);
-  EXTI_ClearITPendingBit(EXTI_IT_Pin1);
+  EXTI->SR1 = (uint8_t)EXTI_IT_Pin1;
+
+  ISR_WCET_EXIT(ISR_WCET_EXTI1);
 }
 
 /**
@@ -189,15 +237,24 @@ INTERRUPT_HANDLER(EXTI1_IRQHandler,9)
   */
 INTERRUPT_HANDLER(EXTI2_IRQHandler,10)
 {
+  ISR_WCET_ENTER();
+
   /* Set device to sleep mode (now accepts requests)*/
   if (!state_machine.executing_state)
   {
     state_machine_request.message = STATE_MESSAGE_POWER_DOWN;
+    GPIO_FAST_TOGGLE(LED_GPIO_PORT, LED_GPIO_PINS);
   }
-  GPIO_ToggleBits(LED_GPIO_PORT, LED_GPIO_PINS);
-  EXTI_ClearITPendingBit(EXTI_IT_Pin2);
+  EXTI->SR1 = (uint8_t)EXTI_IT_Pin2;
+
+  ISR_WCET_EXIT(ISR_WCET_EXTI2);
 }
 
+/* Watch switches are on pins 3 to 5, their handlers follow in the same section */
+#if defined(_COSMIC_) && defined(RAM_EXECUTION) && defined(STM8_BASEBAND)
+#pragma section ()
+#endif /* _COSMIC_ && RAM_EXECUTION && STM8_BASEBAND */
+
 /**
   * @brief External IT PIN3 Interrupt routine.
   * @param  None
@@ -205,9 +262,18 @@ INTERRUPT_HANDLER(EXTI2_IRQHandler,10)
   */
 INTERRUPT_HANDLER(EXTI3_IRQHandler,11)
 {
-    /* In order to detect unexpected events during development,
-       it is recommended to set a breakpoint on the following instruction.
-    */
+  /* Watch print switch, queue new print time message if no other request is being processed (breakout board wake
+     button: set time) */
+  if (!state_machine.executing_state)
+  {
+    #ifdef STM8_BASEBAND
+    state_machine_request.message = STATE_MESSAGE_SET_TIME;
+    #else
+    state_machine_request.message = STATE_MESSAGE_PRINT_TIME;
+    #endif /* STM8_BASEBAND */
+    GPIO_FAST_TOGGLE(LED_GPIO_PORT, LED_GPIO_PINS);
+  }
+  EXTI->SR1 = (uint8_t)EXTI_IT_Pin3;
 }
 
 /**
@@ -217,9 +283,19 @@ INTERRUPT_HANDLER(EXTI3_IRQHandler,11)
   */
 INTERRUPT_HANDLER(EXTI4_IRQHandler,12)
 {
+  #ifndef STM8_BASEBAND
+  /* Watch power switch on (now accepts requests) */
+  if (!state_machine.executing_state)
+  {
+    state_machine_request.message = STATE_MESSAGE_SET_SLEEP;
+    GPIO_FAST_TOGGLE(LED_GPIO_PORT, LED_GPIO_PINS);
+  }
+  EXTI->SR1 = (uint8_t)EXTI_IT_Pin4;
+  #else
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+  #endif /* !STM8_BASEBAND */
 }
 
 /**
@@ -229,11 +305,25 @@ INTERRUPT_HANDLER(EXTI4_IRQHandler,12)
   */
 INTERRUPT_HANDLER(EXTI5_IRQHandler,13)
 {
+  #ifndef STM8_BASEBAND
+  /* Watch power switch off (no longer accept any other requests) */
+  if (!state_machine.executing_state)
+  {
+    state_machine_request.message = STATE_MESSAGE_POWER_DOWN;
+    GPIO_FAST_TOGGLE(LED_GPIO_PORT, LED_GPIO_PINS);
+  }
+  EXTI->SR1 = (uint8_t)EXTI_IT_Pin5;
+  #else
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+  #endif /* !STM8_BASEBAND */
 }
 
+#if defined(_COSMIC_) && defined(RAM_EXECUTION) && !defined(STM8_BASEBAND)
+#pragma section ()
+#endif /* _COSMIC_ && RAM_EXECUTION && !STM8_BASEBAND */
+
 /**
   * @brief External IT PIN6 Interrupt routine.
   * @param  None
@@ -292,6 +382,12 @@ INTERRUPT_HANDLER(ADC1_COMP_IRQHandler,18)
     */
 }
 
+/* Display timer, wakes the CPU at every step and frame while digits are shown. Executed from RAM, the step and
+   frame code it calls stays in flash. */
+#if defined(_COSMIC_) && defined(RAM_EXECUTION)
+#pragma section (FLASH_CODE)
+#endif /* _COSMIC_ && RAM_EXECUTION */
+
 /**
   * @brief TIM2 Update/Overflow/Trigger/Break /USART2 TX Interrupt routine.
   * @param  None
@@ -299,11 +395,21 @@ INTERRUPT_HANDLER(ADC1_COMP_IRQHandler,18)
   */
 INTERRUPT_HANDLER(TIM2_UPD_OVF_TRG_BRK_USART2_TX_IRQHandler,19)
 {
-    /* In order to detect unexpected events during development,
-       it is recommended to set a breakpoint on the following instruction.
-    */
+  ISR_WCET_ENTER();
+
+  /* Next animation frame or display step, hand the end of the sequence to the state machine */
+  if (((frame_busy() != FALSE) ? frame_tick() : display_tick()) != FALSE)
+  {
+    state_machine_request.message = STATE_MESSAGE_DISPLAY_DONE;
+  }
+
+  ISR_WCET_EXIT(ISR_WCET_TIM2);
 }
 
+#if defined(_COSMIC_) && defined(RAM_EXECUTION)
+#pragma section ()
+#endif /* _COSMIC_ && RAM_EXECUTION */
+
 /**
   * @brief Timer2 Capture/Compare / USART2 RX Interrupt routine.
   * @param  None
@@ -346,9 +452,14 @@ INTERRUPT_HANDLER(TIM3_CC_USART3_RX_IRQHandler,22)
   */
 INTERRUPT_HANDLER(TIM1_UPD_OVF_TRG_COM_IRQHandler,23)
 {
-    /* In order to detect unexpected events during development,
-       it is recommended to set a breakpoint on the following instruction.
-    */
+#ifdef STM8_BASEBAND
+  ISR_WCET_ENTER();
+
+  /* Profiling timestamp high word */
+  profile_overflow();
+
+  ISR_WCET_EXIT(ISR_WCET_TIM1);
+#endif /* STM8_BASEBAND */
 }
 /**
   * @brief TIM1 Capture/Compare Interrupt routine.
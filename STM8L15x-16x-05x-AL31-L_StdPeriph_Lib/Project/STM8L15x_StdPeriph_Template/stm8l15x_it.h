@@ -32,8 +32,15 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm8l15x.h"
 #include "stm8l15x_gpio.h"
+#include "gpio_fast.h"
 #include "hardwaredefs.h"
 #include "state_machine.h"
+#include "display.h"
+#include "frame.h"
+#include "cathode.h"
+#include "battery.h"
+#include "isr_wcet.h"
+#include "profile.h"
 
 /* Exported types ------------------------------------------------------------*/
 /* Exported constants --------------------------------------------------------*/
@@ -0,0 +1,238 @@
+/**
+ * @file transition.c
+ * @brief Digit transitions, a print is rendered once into display frames with the selected effect where the
+ * digits change and the frame scheduler plays it from interrupts
+ *
+ * Effects are frame lists: a crossfade is a PWM cycle interleaving the old and new digits, repeated per duty
+ * level, a slot machine roll is a held frame per rolled digit. Nothing is computed while the frames play.
+ *
+ * Shift register tubes have no frames, there the module is compiled out and its header stubs the functions.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "transition.h"
+
+#ifndef NIXIE_SPI
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+static const uint8_t transition_blank[DISPLAY_NUM_TUBES] = {
+  DISPLAY_BLANK,
+  #ifndef STM8_BASEBAND
+  DISPLAY_BLANK
+  #endif /* !STM8_BASEBAND */
+};
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static bool transition_render(const uint8_t* from, const uint8_t* to, uint16_t gap_ms);
+static bool transition_crossfade(const uint8_t* from, const uint8_t* to);
+static bool transition_slot(const uint8_t* from, const uint8_t* to);
+static uint16_t transition_hold_ticks(uint16_t ms);
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Render a time into display frames, HH then MM split over the tubes like display_render_time() with the
+ * TRANSITION_EFFECT instead of the gaps between steps
+ *
+ * Steps showing the same digits as the one before are still separated by a blank gap. The tubes are blanked by
+ * the last frame.
+ *
+ * @param hours: Hours (0-23)
+ * @param minutes: Minutes (0-59)
+ * @param digit_ms: Time each digit is lit (transitions excluded), in ms (1-1000)
+ * @retval TRUE if rendered, FALSE if TRANSITION_EFFECT is TRANSITION_NONE or the frame buffers are too small
+ * @note Must not be called while frames are playing
+ */
+bool transition_render_time(uint8_t hours, uint8_t minutes, uint16_t digit_ms)
+{
+  uint8_t digits[DISPLAY_NUM_DIGITS];
+  uint8_t i;
+  uint16_t gap_ms;
+
+  if (TRANSITION_EFFECT == TRANSITION_NONE)
+  {
+    return FALSE;
+  }
+
+  digits[0] = (uint8_t)(hours / 10);
+  digits[1] = (uint8_t)(hours % 10);
+  digits[2] = (uint8_t)(minutes / 10);
+  digits[3] = (uint8_t)(minutes % 10);
+
+  frame_clear();
+
+  for (i=0; i<DISPLAY_NUM_DIGITS; i+=DISPLAY_NUM_TUBES)
+  {
+    if (i == 0)
+    {
+      if (frame_add(&digits[i]) == FALSE)
+      {
+        return FALSE;
+      }
+    }
+    else
+    {
+      gap_ms = ((i % DISPLAY_FIELD_DIGITS) == 0) ? DISPLAY_FIELD_GAP_MS : DISPLAY_DIGIT_GAP_MS;
+      if (transition_render(&digits[i - DISPLAY_NUM_TUBES], &digits[i], gap_ms) == FALSE)
+      {
+        return FALSE;
+      }
+    }
+
+    if (frame_hold(transition_hold_ticks(digit_ms)) == FALSE)
+    {
+      return FALSE;
+    }
+  }
+
+  return frame_add(transition_blank);
+}
+
+/**
+ * @brief Start playing the rendered print, returns immediately
+ * @retval TRUE if started, FALSE if TIM2 is in use (HV supply warm-up or display sequence) or nothing is rendered
+ * @note Power supply must be enabled, the end is reported by frame_tick()/frame_dma_tick()
+ */
+bool transition_start(void)
+{
+  return frame_play(TRANSITION_FRAME_TICKS);
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Render the change from one step to the next, ends with the new digits shown
+ * @param from: Digits shown, one per tube
+ * @param to: Digits shown next, one per tube
+ * @param gap_ms: Blank time between two equal steps, in ms (0 for none)
+ * @retval TRUE if rendered, FALSE if the frame buffers are full
+ */
+static bool transition_render(const uint8_t* from, const uint8_t* to, uint16_t gap_ms)
+{
+  uint8_t t;
+  bool changing = FALSE;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    if (from[t] != to[t])
+    {
+      changing = TRUE;
+    }
+  }
+
+  /* Nothing to animate, the gap keeps the steps apart */
+  if (changing == FALSE)
+  {
+    if (gap_ms == 0)
+    {
+      return TRUE;
+    }
+    if ((frame_add(transition_blank) == FALSE) || (frame_hold(transition_hold_ticks(gap_ms)) == FALSE))
+    {
+      return FALSE;
+    }
+    return frame_add(to);
+  }
+
+  return (TRANSITION_EFFECT == TRANSITION_SLOT) ? transition_slot(from, to) : transition_crossfade(from, to);
+}
+
+/**
+ * @brief Crossfade, a PWM cycle of TRANSITION_FADE_LEVELS frames repeated at every level, the new digits get one
+ * frame more per level
+ * @param from: Digits shown, one per tube
+ * @param to: Digits shown next, one per tube
+ * @retval TRUE if rendered, FALSE if the frame buffers are full
+ */
+static bool transition_crossfade(const uint8_t* from, const uint8_t* to)
+{
+  uint8_t level;
+  uint8_t i;
+
+  for (level=1; level<TRANSITION_FADE_LEVELS; level++)
+  {
+    for (i=0; i<TRANSITION_FADE_LEVELS; i++)
+    {
+      if (frame_add((i < (TRANSITION_FADE_LEVELS - level)) ? from : to) == FALSE)
+      {
+        return FALSE;
+      }
+    }
+
+    if (frame_repeat(TRANSITION_FADE_CYCLES) == FALSE)
+    {
+      return FALSE;
+    }
+  }
+
+  return frame_add(to);
+}
+
+/**
+ * @brief Slot machine, every changing tube counts up to its new digit, rolling through the last
+ * TRANSITION_SLOT_STEPS digits before it, tubes with a shorter way wait on their old digit
+ * @param from: Digits shown, one per tube
+ * @param to: Digits shown next, one per tube
+ * @retval TRUE if rendered, FALSE if the frame buffers are full
+ */
+static bool transition_slot(const uint8_t* from, const uint8_t* to)
+{
+  uint8_t distance[DISPLAY_NUM_TUBES];
+  uint8_t roll[DISPLAY_NUM_TUBES];
+  uint8_t steps = 0;
+  uint8_t back;
+  uint8_t t;
+  uint8_t s;
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    distance[t] = 0;
+    if ((from[t] != DISPLAY_BLANK) && (to[t] != DISPLAY_BLANK))
+    {
+      distance[t] = (uint8_t)((to[t] + NUM_NIXIE_DIGITS - from[t]) % NUM_NIXIE_DIGITS);
+    }
+    steps = (distance[t] > steps) ? distance[t] : steps;
+  }
+  steps = (steps > TRANSITION_SLOT_STEPS) ? TRANSITION_SLOT_STEPS : steps;
+
+  /* Rolled digits, s - 1 before the new one */
+  for (s=steps; s>1; s--)
+  {
+    for (t=0; t<DISPLAY_NUM_TUBES; t++)
+    {
+      back = (distance[t] < (uint8_t)(s - 1)) ? distance[t] : (uint8_t)(s - 1);
+      roll[t] = (back == 0) ? to[t] : (uint8_t)((to[t] + NUM_NIXIE_DIGITS - back) % NUM_NIXIE_DIGITS);
+    }
+
+    if ((frame_add(roll) == FALSE) || (frame_hold(transition_hold_ticks(TRANSITION_SLOT_MS)) == FALSE))
+    {
+      return FALSE;
+    }
+  }
+
+  return frame_add(to);
+}
+
+/**
+ * @brief Hold time of a frame shown for a duration, the frame period is counted in
+ * @param ms: Duration in ms (1-1000)
+ * @retval Display timer ticks on top of the frame period
+ */
+static uint16_t transition_hold_ticks(uint16_t ms)
+{
+  uint16_t ticks = DISPLAY_MS_TO_TICKS(ms);
+
+  return (ticks > TRANSITION_FRAME_TICKS) ? (uint16_t)(ticks - TRANSITION_FRAME_TICKS) : 1;
+}
+#endif /* !NIXIE_SPI */
@@ -0,0 +1,76 @@
+/**
+ * @file transition.h
+ * @brief Function prototypes, defines and types for digit transitions, a print rendered into display frames with
+ * an effect between consecutive steps
+ */
+
+#ifndef TRANSITION_H_
+#define TRANSITION_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "frame.h"
+
+/******************************************************************************/
+/*                              T Y P E D E F S                               */
+/******************************************************************************/
+
+/**
+ * @brief Effect played where the shown digits change
+ */
+typedef enum
+{
+  TRANSITION_NONE, /* Display sequencer, steps separated by blank gaps */
+
+  TRANSITION_CROSSFADE, /* Old and new digits interleaved, the new one's share growing level by level */
+
+  TRANSITION_SLOT /* Slot machine, changing tubes roll upwards through the digits before the new one */
+
+} transition_t;
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Effect played by every print, selected at build time (no input switches it) */
+#ifndef TRANSITION_EFFECT
+#define TRANSITION_EFFECT TRANSITION_NONE
+#endif /* TRANSITION_EFFECT */
+
+/* Frame period, covers the break before make interval (a blank frame) */
+#ifndef TRANSITION_FRAME_US
+#define TRANSITION_FRAME_US 192
+#endif /* TRANSITION_FRAME_US */
+#define TRANSITION_FRAME_TICKS DISPLAY_US_TO_TICKS(TRANSITION_FRAME_US)
+
+/* Crossfade length and duty levels, one PWM cycle is TRANSITION_FADE_LEVELS frames (plus up to two blank frames)
+   of which the new digit gets one more per level. Each level is a repeated segment, FRAME_MAX_FRAMES and
+   FRAME_MAX_SEGMENTS are sized for three levels. */
+#ifndef TRANSITION_FADE_MS
+#define TRANSITION_FADE_MS 160
+#endif /* TRANSITION_FADE_MS */
+#define TRANSITION_FADE_LEVELS 3
+#define TRANSITION_FADE_CYCLES (DISPLAY_MS_TO_TICKS(TRANSITION_FADE_MS) / \
+  ((TRANSITION_FADE_LEVELS - 1) * (TRANSITION_FADE_LEVELS + 2) * TRANSITION_FRAME_TICKS))
+
+/* Slot machine, time each rolled digit is shown and the most digits rolled through (the new one included) */
+#ifndef TRANSITION_SLOT_MS
+#define TRANSITION_SLOT_MS 40
+#endif /* TRANSITION_SLOT_MS */
+#define TRANSITION_SLOT_STEPS 3
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+#ifdef NIXIE_SPI
+/* Transitions are rendered into frames, which shift register tubes do not have: prints fall back to the display
+   sequencer whatever TRANSITION_EFFECT is */
+#define transition_render_time(hours, minutes, digit_ms) FALSE
+#define transition_start() FALSE
+#else
+bool transition_render_time(uint8_t hours, uint8_t minutes, uint16_t digit_ms);
+bool transition_start(void);
+#endif /* NIXIE_SPI */
+
+#endif /* TRANSITION_H_ */
@@ -10,23 +10,40 @@
 #include "stm8l15x_clk.h"
 
 #include "hardwaredefs.h"
+#include "periph_clk.h"
 #include "uart.h"
 #include <string.h>
 
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Set once USART1 has been configured, drivers are initialized on first use to keep boot short */
+static bool uart_ready = FALSE;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static void uart_lazy_init(void);
+static void uart_release(void);
+
 /******************************************************************************/
 /*                       P U B L I C  F U N C T I O N S                       */
 /******************************************************************************/
 
 /**
  * @brief Initialization routine needed for device-to-host communication via USB-UART
+ * @note Called automatically on first use, only needs to be called explicitly to configure the pins early
  */
 void init_uart(void)
 {
+  uart_ready = TRUE;
+
   /* Must remap the UART1 default pin config */
   SYSCFG_REMAPPinConfig(REMAP_Pin_USART1TxRxPortA, ENABLE);
 
-  /* USART1 CLK enable */
-	CLK_PeripheralClockConfig(CLK_Peripheral_USART1, ENABLE);
+  /* USART1 CLK enable, only held for configuration (register contents are retained while gated) */
+  periph_clk_acquire(CLK_Peripheral_USART1);
 
   //GPIO_ExternalPullUpConfig(GPIOA, GPIO_Pin_3, ENABLE);
 
@@ -34,6 +51,8 @@ void init_uart(void)
   USART_Init(USART1, UART_BAUDRATE, USART_WordLength_8b, USART_StopBits_1, USART_Parity_No, (USART_Mode_Rx|USART_Mode_Tx));
   USART_ClockInit(USART1, USART_Clock_Disable, USART_CPOL_Low, USART_CPHA_1Edge, USART_LastBit_Disable);
   USART_Cmd(USART1, ENABLE);
+
+  periph_clk_release(CLK_Peripheral_USART1);
 }
 
 /**
@@ -43,27 +62,86 @@ void init_uart(void)
 */
 char putchar(char c)
 {
+  uart_lazy_init();
+
+  periph_clk_acquire(CLK_Peripheral_USART1);
+
   /* Write a character to the UART1 */
   USART_SendData8(USART1, c);
 /* Loop until the end of transmission */
   while(USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET);
+
+  uart_release();
   return (c);
 }
 
+/**
+ * @brief Open a console read, USART1 stays clocked until uart_rx_end() so the receiver keeps running between
+ * getchar()/tiny_scan() calls
+ * @retval None
+ * @note The receiver is stopped while the USART1 clock is gated, bytes sent by the host outside an open read are lost
+*/
+void uart_rx_begin(void)
+{
+  uart_lazy_init();
+
+  periph_clk_acquire(CLK_Peripheral_USART1);
+}
+
+/**
+ * @brief Close a console read opened with uart_rx_begin(), USART1 is gated again once nothing else uses it
+ * @retval None
+*/
+void uart_rx_end(void)
+{
+  uart_release();
+}
+
 /**
  * @brief Recieve byte from host via UART
  * @retval Byte recieved
- * @note This operation is blocking, if host does not send any data, device will poll indefinitely
+ * @note This operation is blocking, if host does not send any data, device will poll indefinitely. Call between
+ *       uart_rx_begin() and uart_rx_end() when reading more than one byte, USART1 is gated on return otherwise.
 */
 char getchar(void)
 {
   char c = 0;
+
+  uart_lazy_init();
+
+  periph_clk_acquire(CLK_Peripheral_USART1);
+
   /* Loop until the Read data register flag is SET */
   while (USART_GetFlagStatus(USART1, USART_FLAG_RXNE) == RESET);
   c = USART_ReceiveData8(USART1);
+
+  periph_clk_release(CLK_Peripheral_USART1);
   return (c);
 }
 
+/**
+ * @brief Recieve byte from host via UART, giving up after a number of status polls
+ * @param c: Byte recieved, unchanged on timeout
+ * @param polls: RXNE status polls before giving up
+ * @retval TRUE if a byte was recieved, FALSE on timeout
+ * @note Call between uart_rx_begin() and uart_rx_end(), a byte sent while USART1 is gated is lost.
+*/
+bool uart_getchar_timeout(char* c, uint16_t polls)
+{
+  uint16_t i;
+
+  for (i=0; i<polls; i++)
+  {
+    if (USART_GetFlagStatus(USART1, USART_FLAG_RXNE) != RESET)
+    {
+      *c = (char)USART_ReceiveData8(USART1);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 /**
  * @brief Print pre-formatted string via UART
  * @param str: Pre-formatted string to print
@@ -75,7 +153,7 @@ char getchar(void)
  *       calculates complete buffer size, NULL terminator is expected in the value
  *       of len.
 */
-void tiny_print(char* str, int len)
+void tiny_print(const char* str, int len)
 {
   int i;
 
@@ -85,11 +163,16 @@ void tiny_print(char* str, int len)
     return;
   }
 
+  /* Hold USART clock for the whole string so it is not toggled per character */
+  periph_clk_acquire(CLK_Peripheral_USART1);
+
   /* Send string via UART */
   for (i=0; i<len; i++)
   {
     putchar(str[i]);
   }
+
+  uart_release();
 }
 
 /**
@@ -98,6 +181,9 @@ void tiny_print(char* str, int len)
  * @param len: Length of expected string INCLUDING NULL TERMINATOR
  * @retval None
  *
+ * @note USART1 is held for the whole string. Bytes sent between two scans are only received inside a console read
+ *       opened with uart_rx_begin().
+ *
  * @note In order to reduce compiled code size, the ARR_SIZE macro is reccomended
  *       to be used to calculate the len parameter at compile time. Since ARR_SIZE
  *       calculates complete buffer size, NULL terminator is expected in the value
@@ -112,8 +198,41 @@ void tiny_scan(char* out, int len)
     return;
   }
 
+  uart_rx_begin();
+
   for (i=0; i<len; i++)
   {
     out[i] = getchar();
   }
+
+  uart_rx_end();
+}
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Configure USART1 if this is the first use since reset
+*/
+static void uart_lazy_init(void)
+{
+  if (uart_ready == FALSE)
+  {
+    init_uart();
+  }
+}
+
+/**
+ * @brief Release USART clock once the final byte has left the shift register
+ * @note TXE only indicates the data register is empty, gating the clock before TC would truncate the last byte
+*/
+static void uart_release(void)
+{
+  /* Only the last user needs to drain the transmitter */
+  if (periph_clk_users(CLK_Peripheral_USART1) == 1)
+  {
+    while(USART_GetFlagStatus(USART1, USART_FLAG_TC) == RESET);
+  }
+  periph_clk_release(CLK_Peripheral_USART1);
 }
@@ -6,18 +6,29 @@
 #ifndef UART_H_
 #define UART_H_
 
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x.h"
+
 /******************************************************************************/
 /*                               D E F I N E S                                */
 /******************************************************************************/
 #define UART_BAUDRATE 115200
 
+/* Useful macro for reducing runtime code size */
+#define ARR_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
 /******************************************************************************/
 /*                             F U N C T I O N S                              */
 /******************************************************************************/
 void init_uart(void);
 char putchar(char c);
 char getchar(void);
-void tiny_print(char* str, int len);
+bool uart_getchar_timeout(char* c, uint16_t polls);
+void uart_rx_begin(void);
+void uart_rx_end(void);
+void tiny_print(const char* str, int len);
 void tiny_scan(char* out, int len);
 
 #endif /* UART_H_ */
@@ -0,0 +1,325 @@
+/**
+ * @file usage.c
+ * @brief Per cathode lifetime lit time, the display sequencer adds every sequence to RAM counters which are
+ * folded into a data EEPROM log at most once per flush interval
+ *
+ * The log is a ring of USAGE_RECORD_SIZE slots filling the data EEPROM. Each flush reads the newest valid record,
+ * adds the whole seconds pending in RAM (the remainder stays pending) and writes the result to the next slot, so
+ * every slot wears at the same rate. Records are validated by CRC on boot, a record torn by a reset or a dead
+ * cell is skipped and the previous one is used.
+ */
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "usage.h"
+#include "uart.h"
+
+/******************************************************************************/
+/*               P R I V A T E  G L O B A L  V A R I A B L E S                */
+/******************************************************************************/
+
+/* Lit time not yet written, in display lit units */
+static uint16_t usage_pending[DISPLAY_NUM_TUBES][NUM_NIXIE_DIGITS];
+
+/* A pending counter passed USAGE_PENDING_LIMIT */
+static bool usage_full = FALSE;
+
+/* Scheduled wakes since the last write */
+static uint8_t usage_wakes = 0;
+
+/* Newest valid record, USAGE_NUM_SLOTS if the log is empty. Sequence numbers wrap. */
+static uint8_t usage_slot = 0;
+static uint16_t usage_seq = 0;
+
+/******************************************************************************/
+/*            P R I V A T E  F U N C T I O N  P R O T O T Y P E S             */
+/******************************************************************************/
+static uint32_t usage_slot_addr(uint8_t slot);
+static uint32_t usage_read_word(uint32_t addr);
+static uint8_t usage_crc(uint8_t crc, uint32_t word, uint8_t len);
+static bool usage_slot_valid(uint8_t slot, uint16_t* seq);
+#ifdef STM8_BASEBAND
+static void usage_print_hours(uint8_t digit, uint32_t total_s);
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                       P U B L I C  F U N C T I O N S                       */
+/******************************************************************************/
+
+/**
+ * @brief Find the newest valid record, should be called once at startup
+ */
+void usage_init(void)
+{
+  uint8_t slot;
+  uint16_t seq;
+
+  usage_slot = USAGE_NUM_SLOTS;
+
+  for (slot=0; slot<USAGE_NUM_SLOTS; slot++)
+  {
+    if (usage_slot_valid(slot, &seq) == FALSE)
+    {
+      continue;
+    }
+
+    /* Sequence numbers wrap, newer means ahead by less than half the range */
+    if ((usage_slot == USAGE_NUM_SLOTS) || ((int16_t)(seq - usage_seq) > 0))
+    {
+      usage_slot = slot;
+      usage_seq = seq;
+    }
+  }
+}
+
+/**
+ * @brief Add lit time of a cathode, called by the display sequencer for every sequence it starts
+ * @param tube: Tube index in step digit order (0 to DISPLAY_NUM_TUBES - 1)
+ * @param digit: Digit (0-9)
+ * @param units: Lit time, in units of 2^DISPLAY_LIT_SHIFT timer ticks
+ */
+void usage_add(uint8_t tube, uint8_t digit, uint16_t units)
+{
+  uint16_t* pending = &usage_pending[tube][digit];
+
+  *pending = (*pending > (uint16_t)(0xFFFF - units)) ? 0xFFFF : (uint16_t)(*pending + units);
+  if (*pending >= USAGE_PENDING_LIMIT)
+  {
+    usage_full = TRUE;
+  }
+}
+
+/**
+ * @brief Write the pending lit time if the flush interval has passed, or if a counter is about to saturate
+ * @param scheduled: TRUE on a scheduled (RTC) wake, FALSE at the end of a display sequence
+ */
+void usage_update(bool scheduled)
+{
+  if (scheduled && (usage_wakes < USAGE_FLUSH_WAKES))
+  {
+    usage_wakes++;
+  }
+
+  if ((usage_wakes >= USAGE_FLUSH_WAKES) || (usage_full != FALSE))
+  {
+    usage_flush();
+  }
+}
+
+/**
+ * @brief Write a new record to the next slot, newest totals plus the whole seconds pending
+ * @note Blocks for one data EEPROM word write per cathode plus the header (~6ms each)
+ */
+void usage_flush(void)
+{
+  uint8_t slot = (usage_slot >= (USAGE_NUM_SLOTS - 1)) ? 0 : (uint8_t)(usage_slot + 1);
+  uint16_t seq = (uint16_t)(usage_seq + 1);
+  uint32_t addr = usage_slot_addr(slot) + USAGE_WORD_SIZE;
+  uint32_t total;
+  uint32_t us;
+  uint8_t crc;
+  uint8_t t;
+  uint8_t d;
+
+  crc = usage_crc(USAGE_CRC_INIT, seq, sizeof(uint16_t));
+
+  FLASH_Unlock(FLASH_MemType_Data);
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      us = (uint32_t)usage_pending[t][d] * USAGE_US_PER_UNIT;
+      total = usage_total_s(t, d) + (us / USAGE_US_PER_S);
+      usage_pending[t][d] = (uint16_t)((us % USAGE_US_PER_S) / USAGE_US_PER_UNIT);
+
+      FLASH_ProgramWord(addr, total);
+      FLASH_WaitForLastOperation(FLASH_MemType_Data);
+      crc = usage_crc(crc, total, USAGE_WORD_SIZE);
+      addr += USAGE_WORD_SIZE;
+    }
+  }
+
+  /* Header last, the record is not valid until it is written */
+  FLASH_ProgramWord(usage_slot_addr(slot), ((uint32_t)seq << USAGE_SEQ_SHIFT) | ((uint32_t)crc << USAGE_CRC_SHIFT));
+  FLASH_WaitForLastOperation(FLASH_MemType_Data);
+
+  FLASH_Lock(FLASH_MemType_Data);
+
+  usage_slot = slot;
+  usage_seq = seq;
+  usage_wakes = 0;
+  usage_full = FALSE;
+
+  #ifdef STM8_BASEBAND
+  usage_dump();
+  #endif /* STM8_BASEBAND */
+}
+
+/**
+ * @brief Get the lit time of a cathode stored in data EEPROM
+ * @param tube: Tube index in step digit order
+ * @param digit: Digit (0-9)
+ * @retval Lifetime lit time in s, as of the last write
+ */
+uint32_t usage_total_s(uint8_t tube, uint8_t digit)
+{
+  if (usage_slot == USAGE_NUM_SLOTS)
+  {
+    return 0;
+  }
+
+  return usage_read_word(usage_slot_addr(usage_slot) + (USAGE_WORD_SIZE * (1 + (tube * NUM_NIXIE_DIGITS) + digit)));
+}
+
+/**
+ * @brief Get the lifetime lit time of a cathode including the pending time
+ * @param tube: Tube index in step digit order
+ * @param digit: Digit (0-9)
+ * @retval Lit time in 1/USAGE_LIT_PER_S s
+ */
+uint32_t usage_lit_time(uint8_t tube, uint8_t digit)
+{
+  return (usage_total_s(tube, digit) * USAGE_LIT_PER_S) +
+         (((uint32_t)usage_pending[tube][digit] * USAGE_LIT_PER_S * USAGE_US_PER_UNIT) / USAGE_US_PER_S);
+}
+
+#ifdef STM8_BASEBAND
+/**
+ * @brief Print lifetime lit hours per cathode per tube to host PC
+ * @note Format: "Usage tube A (h): 0=HHHHH.hh .. 9=HHHHH.hh", as of the last write
+ */
+void usage_dump(void)
+{
+  uint8_t t;
+  uint8_t d;
+  char header[] = "Usage tube A (h):";
+  const char newline[] = "\r\n";
+
+  for (t=0; t<DISPLAY_NUM_TUBES; t++)
+  {
+    header[11] = (char)('A' + t);
+    tiny_print(header, ARR_SIZE(header));
+    for (d=0; d<NUM_NIXIE_DIGITS; d++)
+    {
+      usage_print_hours(d, usage_total_s(t, d));
+    }
+    tiny_print(newline, ARR_SIZE(newline));
+  }
+}
+#endif /* STM8_BASEBAND */
+
+/******************************************************************************/
+/*                      P R I V A T E  F U N C T I O N S                      */
+/******************************************************************************/
+
+/**
+ * @brief Get the data EEPROM address of a slot
+ * @param slot: Slot (0 to USAGE_NUM_SLOTS - 1)
+ * @retval Address of the record header
+ */
+static uint32_t usage_slot_addr(uint8_t slot)
+{
+  return USAGE_EEPROM_START + ((uint32_t)slot * USAGE_RECORD_SIZE);
+}
+
+/**
+ * @brief Read a word from data EEPROM, MSB first as FLASH_ProgramWord() wrote it
+ * @param addr: Address
+ * @retval Word
+ */
+static uint32_t usage_read_word(uint32_t addr)
+{
+  uint32_t val = 0;
+  uint8_t i;
+
+  for (i=0; i<USAGE_WORD_SIZE; i++)
+  {
+    val = (val << 8) | FLASH_ReadByte(addr + i);
+  }
+
+  return val;
+}
+
+/**
+ * @brief Update a CRC-8 (USAGE_CRC_POLY, MSB first) with the low bytes of a word, in stored order
+ * @param crc: CRC so far
+ * @param word: Value
+ * @param len: Number of bytes (1 to USAGE_WORD_SIZE)
+ * @retval Updated CRC
+ */
+static uint8_t usage_crc(uint8_t crc, uint32_t word, uint8_t len)
+{
+  uint8_t bit;
+
+  while (len-- != 0)
+  {
+    crc ^= (uint8_t)(word >> (8 * len));
+    for (bit=0; bit<8; bit++)
+    {
+      crc = (uint8_t)(((crc & 0x80) != 0) ? ((crc << 1) ^ USAGE_CRC_POLY) : (crc << 1));
+    }
+  }
+
+  return crc;
+}
+
+/**
+ * @brief Check a slot's CRC
+ * @param slot: Slot
+ * @param seq: Record sequence number, set if valid
+ * @retval TRUE if the slot holds a complete record
+ */
+static bool usage_slot_valid(uint8_t slot, uint16_t* seq)
+{
+  uint32_t addr = usage_slot_addr(slot);
+  uint32_t header = usage_read_word(addr);
+  uint8_t crc;
+  uint8_t i;
+
+  crc = usage_crc(USAGE_CRC_INIT, header >> USAGE_SEQ_SHIFT, sizeof(uint16_t));
+  for (i=0; i<USAGE_NUM_TOTALS; i++)
+  {
+    addr += USAGE_WORD_SIZE;
+    crc = usage_crc(crc, usage_read_word(addr), USAGE_WORD_SIZE);
+  }
+
+  if (crc != (uint8_t)(header >> USAGE_CRC_SHIFT))
+  {
+    return FALSE;
+  }
+
+  *seq = (uint16_t)(header >> USAGE_SEQ_SHIFT);
+  return TRUE;
+}
+
+#ifdef STM8_BASEBAND
+/**
+ * @brief Print one cathode as " d=HHHHH.hh"
+ * @param digit: Digit (0-9)
+ * @param total_s: Lit time in s
+ */
+static void usage_print_hours(uint8_t digit, uint32_t total_s)
+{
+  char out[USAGE_PRINT_SIZE];
+  const char space[] = " ";
+  /* Hundredths of an hour */
+  uint32_t val = total_s / 36;
+
+  out[0] = (char)(digit + 48);
+  out[1] = '=';
+  out[2] = (char)(((val / 1000000) % 10) + 48);
+  out[3] = (char)(((val / 100000) % 10) + 48);
+  out[4] = (char)(((val / 10000) % 10) + 48);
+  out[5] = (char)(((val / 1000) % 10) + 48);
+  out[6] = (char)(((val / 100) % 10) + 48);
+  out[7] = '.';
+  out[8] = (char)(((val / 10) % 10) + 48);
+  out[9] = (char)((val % 10) + 48);
+  out[10] = '\0';
+
+  tiny_print(space, ARR_SIZE(space));
+  tiny_print(out, USAGE_PRINT_SIZE);
+}
+#endif /* STM8_BASEBAND */
@@ -0,0 +1,73 @@
+/**
+ * @file usage.h
+ * @brief Function prototypes, defines and types for per cathode lifetime lit time, accumulated in RAM and kept
+ * in a wear levelled data EEPROM log
+ */
+
+#ifndef USAGE_H_
+#define USAGE_H_
+
+/******************************************************************************/
+/*                              I N C L U D E S                               */
+/******************************************************************************/
+#include "stm8l15x_flash.h"
+#include "display.h"
+
+/******************************************************************************/
+/*                               D E F I N E S                                */
+/******************************************************************************/
+
+/* Pending lit time is written to data EEPROM every USAGE_FLUSH_WAKES scheduled wakes (CATHODE_PERIOD_S apart) */
+#ifndef USAGE_FLUSH_WAKES
+#define USAGE_FLUSH_WAKES 2
+#endif /* USAGE_FLUSH_WAKES */
+
+/* Pending lit time of one cathode that forces a write at the end of the display sequence, before it saturates */
+#define USAGE_PENDING_LIMIT 0x8000
+
+/* Display lit time unit (2^DISPLAY_LIT_SHIFT timer ticks) in us */
+#define USAGE_US_PER_UNIT ((uint32_t)DISPLAY_US_PER_TICK << DISPLAY_LIT_SHIFT)
+#define USAGE_US_PER_S 1000000UL
+
+/* Resolution of usage_lit_time(), per second */
+#define USAGE_LIT_PER_S 16
+
+/* Log occupies the whole data EEPROM, one record per slot, written round robin */
+#define USAGE_EEPROM_START FLASH_DATA_EEPROM_START_PHYSICAL_ADDRESS
+#define USAGE_EEPROM_SIZE (FLASH_DATA_EEPROM_END_PHYSICAL_ADDRESS - FLASH_DATA_EEPROM_START_PHYSICAL_ADDRESS + 1)
+
+/* Record: header word (sequence number, CRC, 0) then the lifetime lit time in s of every cathode, tube by tube.
+   Words are stored MSB first (FLASH_ProgramWord() byte order) and written with the header last, so a write torn
+   by a reset leaves no valid record. */
+#define USAGE_WORD_SIZE 4
+#define USAGE_NUM_TOTALS (DISPLAY_NUM_TUBES * NUM_NIXIE_DIGITS)
+#define USAGE_RECORD_SIZE (USAGE_WORD_SIZE * (1 + USAGE_NUM_TOTALS))
+#define USAGE_NUM_SLOTS ((uint8_t)(USAGE_EEPROM_SIZE / USAGE_RECORD_SIZE))
+
+/* Header word fields */
+#define USAGE_SEQ_SHIFT 16
+#define USAGE_CRC_SHIFT 8
+
+/* CRC-8 (x^8 + x^2 + x + 1) over the sequence number and totals as stored, non-zero initial value so an erased
+   (all 0x00) slot is never valid */
+#define USAGE_CRC_POLY 0x07
+#define USAGE_CRC_INIT 0xFF
+
+/* Output data string buffer size ("d=HHHHH.hh" + NULL) */
+#define USAGE_PRINT_SIZE 11
+
+/******************************************************************************/
+/*                             F U N C T I O N S                              */
+/******************************************************************************/
+void usage_init(void);
+void usage_add(uint8_t tube, uint8_t digit, uint16_t units);
+void usage_update(bool scheduled);
+void usage_flush(void);
+uint32_t usage_total_s(uint8_t tube, uint8_t digit);
+uint32_t usage_lit_time(uint8_t tube, uint8_t digit);
+
+#ifdef STM8_BASEBAND
+void usage_dump(void);
+#endif /* STM8_BASEBAND */
+
+#endif /* USAGE_H_ */